@@ -0,0 +1,126 @@
+// Static analysis of roms: control flow graph, basic blocks, subroutines and which bytes are code, sprites, data or written.
+// Build together with the interpreter sources of CHIP8_Interpreter (everything except its main.cpp), no OpenGL needed.
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../CHIP8_Interpreter/RomAnalyzer.h"
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options
+{
+	std::vector<std::string> paths;
+	std::string cachePath;
+	std::string dotDirectory;
+	bool blocks = false;
+	bool map = false;
+};
+
+bool ReadFile(const std::string& path, std::vector<unsigned char>& bytes)
+{
+	std::ifstream file(path, std::ios_base::binary | std::ios_base::ate);
+	if (file.fail())
+		return false;
+
+	bytes.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+	return !file.fail();
+}
+
+// Directories are expanded to the roms in them, sorted so the output is stable. Like in RomArchive those are the files without
+// an extension or with .ch8 or .c8, so romdb.txt is skipped
+std::vector<std::string> ExpandPaths(const std::vector<std::string>& paths)
+{
+	std::vector<std::string> files;
+	for (const std::string& path : paths)
+	{
+		std::error_code error;
+		if (!std::filesystem::is_directory(path, error))
+		{
+			files.push_back(path);
+			continue;
+		}
+
+		std::vector<std::string> directoryFiles;
+		for (const auto& file : std::filesystem::directory_iterator(path, error))
+		{
+			const std::string extension = file.path().extension().string();
+			if (file.is_regular_file() && (extension.empty() || extension == ".ch8" || extension == ".c8"))
+				directoryFiles.push_back(file.path().string());
+		}
+		std::sort(directoryFiles.begin(), directoryFiles.end());
+		files.insert(files.end(), directoryFiles.begin(), directoryFiles.end());
+	}
+	return files;
+}
+
+int main(int argc, char* argv[])
+{
+	// Usage: CHIP8_Analyzer [--cache file] [--blocks] [--map] [--dot directory] rom or directory...
+	Options options;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		if (arg == "--cache" && i + 1 < argc)
+			options.cachePath = argv[++i];
+		else if (arg == "--dot" && i + 1 < argc)
+			options.dotDirectory = argv[++i];
+		else if (arg == "--blocks")
+			options.blocks = true;
+		else if (arg == "--map")
+			options.map = true;
+		else
+			options.paths.push_back(arg);
+	}
+
+	if (options.paths.empty())
+	{
+		std::cout << "Usage: CHIP8_Analyzer [--cache file] [--blocks] [--map] [--dot directory] rom or directory..." << std::endl;
+		return 1;
+	}
+
+	RomAnalysisCache cache;
+	if (!options.cachePath.empty())
+		cache.Load(options.cachePath);
+
+	const Clock::time_point start = Clock::now();
+	std::vector<unsigned char> rom;
+	int failed = 0;
+	for (const std::string& path : ExpandPaths(options.paths))
+	{
+		if (!ReadFile(path, rom))
+		{
+			std::cout << "Failed to read " << path << std::endl;
+			++failed;
+			continue;
+		}
+
+		const RomAnalysis& analysis = cache.Get(rom.data(), rom.size());
+		const std::string name = std::filesystem::path(path).filename().string();
+		std::cout << name << ": ";
+		analysis.WriteSummary(std::cout);
+		if (options.blocks)
+			analysis.WriteBlocks(std::cout);
+		if (options.map)
+			analysis.WriteMap(std::cout);
+		if (!options.dotDirectory.empty())
+		{
+			std::ofstream dot(options.dotDirectory + "/" + name + ".dot");
+			analysis.WriteDot(dot, name);
+		}
+	}
+	const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	if (!options.cachePath.empty() && cache.GetMisses() > 0)
+		cache.Save(options.cachePath);
+
+	std::cout << cache.GetHits() + cache.GetMisses() << " roms in " << seconds * 1000.0 << " ms (" << cache.GetHits() << " from the cache)" << std::endl;
+	return failed == 0 ? 0 : 1;
+}
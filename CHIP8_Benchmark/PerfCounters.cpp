@@ -0,0 +1,144 @@
+#include "PerfCounters.h"
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const char* const COUNTER_NAMES[PerfCounters::COUNTER_COUNT] =
+	{
+		"cycles", "instructions", "branches", "branch_misses", "l1d_misses", "llc_misses"
+	};
+
+#ifdef __linux__
+	struct EventConfig
+	{
+		unsigned int type;
+		unsigned long long config;
+	};
+
+	const EventConfig EVENTS[PerfCounters::COUNTER_COUNT] =
+	{
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+		{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+		{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+	};
+
+	int OpenEvent(const EventConfig& event)
+	{
+		perf_event_attr attributes;
+		std::memset(&attributes, 0, sizeof(attributes));
+		attributes.size = sizeof(attributes);
+		attributes.type = event.type;
+		attributes.config = event.config;
+		attributes.disabled = 1;
+		attributes.exclude_kernel = 1; //user space only also works with perf_event_paranoid 2
+		attributes.exclude_hv = 1;
+		attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		return static_cast<int>(syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0));
+	}
+#endif
+}
+
+bool PerfCounters::Sample::IsEmpty() const
+{
+	for (int i = 0; i < COUNTER_COUNT; ++i)
+	{
+		if (valid[i])
+			return false;
+	}
+	return true;
+}
+
+PerfCounters::PerfCounters()
+{
+	for (int i = 0; i < COUNTER_COUNT; ++i)
+		m_Descriptors[i] = -1;
+}
+
+PerfCounters::~PerfCounters()
+{
+	Close();
+}
+
+const char* PerfCounters::GetName(Counter counter)
+{
+	return COUNTER_NAMES[counter];
+}
+
+bool PerfCounters::Open()
+{
+	Close();
+
+	bool opened = false;
+#ifdef __linux__
+	for (int i = 0; i < COUNTER_COUNT; ++i)
+	{
+		m_Descriptors[i] = OpenEvent(EVENTS[i]);
+		opened |= m_Descriptors[i] != -1;
+	}
+#endif
+	return opened;
+}
+
+void PerfCounters::Close()
+{
+	for (int i = 0; i < COUNTER_COUNT; ++i)
+	{
+#ifdef __linux__
+		if (m_Descriptors[i] != -1)
+			close(m_Descriptors[i]);
+#endif
+		m_Descriptors[i] = -1;
+	}
+}
+
+void PerfCounters::Start()
+{
+#ifdef __linux__
+	for (int i = 0; i < COUNTER_COUNT; ++i)
+	{
+		if (m_Descriptors[i] == -1)
+			continue;
+
+		ioctl(m_Descriptors[i], PERF_EVENT_IOC_RESET, 0);
+		ioctl(m_Descriptors[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+#endif
+}
+
+PerfCounters::Sample PerfCounters::Stop()
+{
+	Sample sample;
+#ifdef __linux__
+	for (int i = 0; i < COUNTER_COUNT; ++i)
+	{
+		if (m_Descriptors[i] != -1)
+			ioctl(m_Descriptors[i], PERF_EVENT_IOC_DISABLE, 0);
+	}
+
+	for (int i = 0; i < COUNTER_COUNT; ++i)
+	{
+		if (m_Descriptors[i] == -1)
+			continue;
+
+		//value, time enabled, time running
+		unsigned long long values[3] = {};
+		if (read(m_Descriptors[i], values, sizeof(values)) != static_cast<ssize_t>(sizeof(values)) || values[2] == 0)
+			continue;
+
+		sample.valid[i] = true;
+		sample.values[i] = static_cast<double>(values[0]) * static_cast<double>(values[1]) / static_cast<double>(values[2]);
+	}
+#endif
+	return sample;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+/* Hardware performance counters for the calling thread, read through perf_event_open on Linux.
+Elsewhere, or when the kernel refuses access (perf_event_paranoid, containers, VMs), Open returns false and samples stay invalid.
+Counters are opened one by one so a missing event (no LLC events on many VMs) does not take the others down,
+and values are scaled by enabled/running time when the kernel multiplexes them.*/
+class PerfCounters
+{
+public:
+	enum Counter
+	{
+		CYCLES,
+		INSTRUCTIONS,
+		BRANCHES,
+		BRANCH_MISSES,
+		L1D_MISSES,
+		LLC_MISSES,
+		COUNTER_COUNT
+	};
+
+	struct Sample
+	{
+		bool valid[COUNTER_COUNT] = {};
+		double values[COUNTER_COUNT] = {};
+
+		bool IsEmpty() const;
+	};
+
+	PerfCounters();
+	~PerfCounters();
+
+	//Returns true when at least one counter is available
+	bool Open();
+	void Close();
+
+	void Start();
+	Sample Stop();
+
+	//Name used as key in the benchmark json
+	static const char* GetName(Counter counter);
+
+private:
+	int m_Descriptors[COUNTER_COUNT];
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+};
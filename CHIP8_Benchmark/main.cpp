@@ -0,0 +1,412 @@
+// Headless benchmark suite: runs every rom under a fixed input script and microbenchmarks Cycle() on synthetic opcode mixes.
+// Build together with the interpreter sources of CHIP8_Interpreter (everything except its main.cpp) and PerfCounters.cpp, no OpenGL needed.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../CHIP8_Interpreter/Interpreter.h"
+#include "../CHIP8_Interpreter/RomDatabase.h"
+#include "PerfCounters.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// Dispatch backends to compare, each one configures a freshly initialized interpreter
+struct Backend
+{
+	const char* name;
+	void (*configure)(Interpreter& interpreter);
+};
+
+const Backend BACKENDS[] =
+{
+	{ "switch", [](Interpreter&) {} },
+	{ "predecoded", [](Interpreter& interpreter) { interpreter.SetPredecoded(true); } },
+	{ "fastforward", [](Interpreter& interpreter) { interpreter.SetFastForward(true); } },
+};
+
+struct Options
+{
+	std::string romDirectory = "../CHIP8_Interpreter/Resources";
+	std::string outputPath = "benchmark.json";
+	int frames = 3600; // one minute of emulated time per rom
+	long long microCycles = 20000000;
+	unsigned int seed = 1;
+};
+
+struct RomResult
+{
+	std::string name;
+	std::string backend;
+	int instructionsPerFrame = 0;
+	int frames = 0;
+	long long instructions = 0;
+	double seconds = 0.0;
+	bool halted = false;
+	std::vector<double> frameNs;
+	PerfCounters::Sample counters;
+};
+
+struct MicroResult
+{
+	std::string name;
+	std::string backend;
+	long long cycles = 0;
+	double seconds = 0.0;
+	PerfCounters::Sample counters;
+};
+
+// Fixed input script: every 16 frames a key picked by a fixed LCG is held for 8 frames
+unsigned short ScriptedKeypad(int frame)
+{
+	if ((frame % 16) >= 8)
+		return 0;
+
+	const unsigned int segment = static_cast<unsigned int>(frame / 16);
+	const unsigned int key = ((segment * 1103515245u + 12345u) >> 16) & 0xF;
+	return static_cast<unsigned short>(1 << key);
+}
+
+bool ReadFile(const std::string& path, std::vector<unsigned char>& bytes)
+{
+	std::ifstream file(path, std::ios_base::binary | std::ios_base::ate);
+	if (file.fail())
+		return false;
+
+	bytes.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+	return !file.fail();
+}
+
+std::vector<unsigned char> Assemble(const std::vector<unsigned short>& opCodes)
+{
+	std::vector<unsigned char> bytes;
+	for (unsigned short opCode : opCodes)
+	{
+		bytes.push_back(static_cast<unsigned char>(opCode >> 8));
+		bytes.push_back(static_cast<unsigned char>(opCode & 0xFF));
+	}
+	return bytes;
+}
+
+double Percentile(const std::vector<double>& sorted, double fraction)
+{
+	if (sorted.empty())
+		return 0.0;
+
+	const size_t index = std::min(sorted.size() - 1, static_cast<size_t>(fraction * sorted.size()));
+	return sorted[index];
+}
+
+// Counters is null when hardware counters are unavailable
+RomResult RunRom(const std::string& name, const std::vector<unsigned char>& rom, const RomProfile* profile, const Backend& backend, const Options& options, PerfCounters* counters)
+{
+	std::unique_ptr<Interpreter> interpreter(new Interpreter());
+	interpreter->SetSeed(options.seed); // CXNN draws from the interpreter's generator
+	interpreter->Initialize();
+	interpreter->SetSoundEnabled(false); // the beep is console output inside the timed frames
+	if (profile != nullptr)
+		profile->Apply(*interpreter);
+	backend.configure(*interpreter);
+	interpreter->LoadRom(rom.data(), rom.size());
+
+	RomResult result;
+	result.name = name;
+	result.backend = backend.name;
+	result.instructionsPerFrame = interpreter->GetInstructionsPerFrame();
+	result.frameNs.reserve(options.frames);
+
+	// The counters also see the per frame clock reads, a few dozen instructions next to a whole frame
+	if (counters != nullptr)
+		counters->Start();
+	const Clock::time_point start = Clock::now();
+	for (int frame = 0; frame < options.frames; ++frame)
+	{
+		interpreter->m_Keypad = ScriptedKeypad(frame);
+
+		const Clock::time_point frameStart = Clock::now();
+		const bool running = interpreter->RunFrame();
+		const Clock::time_point frameEnd = Clock::now();
+
+		if (!running)
+		{
+			result.halted = true;
+			break;
+		}
+
+		result.frameNs.push_back(std::chrono::duration<double, std::nano>(frameEnd - frameStart).count());
+		++result.frames;
+	}
+	result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	if (counters != nullptr)
+		result.counters = counters->Stop();
+	result.instructions = static_cast<long long>(result.frames) * result.instructionsPerFrame;
+
+	return result;
+}
+
+MicroResult RunMicro(const std::string& name, const std::vector<unsigned short>& program, const Backend& backend, const Options& options, PerfCounters* counters)
+{
+	const std::vector<unsigned char> rom = Assemble(program);
+
+	std::unique_ptr<Interpreter> interpreter(new Interpreter());
+	interpreter->Initialize();
+	interpreter->SetSoundEnabled(false);
+	backend.configure(*interpreter);
+	interpreter->LoadRom(rom.data(), rom.size());
+	interpreter->m_Keypad = 0;
+
+	MicroResult result;
+	result.name = name;
+	result.backend = backend.name;
+
+	if (counters != nullptr)
+		counters->Start();
+	const Clock::time_point start = Clock::now();
+	for (long long i = 0; i < options.microCycles; ++i)
+	{
+		if (!interpreter->Cycle())
+			break;
+		++result.cycles;
+	}
+	result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	if (counters != nullptr)
+		result.counters = counters->Stop();
+
+	return result;
+}
+
+// Synthetic opcode mixes, all of them loop forever starting at 0x200
+struct MicroProgram
+{
+	const char* name;
+	std::vector<unsigned short> opCodes;
+};
+
+std::vector<MicroProgram> MicroPrograms()
+{
+	return
+	{
+		{ "alu", { 0x6001, 0x6103, 0x8014, 0x8015, 0x8016, 0x801E, 0x8102, 0x8103, 0x7001, 0x1200 } },
+		{ "branch", { 0x7001, 0x3000, 0x7101, 0x4001, 0x7201, 0x5010, 0x9010, 0x1200 } },
+		{ "call", { 0x2206, 0x1200, 0x0000, 0x00EE } },
+		{ "memory", { 0xA300, 0xF033, 0xF255, 0xA300, 0xF265, 0x7001, 0x1200 } },
+		{ "draw", { 0xA000, 0x6008, 0x6104, 0xD015, 0xD015, 0x1206 } },
+		// same as draw with DXYN replaced by 6XNN, the difference is the cost of DXYN
+		{ "draw_baseline", { 0xA000, 0x6008, 0x6104, 0x6200, 0x6200, 0x1206 } },
+	};
+}
+
+void WriteJsonString(std::ostream& out, const std::string& value)
+{
+	out << '"';
+	for (char c : value)
+	{
+		if (c == '"' || c == '\\')
+			out << '\\';
+		out << c;
+	}
+	out << '"';
+}
+
+// Raw host counts plus the same counts per emulated instruction, omitted when no counter was available
+void WriteCounters(std::ostream& out, const PerfCounters::Sample& sample, long long instructions)
+{
+	if (sample.IsEmpty())
+		return;
+
+	out << ", \"counters\": {";
+	const char* separator = " ";
+	for (int i = 0; i < PerfCounters::COUNTER_COUNT; ++i)
+	{
+		if (!sample.valid[i])
+			continue;
+		out << separator << "\"" << PerfCounters::GetName(static_cast<PerfCounters::Counter>(i)) << "\": " << static_cast<long long>(sample.values[i]);
+		separator = ", ";
+	}
+
+	out << ", \"per_instruction\": {";
+	separator = " ";
+	for (int i = 0; i < PerfCounters::COUNTER_COUNT; ++i)
+	{
+		if (!sample.valid[i])
+			continue;
+		out << separator << "\"" << PerfCounters::GetName(static_cast<PerfCounters::Counter>(i)) << "\": " << (instructions > 0 ? sample.values[i] / instructions : 0.0);
+		separator = ", ";
+	}
+	out << " }";
+
+	if (sample.valid[PerfCounters::CYCLES] && sample.valid[PerfCounters::INSTRUCTIONS] && sample.values[PerfCounters::CYCLES] > 0.0)
+		out << ", \"ipc\": " << sample.values[PerfCounters::INSTRUCTIONS] / sample.values[PerfCounters::CYCLES];
+	if (sample.valid[PerfCounters::BRANCHES] && sample.valid[PerfCounters::BRANCH_MISSES] && sample.values[PerfCounters::BRANCHES] > 0.0)
+		out << ", \"branch_miss_rate\": " << sample.values[PerfCounters::BRANCH_MISSES] / sample.values[PerfCounters::BRANCHES];
+	out << " }";
+}
+
+void WriteJson(std::ostream& out, const std::vector<RomResult>& roms, const std::vector<MicroResult>& micros, const Options& options, bool countersAvailable)
+{
+	double drawNs = 0.0;
+	double baselineNs = 0.0;
+	for (const MicroResult& micro : micros)
+	{
+		const double ns = micro.cycles > 0 ? micro.seconds * 1e9 / micro.cycles : 0.0;
+		if (micro.name == "draw")
+			drawNs = ns;
+		else if (micro.name == "draw_baseline")
+			baselineNs = ns;
+	}
+
+	out << "{\n";
+	out << "  \"build\": { \"compiler\": ";
+#if defined(_MSC_VER)
+	WriteJsonString(out, "msvc " + std::to_string(_MSC_VER));
+#elif defined(__clang__)
+	WriteJsonString(out, std::string("clang ") + __clang_version__);
+#elif defined(__GNUC__)
+	WriteJsonString(out, std::string("gcc ") + __VERSION__);
+#else
+	WriteJsonString(out, "unknown");
+#endif
+	out << ", \"date\": ";
+	WriteJsonString(out, std::string(__DATE__) + " " + __TIME__);
+	out << " },\n";
+	out << "  \"frames\": " << options.frames << ",\n";
+	out << "  \"seed\": " << options.seed << ",\n";
+	out << "  \"counters_available\": " << (countersAvailable ? "true" : "false") << ",\n";
+
+	// The draw loop runs 2 DXYN and a jump, the baseline loop 2 6XNN and a jump
+	out << "  \"dxyn_ns\": " << (drawNs - baselineNs) * 3.0 / 2.0 + baselineNs << ",\n";
+
+	out << "  \"roms\": [\n";
+	for (size_t i = 0; i < roms.size(); ++i)
+	{
+		const RomResult& rom = roms[i];
+		std::vector<double> sorted = rom.frameNs;
+		std::sort(sorted.begin(), sorted.end());
+
+		out << "    { \"name\": ";
+		WriteJsonString(out, rom.name);
+		out << ", \"backend\": ";
+		WriteJsonString(out, rom.backend);
+		out << ", \"instructions_per_frame\": " << rom.instructionsPerFrame
+			<< ", \"frames\": " << rom.frames
+			<< ", \"halted\": " << (rom.halted ? "true" : "false")
+			<< ", \"instructions\": " << rom.instructions
+			<< ", \"seconds\": " << rom.seconds
+			<< ", \"ips\": " << (rom.seconds > 0.0 ? rom.instructions / rom.seconds : 0.0)
+			<< ", \"ns_per_instruction\": " << (rom.instructions > 0 ? rom.seconds * 1e9 / rom.instructions : 0.0)
+			<< ", \"frame_ns\": { \"p50\": " << Percentile(sorted, 0.50)
+			<< ", \"p90\": " << Percentile(sorted, 0.90)
+			<< ", \"p99\": " << Percentile(sorted, 0.99)
+			<< ", \"max\": " << (sorted.empty() ? 0.0 : sorted.back()) << " }";
+		WriteCounters(out, rom.counters, rom.instructions);
+		out << " }" << (i + 1 < roms.size() ? ",\n" : "\n");
+	}
+	out << "  ],\n";
+
+	out << "  \"micro\": [\n";
+	for (size_t i = 0; i < micros.size(); ++i)
+	{
+		const MicroResult& micro = micros[i];
+		out << "    { \"name\": ";
+		WriteJsonString(out, micro.name);
+		out << ", \"backend\": ";
+		WriteJsonString(out, micro.backend);
+		out << ", \"cycles\": " << micro.cycles
+			<< ", \"seconds\": " << micro.seconds
+			<< ", \"ips\": " << (micro.seconds > 0.0 ? micro.cycles / micro.seconds : 0.0)
+			<< ", \"ns_per_instruction\": " << (micro.cycles > 0 ? micro.seconds * 1e9 / micro.cycles : 0.0);
+		WriteCounters(out, micro.counters, micro.cycles);
+		out << " }" << (i + 1 < micros.size() ? ",\n" : "\n");
+	}
+	out << "  ]\n";
+	out << "}\n";
+}
+
+int main(int argc, char* argv[])
+{
+	// Usage: CHIP8_Benchmark [--roms directory] [--frames n] [--cycles n] [--seed n] [--out file]
+	Options options;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		const std::string arg = argv[i];
+		if (arg == "--roms")
+			options.romDirectory = argv[i + 1];
+		else if (arg == "--frames")
+			options.frames = std::atoi(argv[i + 1]);
+		else if (arg == "--cycles")
+			options.microCycles = std::atoll(argv[i + 1]);
+		else if (arg == "--seed")
+			options.seed = static_cast<unsigned int>(std::atoi(argv[i + 1]));
+		else if (arg == "--out")
+			options.outputPath = argv[i + 1];
+		else
+			std::cerr << "Unknown option " << arg << std::endl;
+	}
+
+	RomDatabase romDatabase;
+	romDatabase.Load(options.romDirectory + "/romdb.txt");
+
+	// Roms are the files without an extension, sorted so runs are comparable
+	std::vector<std::filesystem::path> romPaths;
+	std::error_code error;
+	for (const auto& file : std::filesystem::directory_iterator(options.romDirectory, error))
+	{
+		if (file.is_regular_file() && !file.path().has_extension())
+			romPaths.push_back(file.path());
+	}
+	std::sort(romPaths.begin(), romPaths.end());
+
+	// Hardware counters are best effort, without them the json only has wall clock numbers
+	PerfCounters perfCounters;
+	PerfCounters* counters = perfCounters.Open() ? &perfCounters : nullptr;
+	if (counters == nullptr)
+		std::cerr << "Hardware performance counters unavailable, check perf_event_paranoid" << std::endl;
+
+	std::vector<RomResult> romResults;
+	std::vector<MicroResult> microResults;
+
+	for (const Backend& backend : BACKENDS)
+	{
+		for (const std::filesystem::path& path : romPaths)
+		{
+			std::vector<unsigned char> rom;
+			if (!ReadFile(path.string(), rom))
+			{
+				std::cerr << "Failed to read " << path.string() << std::endl;
+				continue;
+			}
+
+			const RomProfile* profile = romDatabase.Identify(rom.data(), rom.size());
+			romResults.push_back(RunRom(path.filename().string(), rom, profile, backend, options, counters));
+
+			const RomResult& result = romResults.back();
+			std::cerr << backend.name << " " << result.name << ": " << result.instructions / result.seconds / 1e6 << " MIPS" << std::endl;
+		}
+
+		for (const MicroProgram& program : MicroPrograms())
+		{
+			microResults.push_back(RunMicro(program.name, program.opCodes, backend, options, counters));
+
+			const MicroResult& result = microResults.back();
+			std::cerr << backend.name << " micro " << result.name << ": " << result.seconds * 1e9 / result.cycles << " ns/instruction" << std::endl;
+		}
+	}
+
+	std::ofstream output(options.outputPath);
+	WriteJson(output, romResults, microResults, options, counters != nullptr);
+	if (output.fail())
+	{
+		std::cerr << "Failed to write " << options.outputPath << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,231 @@
+// Headless consistency checks of the interpreter, exits with 1 when one of them fails.
+// Build together with the interpreter sources of CHIP8_Interpreter (everything except its main.cpp), no OpenGL needed.
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../CHIP8_Interpreter/Interpreter.h"
+
+// Dispatch backends, each one configures a freshly initialized interpreter
+struct Backend
+{
+	const char* name;
+	void (*configure)(Interpreter& interpreter);
+};
+
+const Backend BACKENDS[] =
+{
+	{ "switch", [](Interpreter&) {} },
+	{ "predecoded", [](Interpreter& interpreter) { interpreter.SetPredecoded(true); } },
+	{ "fastforward", [](Interpreter& interpreter) { interpreter.SetFastForward(true); } },
+};
+
+struct Options
+{
+	std::string romDirectory = "../CHIP8_Interpreter/Resources";
+	int frames = 3600;
+};
+
+struct Program
+{
+	std::string name;
+	std::vector<unsigned char> bytes;
+};
+
+// Same input script as the benchmark: every 16 frames a key picked by a fixed LCG is held for 8 frames
+unsigned short ScriptedKeypad(int frame)
+{
+	if ((frame % 16) >= 8)
+		return 0;
+
+	const unsigned int segment = static_cast<unsigned int>(frame / 16);
+	const unsigned int key = ((segment * 1103515245u + 12345u) >> 16) & 0xF;
+	return static_cast<unsigned short>(1 << key);
+}
+
+bool ReadFile(const std::string& path, std::vector<unsigned char>& bytes)
+{
+	std::ifstream file(path, std::ios_base::binary | std::ios_base::ate);
+	if (file.fail())
+		return false;
+
+	bytes.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+	return !file.fail();
+}
+
+std::vector<unsigned char> Assemble(const std::vector<unsigned short>& opCodes)
+{
+	std::vector<unsigned char> bytes;
+	for (unsigned short opCode : opCodes)
+	{
+		bytes.push_back(static_cast<unsigned char>(opCode >> 8));
+		bytes.push_back(static_cast<unsigned char>(opCode & 0xFF));
+	}
+	return bytes;
+}
+
+// Flag writes with X or Y = F, where the flag and the result depend on each other. Each one is followed by a VF overwrite,
+// so the analysis sees the flag as dead
+std::vector<Program> EdgePrograms()
+{
+	std::vector<Program> programs;
+	const unsigned short flagWrites[] = { 0x80F4, 0x80F5, 0x80F6, 0x80F7, 0x80FE, 0x8F04, 0x8F05, 0x8F06, 0x8F07, 0x8F0E, 0xDF05, 0xFF1E };
+	for (unsigned short opCode : flagWrites)
+	{
+		static const char digits[] = "0123456789ABCDEF";
+		std::string name;
+		for (int shift = 12; shift >= 0; shift -= 4)
+			name += digits[(opCode >> shift) & 0xF];
+		programs.push_back(Program{ name, Assemble({ 0x6F05, 0x6003, 0xA000, opCode, 0x6F00, 0x1200 }) });
+	}
+	return programs;
+}
+
+// Everything in a snapshot except VF, the only register the predecoded backend may leave different
+bool SameExceptFlag(const Interpreter::Snapshot& a, const Interpreter::Snapshot& b)
+{
+	return std::equal(std::begin(a.memory), std::end(a.memory), b.memory)
+		&& std::equal(std::begin(a.screen), std::end(a.screen), b.screen)
+		&& std::equal(a.v, a.v + 0xF, b.v)
+		&& std::equal(std::begin(a.stack), std::end(a.stack), b.stack)
+		&& a.indexRegister == b.indexRegister && a.programCounter == b.programCounter && a.stackPointer == b.stackPointer
+		&& a.cycleCount == b.cycleCount && a.delayTimer == b.delayTimer && a.soundTimer == b.soundTimer;
+}
+
+// Runs a program on the switch and the predecoded backend under every combination of the quirks the flag analysis depends on,
+// returns false at the first frame where the states differ outside VF
+bool CheckPredecoded(const Program& program, int frames)
+{
+	std::unique_ptr<Interpreter::Snapshot> expected(new Interpreter::Snapshot());
+	std::unique_ptr<Interpreter::Snapshot> actual(new Interpreter::Snapshot());
+	for (int combination = 0; combination < 4; ++combination)
+	{
+		Quirks quirks;
+		quirks.shiftUsesVY = (combination & 1) != 0;
+		quirks.logicResetsVF = (combination & 2) != 0;
+
+		std::unique_ptr<Interpreter> interpreters[2] = { std::unique_ptr<Interpreter>(new Interpreter()), std::unique_ptr<Interpreter>(new Interpreter()) };
+		for (const std::unique_ptr<Interpreter>& interpreter : interpreters)
+		{
+			interpreter->Initialize();
+			interpreter->SetSoundEnabled(false);
+			interpreter->SetQuirks(quirks);
+			interpreter->LoadRom(program.bytes.data(), program.bytes.size());
+		}
+		interpreters[1]->SetPredecoded(true);
+
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			interpreters[0]->m_Keypad = interpreters[1]->m_Keypad = ScriptedKeypad(frame);
+			const bool running = interpreters[0]->RunFrame();
+			const bool predecodedRunning = interpreters[1]->RunFrame();
+
+			interpreters[0]->SaveSnapshot(*expected);
+			interpreters[1]->SaveSnapshot(*actual);
+			if (running != predecodedRunning || !SameExceptFlag(*expected, *actual))
+			{
+				std::cout << program.name << ": the predecoded backend differs at frame " << frame << " (shiftUsesVY " << quirks.shiftUsesVY
+					<< ", logicResetsVF " << quirks.logicResetsVF << ")" << std::endl;
+				return false;
+			}
+			if (!running)
+				break;
+		}
+	}
+	return true;
+}
+
+// After removing the breakpoint or watchpoint the interpreter stopped at, the next frame runs through
+bool CheckDebugStops(const Backend& backend)
+{
+	const std::vector<unsigned char> rom = Assemble({ 0xA300, 0xF033, 0x1200 }); // the FX33 at 0x202 writes 0x300
+	Interpreter interpreter;
+	interpreter.Initialize();
+	interpreter.SetSoundEnabled(false);
+	backend.configure(interpreter);
+	interpreter.LoadRom(rom.data(), rom.size());
+
+	interpreter.SetBreakpoint(0x202, true);
+	interpreter.RunFrame();
+	const bool breakpointStop = interpreter.IsAtBreakpoint();
+	interpreter.SetBreakpoint(0x202, false);
+	interpreter.RunFrame();
+	const bool breakpointResumed = !interpreter.IsAtBreakpoint();
+
+	interpreter.SetWatchpoint(0x300, Interpreter::WATCH_WRITE);
+	interpreter.RunFrame();
+	const bool watchpointStop = interpreter.IsAtWatchpoint();
+	interpreter.SetWatchpoint(0x300, 0);
+	interpreter.RunFrame();
+	const bool watchpointResumed = !interpreter.IsAtWatchpoint();
+
+	if (!breakpointStop || !breakpointResumed || !watchpointStop || !watchpointResumed)
+	{
+		std::cout << backend.name << ": a removed breakpoint or watchpoint still stops the interpreter" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	// Usage: CHIP8_Check [--roms directory] [--frames n]
+	Options options;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		const std::string arg = argv[i];
+		if (arg == "--roms")
+			options.romDirectory = argv[i + 1];
+		else if (arg == "--frames")
+			options.frames = std::atoi(argv[i + 1]);
+		else
+			std::cerr << "Unknown option " << arg << std::endl;
+	}
+
+	// Roms are the files without an extension, sorted so the output is stable
+	std::vector<std::filesystem::path> romPaths;
+	std::error_code error;
+	for (const auto& file : std::filesystem::directory_iterator(options.romDirectory, error))
+	{
+		if (file.is_regular_file() && !file.path().has_extension())
+			romPaths.push_back(file.path());
+	}
+	std::sort(romPaths.begin(), romPaths.end());
+
+	std::vector<Program> programs = EdgePrograms();
+	for (const std::filesystem::path& path : romPaths)
+	{
+		Program program{ path.filename().string(), {} };
+		if (!ReadFile(path.string(), program.bytes))
+		{
+			std::cout << "Failed to read " << path.string() << std::endl;
+			return 1;
+		}
+		programs.push_back(program);
+	}
+
+	int failed = 0;
+	for (const Program& program : programs)
+	{
+		if (!CheckPredecoded(program, options.frames))
+			++failed;
+	}
+	std::cout << "Predecoded backend: " << programs.size() - failed << " of " << programs.size() << " programs match the switch backend" << std::endl;
+
+	for (const Backend& backend : BACKENDS)
+	{
+		if (!CheckDebugStops(backend))
+			++failed;
+	}
+
+	return failed == 0 ? 0 : 1;
+}
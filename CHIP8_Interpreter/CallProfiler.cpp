@@ -0,0 +1,128 @@
+#include "CallProfiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+
+CallProfiler::CallProfiler()
+{
+	Reset();
+}
+
+CallProfiler::~CallProfiler()
+{
+}
+
+void CallProfiler::Reset()
+{
+	m_Nodes.clear();
+	m_Nodes.push_back(Node{ 0, -1, -1, -1, 0, 0, 1 });
+	m_Current = 0;
+	m_DroppedCalls = 0;
+}
+
+void CallProfiler::Enter(unsigned short address)
+{
+	Node& current = m_Nodes[m_Current];
+	if (current.depth >= MAX_DEPTH)
+	{
+		++m_DroppedCalls;
+		return;
+	}
+
+	int child = current.firstChild;
+	while (child != -1 && m_Nodes[child].address != address)
+		child = m_Nodes[child].nextSibling;
+
+	if (child == -1)
+	{
+		child = static_cast<int>(m_Nodes.size());
+		m_Nodes.push_back(Node{ address, m_Current, -1, current.firstChild, current.depth + 1, 0, 0 });
+		m_Nodes[m_Current].firstChild = child; //current may be dangling after the push_back
+	}
+
+	++m_Nodes[child].calls;
+	m_Current = child;
+}
+
+void CallProfiler::WritePath(std::ostream& out, int node) const
+{
+	if (m_Nodes[node].parent != -1)
+	{
+		WritePath(out, m_Nodes[node].parent);
+		out << ";0x" << std::hex << std::uppercase << std::setw(3) << std::setfill('0') << m_Nodes[node].address
+			<< std::dec << std::nouppercase << std::setfill(' ');
+	}
+	else
+	{
+		out << "main";
+	}
+}
+
+void CallProfiler::WriteFolded(std::ostream& out) const
+{
+	for (int i = 0; i < static_cast<int>(m_Nodes.size()); ++i)
+	{
+		if (m_Nodes[i].cycles == 0)
+			continue;
+
+		WritePath(out, i);
+		out << " " << m_Nodes[i].cycles << "\n";
+	}
+}
+
+void CallProfiler::WriteSummary(std::ostream& out) const
+{
+	struct Totals
+	{
+		unsigned long long inclusive = 0;
+		unsigned long long exclusive = 0;
+		unsigned long long calls = 0;
+	};
+
+	//Children are always created after their parent, so a reverse walk sums subtrees bottom up
+	std::vector<unsigned long long> subtree(m_Nodes.size(), 0);
+	for (int i = static_cast<int>(m_Nodes.size()) - 1; i >= 0; --i)
+	{
+		subtree[i] += m_Nodes[i].cycles;
+		if (m_Nodes[i].parent != -1)
+			subtree[m_Nodes[i].parent] += subtree[i];
+	}
+
+	std::map<unsigned short, Totals> totals;
+	for (int i = 0; i < static_cast<int>(m_Nodes.size()); ++i)
+	{
+		const Node& node = m_Nodes[i];
+		Totals& total = totals[node.address];
+		total.exclusive += node.cycles;
+		total.calls += node.calls;
+
+		//Recursive paths only count towards inclusive cycles at the outermost frame of that subroutine
+		bool recursive = false;
+		for (int parent = node.parent; parent != -1 && !recursive; parent = m_Nodes[parent].parent)
+			recursive = m_Nodes[parent].address == node.address;
+		if (!recursive)
+			total.inclusive += subtree[i];
+	}
+
+	std::vector<std::pair<unsigned short, Totals>> sorted(totals.begin(), totals.end());
+	std::sort(sorted.begin(), sorted.end(), [](const std::pair<unsigned short, Totals>& a, const std::pair<unsigned short, Totals>& b)
+	{
+		return a.second.inclusive > b.second.inclusive;
+	});
+
+	const unsigned long long all = subtree.empty() ? 0 : subtree[0];
+	out << "Subroutine      inclusive    incl%      exclusive    excl%        calls\n";
+	for (const std::pair<unsigned short, Totals>& entry : sorted)
+	{
+		const Totals& total = entry.second;
+		if (entry.first == 0)
+			out << "main ";
+		else
+			out << "0x" << std::hex << std::uppercase << std::setw(3) << std::setfill('0') << entry.first << std::dec << std::nouppercase << std::setfill(' ');
+
+		out << std::setw(15) << total.inclusive << std::setw(8) << std::fixed << std::setprecision(2) << (all ? 100.0 * total.inclusive / all : 0.0) << "%"
+			<< std::setw(15) << total.exclusive << std::setw(8) << (all ? 100.0 * total.exclusive / all : 0.0) << "%"
+			<< std::setw(13) << total.calls << "\n";
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <ostream>
+#include <vector>
+
+/* Attributes executed cycles to the guest call stack formed by 2NNN and 00EE.
+Every distinct call path is a node in a call tree, so recording is a counter increment and,
+on calls and returns, a walk to the child or parent node.
+The interpreter only calls Record when built with CHIP8_PROFILE defined.*/
+class CallProfiler
+{
+public:
+	CallProfiler();
+	~CallProfiler();
+
+	//Called for every executed opcode, before it executes
+	void Record(unsigned short opCode)
+	{
+		++m_Nodes[m_Current].cycles;
+
+		if ((opCode & 0xF000) == 0x2000)
+			Enter(opCode & 0x0FFF);
+		else if (opCode == 0x00EE && m_DroppedCalls != 0)
+			--m_DroppedCalls;
+		else if (opCode == 0x00EE && m_Current != 0)
+			m_Current = m_Nodes[m_Current].parent;
+	}
+
+	void Reset();
+
+	//One line per call path: "main;0x2A4;0x31C <cycles>", the input format of flamegraph.pl and speedscope
+	void WriteFolded(std::ostream& out) const;
+
+	//Inclusive and exclusive cycles and call counts per subroutine address, sorted by inclusive cycles
+	void WriteSummary(std::ostream& out) const;
+
+private:
+	//Deeper paths are folded into their parent, the CHIP-8 stack only has 16 entries anyway
+	static const int MAX_DEPTH = 64;
+
+	struct Node
+	{
+		unsigned short address; //subroutine entry, 0 for the root
+		int parent;
+		int firstChild;
+		int nextSibling;
+		int depth;
+		unsigned long long cycles; //exclusive
+		unsigned long long calls;
+	};
+
+	std::vector<Node> m_Nodes;
+	int m_Current = 0;
+	int m_DroppedCalls = 0; //calls past MAX_DEPTH, their returns must not leave the current node
+
+	void Enter(unsigned short address);
+	void WritePath(std::ostream& out, int node) const;
+};
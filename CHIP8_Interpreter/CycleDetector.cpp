@@ -0,0 +1,80 @@
+#include "CycleDetector.h"
+
+#include <cstring>
+
+CycleDetector::CycleDetector()
+{
+	//Snapshots are compared with memcmp, the padding has to match too
+	std::memset(&m_Checkpoint, 0, sizeof(m_Checkpoint));
+	std::memset(&m_Current, 0, sizeof(m_Current));
+}
+
+void CycleDetector::Reset()
+{
+	m_HasCheckpoint = false;
+	m_Power = 1;
+	m_Length = 0;
+	m_Period = 0;
+	m_PeriodCycles = 0;
+}
+
+bool CycleDetector::Observe(Interpreter& interpreter)
+{
+	const unsigned long long hash = interpreter.GetStateHash();
+	if (m_HasCheckpoint && interpreter.m_Keypad != m_Checkpoint.keypad)
+		Reset();
+
+	if (!m_HasCheckpoint)
+	{
+		SetCheckpoint(interpreter, hash);
+		return false;
+	}
+
+	if (m_Period != 0)
+		return true;
+
+	++m_Length;
+	if (hash == m_CheckpointHash && MatchesCheckpoint(interpreter))
+	{
+		m_Period = m_Length;
+		m_PeriodCycles = interpreter.GetCycleCount() - m_Checkpoint.cycleCount;
+		return true;
+	}
+
+	if (m_Length == m_Power)
+	{
+		SetCheckpoint(interpreter, hash);
+		m_Power *= 2;
+		m_Length = 0;
+	}
+	return false;
+}
+
+void CycleDetector::SetCheckpoint(Interpreter& interpreter, unsigned long long hash)
+{
+	interpreter.SaveSnapshot(m_Checkpoint);
+	m_CheckpointHash = hash;
+	m_HasCheckpoint = true;
+}
+
+bool CycleDetector::MatchesCheckpoint(const Interpreter& interpreter)
+{
+	//Everything but the cycle count and whether the frame drew has to be the same
+	interpreter.SaveSnapshot(m_Current);
+	m_Current.cycleCount = m_Checkpoint.cycleCount;
+	m_Current.drawFlag = m_Checkpoint.drawFlag;
+	return std::memcmp(&m_Current, &m_Checkpoint, sizeof(m_Current)) == 0;
+}
+
+unsigned long long CycleDetector::Skip(Interpreter& interpreter, unsigned long long frames) const
+{
+	if (m_Period == 0 || frames < m_Period)
+		return 0;
+
+	const unsigned long long periods = frames / m_Period;
+	Interpreter::Snapshot snapshot;
+	interpreter.SaveSnapshot(snapshot);
+	snapshot.cycleCount += periods * m_PeriodCycles;
+	interpreter.LoadSnapshot(snapshot);
+	return periods * m_Period;
+}
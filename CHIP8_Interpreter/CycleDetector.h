@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Interpreter.h"
+
+/* Finds attract loops: Brent's cycle detection over the machine state after every frame (see Interpreter::GetStateHash).
+A checkpoint is kept at frame 1, 2, 4, 8, ... frames after the last reset, a later frame with the same state and the same keypad as the
+checkpoint means the machine repeats that stretch of frames for as long as the input stays the same. A hash match is confirmed against
+the checkpoint's snapshot, so a collision can't report a cycle. Changing the keypad starts the search over.
+The period is found within a few times its length after the loop starts, a run can then be stopped or moved forward by whole periods.*/
+class CycleDetector
+{
+public:
+	CycleDetector();
+
+	void Reset();
+
+	//Call after every RunFrame, returns true once the state repeats. Enable Interpreter::SetStateHashing, a full hash per frame costs more
+	//than the frame
+	bool Observe(Interpreter& interpreter);
+
+	bool IsCycling() const { return m_Period != 0; }
+
+	//Length of the loop in frames and in instructions, 0 before it is found
+	unsigned long long GetPeriod() const { return m_Period; }
+	unsigned long long GetPeriodCycles() const { return m_PeriodCycles; }
+
+	//Moves a cycling interpreter forward by as many whole periods as fit in frames, only the cycle count changes.
+	//Returns the frames skipped, the caller runs the rest. The keypad must stay the same over the skipped frames
+	unsigned long long Skip(Interpreter& interpreter, unsigned long long frames) const;
+
+private:
+	Interpreter::Snapshot m_Checkpoint;
+	Interpreter::Snapshot m_Current;
+	unsigned long long m_CheckpointHash = 0;
+	bool m_HasCheckpoint = false;
+
+	//Brent: the checkpoint moves to the current frame when length reaches power, which then doubles
+	unsigned long long m_Power = 1;
+	unsigned long long m_Length = 0;
+
+	unsigned long long m_Period = 0;
+	unsigned long long m_PeriodCycles = 0;
+
+	void SetCheckpoint(Interpreter& interpreter, unsigned long long hash);
+	bool MatchesCheckpoint(const Interpreter& interpreter);
+};
@@ -0,0 +1,290 @@
+#include "Debugger.h"
+
+#include "Disassembler.h"
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+	bool ReadAddress(std::istream& arguments, unsigned short& address)
+	{
+		unsigned int value;
+		if (!(arguments >> std::hex >> value))
+			return false;
+
+		address = static_cast<unsigned short>(value & 0xFFF);
+		return true;
+	}
+
+	//Prints as 0x0ABC without touching the stream's formatting for later output
+	std::string Hex(unsigned int value, int digits)
+	{
+		std::ostringstream text;
+		text << "0x" << std::uppercase << std::hex << std::setw(digits) << std::setfill('0') << value;
+		return text.str();
+	}
+}
+
+Debugger::Debugger(Interpreter& interpreter)
+	: m_Interpreter(interpreter)
+{
+}
+
+bool Debugger::Prompt(std::istream& in, std::ostream& out)
+{
+	if (m_Interpreter.IsAtBreakpoint())
+		out << "Breakpoint" << std::endl;
+	if (m_Interpreter.IsAtWatchpoint())
+		PrintWatchHit(out, m_Interpreter);
+	PrintLocation(out);
+
+	std::string line;
+	while (out << "(chip8) " << std::flush, std::getline(in, line))
+	{
+		if (line.empty())
+			line = m_LastCommand;
+		m_LastCommand = line;
+
+		std::istringstream arguments(line);
+		std::string command;
+		if (!(arguments >> command))
+			continue;
+
+		bool resume = false;
+		bool quit = false;
+		if (!Execute(command, arguments, out, resume, quit))
+			out << "Unknown command " << command << ", see Debugger.h" << std::endl;
+		if (quit)
+			return false;
+		if (resume)
+			return true;
+	}
+
+	//End of input, keep running without the debugger
+	return true;
+}
+
+bool Debugger::Execute(const std::string& command, std::istream& arguments, std::ostream& out, bool& resume, bool& quit)
+{
+	if (command == "s")
+	{
+		int count = 1;
+		arguments >> std::dec >> count;
+		StepInstructions(out, count);
+	}
+	else if (command == "c")
+	{
+		//Runs the instruction under a breakpoint that was reached by stepping, RunFrame would stop at it right away
+		if (m_Interpreter.HasBreakpoint(m_Interpreter.GetProgramCounter()) && !m_Interpreter.IsAtBreakpoint())
+			m_Interpreter.Step();
+		resume = true;
+	}
+	else if (command == "rs" || command == "rc" || command == "lw")
+	{
+		TravelBack(command, arguments, out);
+	}
+	else if (command == "b")
+	{
+		unsigned short address;
+		if (ReadAddress(arguments, address))
+		{
+			m_Interpreter.SetBreakpoint(address, !m_Interpreter.HasBreakpoint(address));
+			out << (m_Interpreter.HasBreakpoint(address) ? "Set" : "Removed") << " breakpoint at " << Hex(address, 3) << std::endl;
+		}
+		else
+		{
+			for (unsigned int breakpoint = 0; breakpoint < 0x1000; ++breakpoint)
+			{
+				if (m_Interpreter.HasBreakpoint(static_cast<unsigned short>(breakpoint)))
+					out << Hex(breakpoint, 3) << std::endl;
+			}
+		}
+	}
+	else if (command == "bc")
+	{
+		m_Interpreter.ClearBreakpoints();
+	}
+	else if (command == "w")
+	{
+		unsigned short address;
+		int length = 1;
+		std::string access = "w";
+		if (ReadAddress(arguments, address))
+		{
+			arguments >> std::dec >> length >> access;
+			const int flags = ((access.find('r') != std::string::npos) ? Interpreter::WATCH_READ : 0)
+				| ((access.find('w') != std::string::npos) ? Interpreter::WATCH_WRITE : 0);
+			const bool enable = m_Interpreter.GetWatchpoint(address) != flags;
+			for (int i = 0; i < length; ++i)
+				m_Interpreter.SetWatchpoint(static_cast<unsigned short>(address + i), enable ? flags : 0);
+			out << (enable ? "Set" : "Removed") << " watchpoint at " << Hex(address, 3) << std::endl;
+		}
+		else
+		{
+			for (unsigned int watchpoint = 0; watchpoint < 0x1000; ++watchpoint)
+			{
+				const int flags = m_Interpreter.GetWatchpoint(static_cast<unsigned short>(watchpoint));
+				if (flags != 0)
+					out << Hex(watchpoint, 3) << " " << ((flags & Interpreter::WATCH_READ) ? "r" : "") << ((flags & Interpreter::WATCH_WRITE) ? "w" : "") << std::endl;
+			}
+		}
+	}
+	else if (command == "wc")
+	{
+		m_Interpreter.ClearWatchpoints();
+	}
+	else if (command == "r")
+	{
+		PrintRegisters(out);
+	}
+	else if (command == "m")
+	{
+		unsigned short address;
+		int length = 64;
+		if (!ReadAddress(arguments, address))
+			return false;
+		arguments >> std::dec >> length;
+		PrintMemory(out, address, length);
+	}
+	else if (command == "d")
+	{
+		unsigned short address;
+		int count = 10;
+		if (!ReadAddress(arguments, address))
+		{
+			PrintLocation(out);
+			return true;
+		}
+		arguments >> std::dec >> count;
+		PrintDisassembly(out, address, count);
+	}
+	else if (command == "q")
+	{
+		quit = true;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+void Debugger::TravelBack(const std::string& command, std::istream& arguments, std::ostream& out)
+{
+	if (m_TimeTravel == nullptr)
+	{
+		out << "No history is recorded" << std::endl;
+		return;
+	}
+
+	if (command == "lw")
+	{
+		unsigned short address;
+		TimeTravel::Write write;
+		if (!ReadAddress(arguments, address))
+			out << "lw needs an address" << std::endl;
+		else if (!m_TimeTravel->FindLastWrite(m_Interpreter, address, write))
+			out << "No write to " << Hex(address, 3) << " since cycle " << m_TimeTravel->GetStartCycle() << std::endl;
+		else
+			out << Hex(address, 3) << " was set to " << Hex(write.value, 2) << " at cycle " << write.cycle << " by " << Hex(write.instruction, 3) << std::endl;
+		return;
+	}
+
+	const unsigned long long cycle = m_Interpreter.GetCycleCount();
+	unsigned long long count = 1;
+	arguments >> std::dec >> count;
+	const bool moved = (command == "rs") ? m_TimeTravel->StepBack(m_Interpreter, count) : m_TimeTravel->ContinueBack(m_Interpreter);
+	if (!moved || m_Interpreter.GetCycleCount() == cycle)
+	{
+		out << ((command == "rs") ? "The history starts at cycle " : "No breakpoint or watchpoint hit since cycle ") << m_TimeTravel->GetStartCycle() << std::endl;
+		return;
+	}
+
+	out << "Back " << cycle - m_Interpreter.GetCycleCount() << " instructions to cycle " << m_Interpreter.GetCycleCount() << std::endl;
+	if (m_Interpreter.IsAtWatchpoint())
+		PrintWatchHit(out, m_Interpreter);
+	PrintLocation(out);
+}
+
+void Debugger::StepInstructions(std::ostream& out, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		if (i > 0 && m_Interpreter.HasBreakpoint(m_Interpreter.GetProgramCounter()))
+		{
+			out << "Breakpoint" << std::endl;
+			break;
+		}
+		if (!m_Interpreter.Step())
+		{
+			out << "Invalid opcode" << std::endl;
+			break;
+		}
+		if (m_Interpreter.IsAtWatchpoint())
+		{
+			PrintWatchHit(out, m_Interpreter);
+			break;
+		}
+	}
+	PrintLocation(out);
+}
+
+void Debugger::PrintLocation(std::ostream& out)
+{
+	//A few instructions of context before the program counter, CHIP-8 code is 2 byte aligned in practice
+	const unsigned short programCounter = m_Interpreter.GetProgramCounter();
+	PrintDisassembly(out, static_cast<unsigned short>(programCounter >= 6 ? programCounter - 6 : 0), 8);
+}
+
+void Debugger::PrintRegisters(std::ostream& out)
+{
+	m_Interpreter.SaveSnapshot(m_Snapshot);
+	for (int i = 0; i < 16; ++i)
+		out << "V" << std::hex << std::uppercase << i << std::dec << "=" << Hex(m_Snapshot.v[i], 2) << ((i % 8 == 7) ? "\n" : " ");
+
+	out << "I=" << Hex(m_Snapshot.indexRegister, 3) << " PC=" << Hex(m_Snapshot.programCounter, 3) << " DT=" << static_cast<int>(m_Snapshot.delayTimer)
+		<< " ST=" << static_cast<int>(m_Snapshot.soundTimer) << " keys=" << Hex(m_Snapshot.keypad, 4) << " cycle=" << m_Snapshot.cycleCount
+		<< " frame instruction=" << m_Snapshot.frameCycle << std::endl;
+
+	out << "stack:";
+	for (int i = 0; i < m_Snapshot.stackPointer && i < 16; ++i)
+		out << " " << Hex(m_Snapshot.stack[i], 3);
+	out << std::endl;
+}
+
+void Debugger::PrintMemory(std::ostream& out, unsigned short address, int length)
+{
+	m_Interpreter.SaveSnapshot(m_Snapshot);
+	for (int row = 0; row < length; row += 16)
+	{
+		out << Hex((address + row) & 0xFFF, 3) << ":";
+		for (int i = row; i < row + 16 && i < length; ++i)
+			out << " " << Hex(m_Snapshot.memory[(address + i) & 0xFFF], 2).substr(2);
+		out << std::endl;
+	}
+}
+
+void Debugger::PrintDisassembly(std::ostream& out, unsigned short address, int count)
+{
+	m_Interpreter.SaveSnapshot(m_Snapshot);
+	for (int i = 0; i < count; ++i)
+	{
+		const unsigned short current = static_cast<unsigned short>((address + i * 2) & 0xFFF);
+		const unsigned short opCode = static_cast<unsigned short>((m_Snapshot.memory[current] << 8) | m_Snapshot.memory[(current + 1) & 0xFFF]);
+		out << (current == m_Snapshot.programCounter ? "=>" : "  ") << (m_Interpreter.HasBreakpoint(current) ? "*" : " ") << Hex(current, 3)
+			<< "  " << Hex(opCode, 4).substr(2) << "  " << Disassemble(opCode) << std::endl;
+	}
+}
+
+void Debugger::PrintWatchHit(std::ostream& out, const Interpreter& interpreter)
+{
+	const Interpreter::WatchHit& hit = interpreter.GetWatchHit();
+	Interpreter::Snapshot snapshot;
+	interpreter.SaveSnapshot(snapshot);
+	const unsigned short opCode = static_cast<unsigned short>((snapshot.memory[hit.instruction & 0xFFF] << 8) | snapshot.memory[(hit.instruction + 1) & 0xFFF]);
+
+	out << ((hit.access == Interpreter::WATCH_WRITE) ? "write " : "read ") << Hex(hit.value, 2) << ((hit.access == Interpreter::WATCH_WRITE) ? " to " : " from ")
+		<< Hex(hit.address, 3) << " by " << Hex(hit.instruction, 3) << ": " << Disassemble(opCode) << std::endl;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <iosfwd>
+#include <string>
+
+#include "Interpreter.h"
+#include "TimeTravel.h"
+
+/* Console debugger: the frontend calls Prompt when a breakpoint or watchpoint is hit or the user pauses, the emulation is stopped meanwhile.
+Breakpoints and watchpoints live in the interpreter (see Interpreter::SetBreakpoint) so RunFrame keeps its fast loop while none are set.
+Going backwards needs the history of a TimeTravel that the frontend records.
+Commands:
+	s [n]			step n instructions (default 1), stops early at a breakpoint or watchpoint
+	c				continue
+	rs [n]			step back n instructions (default 1)
+	rc				continue backwards to the last breakpoint or watchpoint hit
+	lw addr			find the last instruction that wrote addr
+	b [addr]		toggle a breakpoint, without address list them
+	bc				clear all breakpoints
+	w [addr] [len] [r|w|rw]	watch len bytes (default 1) for writes (default) or reads, rw watches both and the same command again removes it.
+					Without address list them
+	wc				clear all watchpoints
+	r				registers, timers and stack
+	m addr [len]	memory dump, len bytes (default 64)
+	d [addr] [n]	disassemble n instructions (default around the program counter)
+	q				quit the emulator
+An empty line repeats the previous command. Addresses are hexadecimal.*/
+class Debugger
+{
+public:
+	explicit Debugger(Interpreter& interpreter);
+
+	Debugger(const Debugger&) = delete;
+	Debugger& operator=(const Debugger&) = delete;
+
+	void SetTimeTravel(TimeTravel* timeTravel) { m_TimeTravel = timeTravel; }
+
+	//Reads commands until one resumes the emulation, returns false when the user quits
+	bool Prompt(std::istream& in, std::ostream& out);
+
+	void PrintRegisters(std::ostream& out);
+	void PrintMemory(std::ostream& out, unsigned short address, int length);
+	void PrintDisassembly(std::ostream& out, unsigned short address, int count);
+
+	//Prints the access that stopped the interpreter, as "write 0x05 to 0x3A0 by 0x2F4: LD [I], V3"
+	static void PrintWatchHit(std::ostream& out, const Interpreter& interpreter);
+
+private:
+	Interpreter& m_Interpreter;
+	TimeTravel* m_TimeTravel = nullptr;
+	Interpreter::Snapshot m_Snapshot = {}; //state the views print, refreshed by each of them
+	std::string m_LastCommand;
+
+	//Returns false when the command is unknown, resume is set by the commands that leave the prompt
+	bool Execute(const std::string& command, std::istream& arguments, std::ostream& out, bool& resume, bool& quit);
+
+	void PrintLocation(std::ostream& out);
+	void StepInstructions(std::ostream& out, int count);
+	void TravelBack(const std::string& command, std::istream& arguments, std::ostream& out);
+};
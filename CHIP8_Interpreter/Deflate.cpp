@@ -0,0 +1,167 @@
+#include "Deflate.h"
+
+#include <algorithm>
+
+namespace
+{
+	const int HASH_BITS = 15;
+	const size_t WINDOW_SIZE = 32768;
+	const size_t MIN_MATCH = 3;
+	const size_t MAX_MATCH = 258;
+	const size_t NO_POSITION = ~static_cast<size_t>(0);
+
+	const unsigned short LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const unsigned char LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const unsigned short DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+		4097, 6145, 8193, 12289, 16385, 24577 };
+	const unsigned char DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	//Deflate packs bits starting at the least significant bit of each byte
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(std::vector<unsigned char>& out) : m_Out(out) {}
+
+		void Write(unsigned int value, int count)
+		{
+			m_Buffer |= static_cast<unsigned long long>(value) << m_Count;
+			m_Count += count;
+			while (m_Count >= 8)
+			{
+				m_Out.push_back(static_cast<unsigned char>(m_Buffer));
+				m_Buffer >>= 8;
+				m_Count -= 8;
+			}
+		}
+
+		//Huffman codes are stored starting at their most significant bit
+		void WriteCode(unsigned int code, int length)
+		{
+			unsigned int reversed = 0;
+			for (int i = 0; i < length; ++i)
+				reversed |= ((code >> i) & 1) << (length - 1 - i);
+			Write(reversed, length);
+		}
+
+		void Flush()
+		{
+			if (m_Count > 0)
+				m_Out.push_back(static_cast<unsigned char>(m_Buffer));
+			m_Buffer = 0;
+			m_Count = 0;
+		}
+
+	private:
+		std::vector<unsigned char>& m_Out;
+		unsigned long long m_Buffer = 0;
+		int m_Count = 0;
+	};
+
+	void WriteSymbol(BitWriter& bits, int symbol)
+	{
+		if (symbol < 144)
+			bits.WriteCode(0x30 + symbol, 8);
+		else if (symbol < 256)
+			bits.WriteCode(0x190 + symbol - 144, 9);
+		else if (symbol < 280)
+			bits.WriteCode(symbol - 256, 7);
+		else
+			bits.WriteCode(0xC0 + symbol - 280, 8);
+	}
+
+	void WriteMatch(BitWriter& bits, size_t length, size_t distance)
+	{
+		int lengthCode = 28;
+		while (LENGTH_BASE[lengthCode] > length)
+			--lengthCode;
+		WriteSymbol(bits, 257 + lengthCode);
+		bits.Write(static_cast<unsigned int>(length - LENGTH_BASE[lengthCode]), LENGTH_EXTRA[lengthCode]);
+
+		int distanceCode = 29;
+		while (DISTANCE_BASE[distanceCode] > distance)
+			--distanceCode;
+		bits.WriteCode(distanceCode, 5);
+		bits.Write(static_cast<unsigned int>(distance - DISTANCE_BASE[distanceCode]), DISTANCE_EXTRA[distanceCode]);
+	}
+
+	unsigned int Hash(const unsigned char* data)
+	{
+		const unsigned int key = data[0] | (data[1] << 8) | (data[2] << 16);
+		return (key * 2654435761u) >> (32 - HASH_BITS);
+	}
+
+	unsigned int Adler32(const unsigned char* data, size_t size)
+	{
+		unsigned int a = 1;
+		unsigned int b = 0;
+		while (size > 0)
+		{
+			//The largest block whose sums can't overflow before the modulo
+			const size_t block = std::min(size, static_cast<size_t>(5552));
+			for (size_t i = 0; i < block; ++i)
+			{
+				a += data[i];
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+			data += block;
+			size -= block;
+		}
+		return (b << 16) | a;
+	}
+}
+
+void ZlibCompress(const unsigned char* data, size_t size, std::vector<unsigned char>& out)
+{
+	//32K window, no preset dictionary, fastest compression level
+	out.push_back(0x78);
+	out.push_back(0x01);
+
+	BitWriter bits(out);
+	bits.Write(1, 1); //final block
+	bits.Write(1, 2); //fixed Huffman codes
+
+	std::vector<size_t> head(static_cast<size_t>(1) << HASH_BITS, NO_POSITION);
+	size_t position = 0;
+	while (position < size)
+	{
+		size_t length = 0;
+		size_t distance = 0;
+		if (size - position >= MIN_MATCH)
+		{
+			const unsigned int hash = Hash(data + position);
+			const size_t candidate = head[hash];
+			head[hash] = position;
+
+			if (candidate != NO_POSITION && position - candidate <= WINDOW_SIZE)
+			{
+				const size_t limit = std::min(MAX_MATCH, size - position);
+				while (length < limit && data[candidate + length] == data[position + length])
+					++length;
+				distance = position - candidate;
+			}
+		}
+
+		if (length >= MIN_MATCH)
+		{
+			WriteMatch(bits, length, distance);
+
+			//The positions inside the match stay findable
+			for (size_t i = 1; i < length && position + i + MIN_MATCH <= size; ++i)
+				head[Hash(data + position + i)] = position + i;
+			position += length;
+		}
+		else
+		{
+			WriteSymbol(bits, data[position]);
+			++position;
+		}
+	}
+	WriteSymbol(bits, 256);
+	bits.Flush();
+
+	const unsigned int adler = Adler32(data, size);
+	for (int i = 3; i >= 0; --i)
+		out.push_back(static_cast<unsigned char>(adler >> (i * 8)));
+}
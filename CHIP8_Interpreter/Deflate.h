@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/* Minimal zlib stream encoder (RFC 1950/1951) for the PNG writer, the project has no zlib dependency.
+It emits a single block with the fixed Huffman codes and greedy LZ77 matches found through a hash of the next 3 bytes.
+That is far from zlib's ratio on general data, but upscaled emulator frames are long runs and repeated rows,
+which this catches, at a fraction of the code.*/
+
+//Appends the zlib stream of data to out
+void ZlibCompress(const unsigned char* data, size_t size, std::vector<unsigned char>& out);
@@ -0,0 +1,128 @@
+#include "DeltaCodec.h"
+
+#include <cstring>
+
+namespace
+{
+	//Short unchanged stretches are cheaper to keep in the changed bytes than to split the run
+	const size_t MIN_UNCHANGED_RUN = 4;
+
+	unsigned char ReferenceAt(const unsigned char* reference, size_t index)
+	{
+		return (reference != nullptr) ? reference[index] : 0;
+	}
+
+	//Length of the unchanged run starting at index, compared 8 bytes at a time
+	size_t UnchangedRun(const unsigned char* current, const unsigned char* reference, size_t index, size_t size)
+	{
+		size_t end = index;
+		while (end + 8 <= size)
+		{
+			unsigned long long a;
+			unsigned long long b = 0;
+			std::memcpy(&a, current + end, 8);
+			if (reference != nullptr)
+				std::memcpy(&b, reference + end, 8);
+			if (a != b)
+				break;
+			end += 8;
+		}
+
+		while (end < size && current[end] == ReferenceAt(reference, end))
+			++end;
+		return end - index;
+	}
+}
+
+void WriteVarint(std::vector<unsigned char>& out, unsigned long long value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back(static_cast<unsigned char>(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<unsigned char>(value));
+}
+
+bool ReadVarint(const unsigned char* data, size_t size, size_t& position, unsigned long long& value)
+{
+	value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		if (position >= size)
+			return false;
+
+		const unsigned char byte = data[position++];
+		value |= static_cast<unsigned long long>(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0)
+			return true;
+	}
+	return false;
+}
+
+void DeltaEncode(const unsigned char* current, const unsigned char* reference, size_t size, std::vector<unsigned char>& out)
+{
+	size_t index = 0;
+	while (index < size)
+	{
+		const size_t unchanged = UnchangedRun(current, reference, index, size);
+		index += unchanged;
+		if (index == size)
+			break;
+
+		//Changed bytes run until the next unchanged run that is long enough to be worth a new pair
+		const size_t changedStart = index;
+		while (index < size)
+		{
+			if (current[index] != ReferenceAt(reference, index))
+			{
+				++index;
+				continue;
+			}
+
+			const size_t run = UnchangedRun(current, reference, index, size);
+			if (run >= MIN_UNCHANGED_RUN || index + run == size)
+				break;
+			index += run;
+		}
+
+		WriteVarint(out, unchanged);
+		WriteVarint(out, index - changedStart);
+		for (size_t i = changedStart; i < index; ++i)
+			out.push_back(current[i] ^ ReferenceAt(reference, i));
+	}
+}
+
+bool DeltaDecode(const unsigned char* delta, size_t deltaSize, const unsigned char* reference, unsigned char* out, size_t size)
+{
+	size_t position = 0;
+	size_t index = 0;
+	while (position < deltaSize)
+	{
+		unsigned long long unchanged;
+		unsigned long long changed;
+		if (!ReadVarint(delta, deltaSize, position, unchanged) || !ReadVarint(delta, deltaSize, position, changed))
+			return false;
+		if (unchanged > size - index || changed > size - index - unchanged || changed > deltaSize - position)
+			return false;
+
+		if (reference != nullptr)
+			std::memcpy(out + index, reference + index, static_cast<size_t>(unchanged));
+		else
+			std::memset(out + index, 0, static_cast<size_t>(unchanged));
+		index += static_cast<size_t>(unchanged);
+
+		for (size_t i = 0; i < changed; ++i, ++index)
+			out[index] = delta[position++] ^ ReferenceAt(reference, index);
+	}
+
+	//A buffer that ends unchanged has no trailing pair
+	if (index < size)
+	{
+		if (reference != nullptr)
+			std::memcpy(out + index, reference + index, size - index);
+		else
+			std::memset(out + index, 0, size - index);
+	}
+	return true;
+}
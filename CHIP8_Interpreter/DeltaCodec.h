@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/* XOR delta of a buffer against a reference of the same size, with runs of unchanged bytes run length encoded.
+The encoding is a list of (unchanged count, changed count, changed bytes XOR reference) with both counts as LEB128 varints.
+A null reference is all zeros, which turns the delta into plain zero run compression (used for keyframes).*/
+
+//Appends the delta of current against reference to out
+void DeltaEncode(const unsigned char* current, const unsigned char* reference, size_t size, std::vector<unsigned char>& out);
+
+//Rebuilds size bytes into out from reference and the delta, returns false when the delta is corrupt or for another size
+bool DeltaDecode(const unsigned char* delta, size_t deltaSize, const unsigned char* reference, unsigned char* out, size_t size);
+
+void WriteVarint(std::vector<unsigned char>& out, unsigned long long value);
+
+//Reads a varint at data[position] and advances position, returns false when it runs past size
+bool ReadVarint(const unsigned char* data, size_t size, size_t& position, unsigned long long& value);
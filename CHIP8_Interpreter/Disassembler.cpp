@@ -0,0 +1,78 @@
+#include "Disassembler.h"
+
+#include <cstdio>
+
+namespace
+{
+	std::string Format(const char* format, int a = 0, int b = 0, int c = 0)
+	{
+		char text[32];
+		std::snprintf(text, sizeof(text), format, a, b, c);
+		return text;
+	}
+}
+
+std::string Disassemble(unsigned short opCode)
+{
+	const int x = (opCode & 0x0F00) >> 8;
+	const int y = (opCode & 0x00F0) >> 4;
+	const int n = opCode & 0x000F;
+	const int nn = opCode & 0x00FF;
+	const int nnn = opCode & 0x0FFF;
+
+	switch (opCode & 0xF000)
+	{
+	case 0x0000:
+		if (opCode == 0x00E0)
+			return "CLS";
+		if (opCode == 0x00EE)
+			return "RET";
+		break;
+	case 0x1000: return Format("JP 0x%03X", nnn);
+	case 0x2000: return Format("CALL 0x%03X", nnn);
+	case 0x3000: return Format("SE V%X, 0x%02X", x, nn);
+	case 0x4000: return Format("SNE V%X, 0x%02X", x, nn);
+	case 0x5000:
+		if (n == 0)
+			return Format("SE V%X, V%X", x, y);
+		break;
+	case 0x6000: return Format("LD V%X, 0x%02X", x, nn);
+	case 0x7000: return Format("ADD V%X, 0x%02X", x, nn);
+	case 0x8000:
+	{
+		static const char* const ALU[16] = { "LD", "OR", "AND", "XOR", "ADD", "SUB", "SHR", "SUBN", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, "SHL", nullptr };
+		if (ALU[n] != nullptr)
+			return std::string(ALU[n]) + Format(" V%X, V%X", x, y);
+		break;
+	}
+	case 0x9000:
+		if (n == 0)
+			return Format("SNE V%X, V%X", x, y);
+		break;
+	case 0xA000: return Format("LD I, 0x%03X", nnn);
+	case 0xB000: return Format("JP V0, 0x%03X", nnn);
+	case 0xC000: return Format("RND V%X, 0x%02X", x, nn);
+	case 0xD000: return Format("DRW V%X, V%X, %d", x, y, n);
+	case 0xE000:
+		if (nn == 0x9E)
+			return Format("SKP V%X", x);
+		if (nn == 0xA1)
+			return Format("SKNP V%X", x);
+		break;
+	case 0xF000:
+		switch (nn)
+		{
+		case 0x07: return Format("LD V%X, DT", x);
+		case 0x0A: return Format("LD V%X, K", x);
+		case 0x15: return Format("LD DT, V%X", x);
+		case 0x18: return Format("LD ST, V%X", x);
+		case 0x1E: return Format("ADD I, V%X", x);
+		case 0x29: return Format("LD F, V%X", x);
+		case 0x33: return Format("LD B, V%X", x);
+		case 0x55: return Format("LD [I], V%X", x);
+		case 0x65: return Format("LD V%X, [I]", x);
+		}
+		break;
+	}
+	return Format("DW 0x%04X", opCode);
+}
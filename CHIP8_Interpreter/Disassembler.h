@@ -0,0 +1,7 @@
+#pragma once
+
+#include <string>
+
+/* CHIP-8 mnemonics in the style of Cowgod's reference, e.g. "LD V3, 0x1F" or "DRW V0, V1, 5".
+Words that aren't a known instruction (data, MEGA-CHIP extensions) come out as "DW 0x1234".*/
+std::string Disassemble(unsigned short opCode);
@@ -0,0 +1,179 @@
+#include "FrameStreamServer.h"
+
+#include "DeltaCodec.h"
+
+#include <algorithm>
+
+namespace
+{
+	void WriteLittleEndian(std::vector<unsigned char>& out, unsigned int value, int bytes)
+	{
+		for (int i = 0; i < bytes; ++i)
+			out.push_back(static_cast<unsigned char>(value >> (i * 8)));
+	}
+}
+
+FrameStreamServer::FrameStreamServer()
+{
+	std::vector<unsigned char> hello = { 'C', '8', 'F', 'S' };
+	WriteLittleEndian(hello, STREAM_VERSION, 2);
+	WriteLittleEndian(hello, 64, 2);
+	WriteLittleEndian(hello, 32, 2);
+	m_Hello = std::make_shared<const std::vector<unsigned char>>(std::move(hello));
+}
+
+FrameStreamServer::~FrameStreamServer()
+{
+	Close();
+}
+
+bool FrameStreamServer::OpenTcp(unsigned short port)
+{
+	return m_TcpListener.OpenTcp(port);
+}
+
+bool FrameStreamServer::OpenUnix(const std::string& path)
+{
+	return m_UnixListener.OpenUnix(path);
+}
+
+void FrameStreamServer::Close()
+{
+	for (Client& client : m_Clients)
+		CloseSocket(client.socket);
+	m_Clients.clear();
+
+	m_TcpListener.Close();
+	m_UnixListener.Close();
+	m_HasPrevious = false;
+}
+
+bool FrameStreamServer::IsOpen() const
+{
+	return m_TcpListener.IsOpen() || m_UnixListener.IsOpen();
+}
+
+void FrameStreamServer::AcceptClients(StreamListener& listener)
+{
+	SocketHandle socket;
+	while ((socket = listener.Accept()) != NO_SOCKET)
+	{
+		//The backlog has to build up in the queue, where it is noticed, rather than in the kernel
+		SetSendBufferSize(socket, static_cast<int>(MAX_QUEUED_BYTES));
+		m_Clients.push_back(Client{ socket, {}, 0, 0, true });
+		Queue(m_Clients.back(), m_Hello);
+	}
+}
+
+FrameStreamServer::Message FrameStreamServer::Encode(unsigned char type, const unsigned char* screen, const unsigned char* reference,
+	unsigned char soundTimer)
+{
+	std::vector<unsigned char> bytes;
+	bytes.reserve(MESSAGE_HEADER_SIZE + Interpreter::PACKED_SCREEN_SIZE);
+	bytes.push_back(type);
+	WriteLittleEndian(bytes, m_Frame, 4);
+	bytes.push_back(soundTimer);
+	WriteLittleEndian(bytes, 0, 4); //payload size, patched below
+
+	DeltaEncode(screen, reference, Interpreter::PACKED_SCREEN_SIZE, bytes);
+	const unsigned int payloadSize = static_cast<unsigned int>(bytes.size() - MESSAGE_HEADER_SIZE);
+	for (int i = 0; i < 4; ++i)
+		bytes[6 + i] = static_cast<unsigned char>(payloadSize >> (i * 8));
+
+	++m_EncodedFrames;
+	m_EncodedBytes += bytes.size();
+	return std::make_shared<const std::vector<unsigned char>>(std::move(bytes));
+}
+
+void FrameStreamServer::Queue(Client& client, const Message& message)
+{
+	client.queue.push_back(message);
+	client.queuedBytes += message->size();
+}
+
+void FrameStreamServer::Update(const Interpreter& interpreter)
+{
+	AcceptClients(m_TcpListener);
+	AcceptClients(m_UnixListener);
+
+	//Nobody to encode for, the next client starts with a keyframe anyway
+	if (m_Clients.empty())
+	{
+		m_HasPrevious = false;
+		++m_Frame;
+		return;
+	}
+
+	unsigned char screen[Interpreter::PACKED_SCREEN_SIZE];
+	interpreter.PackScreen(screen);
+	const unsigned char soundTimer = interpreter.GetSoundTimer();
+
+	//Each message is built at most once per frame and shared by every client that needs it
+	Message keyframe;
+	Message delta;
+	for (Client& client : m_Clients)
+	{
+		if (client.needsKeyframe || !m_HasPrevious)
+		{
+			if (!keyframe)
+				keyframe = Encode(MESSAGE_KEYFRAME, screen, nullptr, soundTimer);
+			Queue(client, keyframe);
+			client.needsKeyframe = false;
+		}
+		else
+		{
+			if (!delta)
+				delta = Encode(MESSAGE_DELTA, screen, m_Previous, soundTimer);
+			Queue(client, delta);
+		}
+	}
+	std::copy(screen, screen + Interpreter::PACKED_SCREEN_SIZE, m_Previous);
+	m_HasPrevious = true;
+	++m_Frame;
+
+	for (size_t i = 0; i < m_Clients.size();)
+	{
+		Client& client = m_Clients[i];
+		if (!Flush(client))
+		{
+			CloseSocket(client.socket);
+			if (i + 1 < m_Clients.size())
+				m_Clients[i] = std::move(m_Clients.back());
+			m_Clients.pop_back();
+			continue;
+		}
+
+		//Too far behind to catch up, drop the backlog but finish the message that is half written
+		if (client.queuedBytes > MAX_QUEUED_BYTES)
+		{
+			const size_t keep = (client.offset > 0) ? 1 : 0;
+			client.queue.resize(keep);
+			client.queuedBytes = (keep > 0) ? client.queue.front()->size() : 0;
+			client.needsKeyframe = true;
+			++m_ResyncCount;
+		}
+		++i;
+	}
+}
+
+bool FrameStreamServer::Flush(Client& client)
+{
+	while (!client.queue.empty())
+	{
+		const std::vector<unsigned char>& message = *client.queue.front();
+		const int sent = SendSome(client.socket, message.data() + client.offset, message.size() - client.offset);
+		if (sent < 0)
+			return false;
+		if (sent == 0)
+			return true;
+
+		client.offset += sent;
+		if (client.offset == message.size())
+		{
+			client.queuedBytes -= message.size();
+			client.offset = 0;
+			client.queue.pop_front();
+		}
+	}
+	return true;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Interpreter.h"
+#include "Socket.h"
+
+/* Streams the display to any number of spectators over TCP or a Unix domain socket.
+Every frame is packed to 1 bit per pixel and encoded once as a DeltaEncode of the previous frame (see DeltaCodec.h),
+the same buffer is then queued on every client, so more spectators only cost socket writes.
+A client that joins gets a keyframe (the delta against an all zero screen) first, a client whose queue grows past
+MAX_QUEUED_BYTES has its backlog dropped and continues from a fresh keyframe.
+Stream (little endian): hello "C8FS", u16 version, u16 width, u16 height,
+then per frame u8 type (1 keyframe, 2 delta), u32 frame, u8 sound timer, u32 payload size, payload*/
+class FrameStreamServer
+{
+public:
+	static const unsigned short STREAM_VERSION = 1;
+	static const unsigned char MESSAGE_KEYFRAME = 1;
+	static const unsigned char MESSAGE_DELTA = 2;
+	static const size_t HELLO_SIZE = 10;
+	static const size_t MESSAGE_HEADER_SIZE = 10;
+
+	//Seconds of frames even when the whole display changes every frame, a client further behind is resynced
+	static const size_t MAX_QUEUED_BYTES = 64 * 1024;
+
+	FrameStreamServer();
+	~FrameStreamServer();
+
+	FrameStreamServer(const FrameStreamServer&) = delete;
+	FrameStreamServer& operator=(const FrameStreamServer&) = delete;
+
+	//Both can be open at the same time
+	bool OpenTcp(unsigned short port);
+	bool OpenUnix(const std::string& path);
+	void Close();
+	bool IsOpen() const;
+
+	//Call once per host frame after the interpreter ran: accepts clients, encodes the display and writes what the sockets take
+	void Update(const Interpreter& interpreter);
+
+	size_t GetClientCount() const { return m_Clients.size(); }
+	unsigned short GetTcpPort() const { return m_TcpListener.GetLocalPort(); }
+
+	unsigned int GetFrame() const { return m_Frame; }
+	unsigned long long GetEncodedFrames() const { return m_EncodedFrames; }
+	unsigned long long GetEncodedBytes() const { return m_EncodedBytes; }
+	unsigned long long GetResyncCount() const { return m_ResyncCount; }
+
+private:
+	typedef std::shared_ptr<const std::vector<unsigned char>> Message;
+
+	struct Client
+	{
+		SocketHandle socket;
+		std::deque<Message> queue;
+		size_t offset; //bytes of the front message already written
+		size_t queuedBytes;
+		bool needsKeyframe;
+	};
+
+	StreamListener m_TcpListener;
+	StreamListener m_UnixListener;
+	std::vector<Client> m_Clients;
+	Message m_Hello;
+
+	unsigned char m_Previous[Interpreter::PACKED_SCREEN_SIZE] = {};
+	bool m_HasPrevious = false; //false while nobody watched the last frame
+	unsigned int m_Frame = 0;
+
+	unsigned long long m_EncodedFrames = 0;
+	unsigned long long m_EncodedBytes = 0;
+	unsigned long long m_ResyncCount = 0;
+
+	void AcceptClients(StreamListener& listener);
+	Message Encode(unsigned char type, const unsigned char* screen, const unsigned char* reference, unsigned char soundTimer);
+	void Queue(Client& client, const Message& message);
+
+	//Returns false when the connection is gone
+	bool Flush(Client& client);
+};
@@ -0,0 +1,158 @@
+#include "HostProfiler.h"
+
+#include <chrono>
+#include <cstring>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define CHIP8_HAS_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CHIP8_HAS_RDTSC
+#endif
+
+namespace
+{
+	const char* const ZONE_NAMES[ZONE_COUNT] = { "Events", "Input", "Cycle", "RunAhead", "Upload", "Swap" };
+
+	long long MonotonicNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+}
+
+HostProfiler& HostProfiler::Get()
+{
+	static HostProfiler profiler;
+	return profiler;
+}
+
+HostProfiler::HostProfiler()
+	: m_Written(0)
+{
+	for (Slot& slot : m_Slots)
+		slot.sequence.store(0, std::memory_order_relaxed);
+
+	std::memset(&m_Current, 0, sizeof(m_Current));
+	m_OriginTicks = Now();
+	m_OriginNs = MonotonicNs();
+}
+
+unsigned long long HostProfiler::Now()
+{
+#ifdef CHIP8_HAS_RDTSC
+	return __rdtsc();
+#else
+	return static_cast<unsigned long long>(MonotonicNs());
+#endif
+}
+
+const char* HostProfiler::GetZoneName(HostZone zone)
+{
+	return ZONE_NAMES[zone];
+}
+
+void HostProfiler::BeginFrame()
+{
+	const unsigned long long frame = m_Current.frame;
+	std::memset(&m_Current, 0, sizeof(m_Current));
+	m_Current.frame = frame;
+	m_Current.start = Now();
+}
+
+void HostProfiler::EndFrame()
+{
+	m_Current.end = Now();
+
+	//Never blocks: the oldest frame is overwritten, readers detect torn slots through the sequence
+	const unsigned long long frame = m_Current.frame;
+	Slot& slot = m_Slots[frame % CAPACITY];
+	slot.sequence.store(frame * 2 + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.stats = m_Current;
+	slot.sequence.store(frame * 2 + 2, std::memory_order_release);
+	m_Written.store(frame + 1, std::memory_order_release);
+
+	++m_Current.frame;
+}
+
+void HostProfiler::CopyFrames(std::vector<FrameStats>& frames) const
+{
+	const unsigned long long written = m_Written.load(std::memory_order_acquire);
+	const unsigned long long first = (written > CAPACITY) ? written - CAPACITY : 0;
+
+	for (unsigned long long frame = first; frame < written; ++frame)
+	{
+		const Slot& slot = m_Slots[frame % CAPACITY];
+		const unsigned long long before = slot.sequence.load(std::memory_order_acquire);
+		if (before != frame * 2 + 2)
+			continue;
+
+		FrameStats stats = slot.stats;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.sequence.load(std::memory_order_relaxed) == before)
+			frames.push_back(stats);
+	}
+}
+
+double HostProfiler::NsPerTick() const
+{
+	//The calibration interval is the whole run, which is long enough for RDTSC to be accurate
+	const unsigned long long ticks = Now();
+	const long long ns = MonotonicNs();
+	if (ticks == m_OriginTicks)
+		return 1.0;
+	return static_cast<double>(ns - m_OriginNs) / static_cast<double>(ticks - m_OriginTicks);
+}
+
+void HostProfiler::WriteCsv(std::ostream& out) const
+{
+	const double scale = NsPerTick();
+
+	std::vector<FrameStats> frames;
+	CopyFrames(frames);
+
+	out << "frame,frame_ns";
+	for (int zone = 0; zone < ZONE_COUNT; ++zone)
+		out << "," << ZONE_NAMES[zone] << "_ns";
+	out << "\n";
+
+	for (const FrameStats& frame : frames)
+	{
+		out << frame.frame << "," << static_cast<long long>((frame.end - frame.start) * scale);
+		for (int zone = 0; zone < ZONE_COUNT; ++zone)
+			out << "," << static_cast<long long>(frame.zones[zone].ticks * scale);
+		out << "\n";
+	}
+}
+
+void HostProfiler::WriteChromeTrace(std::ostream& out) const
+{
+	const double scale = NsPerTick();
+
+	std::vector<FrameStats> frames;
+	CopyFrames(frames);
+
+	//Microsecond timestamps relative to the profiler creation, zones are drawn at their first entry with their total duration
+	auto micros = [&](unsigned long long value) { return (static_cast<double>(value) - static_cast<double>(m_OriginTicks)) * scale / 1000.0; };
+
+	out << "{\"traceEvents\":[\n";
+	bool first = true;
+	for (const FrameStats& frame : frames)
+	{
+		out << (first ? "" : ",\n") << "{\"name\":\"Frame " << frame.frame << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << micros(frame.start)
+			<< ",\"dur\":" << (frame.end - frame.start) * scale / 1000.0 << "}";
+		first = false;
+
+		for (int zone = 0; zone < ZONE_COUNT; ++zone)
+		{
+			const ZoneStats& stats = frame.zones[zone];
+			if (stats.count == 0)
+				continue;
+
+			out << ",\n{\"name\":\"" << ZONE_NAMES[zone] << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << micros(stats.start)
+				<< ",\"dur\":" << stats.ticks * scale / 1000.0 << ",\"args\":{\"count\":" << stats.count << "}}";
+		}
+	}
+	out << "\n]}\n";
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <ostream>
+#include <vector>
+
+/* Host side timing zones, aggregated per frame.
+Zones are only recorded when built with CHIP8_HOST_ZONES defined, otherwise the macros below expand to nothing.
+Time is read with RDTSC on x86 and the monotonic clock elsewhere, and converted to nanoseconds when dumping.*/
+enum HostZone
+{
+	ZONE_EVENTS, //glfwPollEvents
+	ZONE_INPUT, //SetInput
+	ZONE_CYCLE, //running the interpreter for a frame
+	ZONE_RUNAHEAD, //simulating the run-ahead frames
+	ZONE_UPLOAD, //texture upload in Draw
+	ZONE_SWAP, //glfwSwapBuffers
+	ZONE_COUNT
+};
+
+class HostProfiler
+{
+public:
+	struct ZoneStats
+	{
+		unsigned long long start; //first entry of the zone in the frame
+		unsigned long long ticks; //total time spent in the zone in the frame
+		unsigned int count;
+	};
+
+	struct FrameStats
+	{
+		unsigned long long frame;
+		unsigned long long start;
+		unsigned long long end;
+		ZoneStats zones[ZONE_COUNT];
+	};
+
+	static HostProfiler& Get();
+	static unsigned long long Now();
+	static const char* GetZoneName(HostZone zone);
+
+	//Producer side, only called from the thread running the frame loop
+	void BeginFrame();
+	void EndFrame();
+	void AddZone(HostZone zone, unsigned long long start, unsigned long long end)
+	{
+		ZoneStats& stats = m_Current.zones[zone];
+		if (stats.count++ == 0)
+			stats.start = start;
+		stats.ticks += end - start;
+	}
+
+	//Consumer side, safe from any thread: copies the most recent frames (up to CAPACITY) that are complete
+	void CopyFrames(std::vector<FrameStats>& frames) const;
+
+	void WriteCsv(std::ostream& out) const;
+	void WriteChromeTrace(std::ostream& out) const;
+
+private:
+	HostProfiler();
+
+	//Power of two, about 68 seconds of history at 60 frames per second
+	static const unsigned int CAPACITY = 4096;
+
+	//Each slot is a seqlock: the sequence is odd while the producer writes the stats
+	struct Slot
+	{
+		std::atomic<unsigned long long> sequence;
+		FrameStats stats;
+	};
+
+	Slot m_Slots[CAPACITY];
+	std::atomic<unsigned long long> m_Written;
+	FrameStats m_Current;
+
+	//Reference points to convert ticks to nanoseconds
+	unsigned long long m_OriginTicks;
+	long long m_OriginNs;
+
+	double NsPerTick() const;
+};
+
+class ScopedZone
+{
+public:
+	explicit ScopedZone(HostZone zone) : m_Zone(zone), m_Start(HostProfiler::Now()) {}
+	~ScopedZone() { HostProfiler::Get().AddZone(m_Zone, m_Start, HostProfiler::Now()); }
+
+private:
+	HostZone m_Zone;
+	unsigned long long m_Start;
+};
+
+#ifdef CHIP8_HOST_ZONES
+#define CHIP8_ZONE_CONCAT_INNER(a, b) a##b
+#define CHIP8_ZONE_CONCAT(a, b) CHIP8_ZONE_CONCAT_INNER(a, b)
+#define CHIP8_ZONE(zone) ScopedZone CHIP8_ZONE_CONCAT(scopedZone, __LINE__)(zone)
+#define CHIP8_FRAME_BEGIN() HostProfiler::Get().BeginFrame()
+#define CHIP8_FRAME_END() HostProfiler::Get().EndFrame()
+#else
+#define CHIP8_ZONE(zone)
+#define CHIP8_FRAME_BEGIN()
+#define CHIP8_FRAME_END()
+#endif
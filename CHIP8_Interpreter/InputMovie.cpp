@@ -0,0 +1,264 @@
+#include "InputMovie.h"
+
+#include "DeltaCodec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+	const char MOVIE_MAGIC[4] = { 'C', '8', 'M', 'V' };
+	const unsigned short MOVIE_VERSION = 2; //2 marks the FX33 fix, the same as save state version 3
+	const size_t HEADER_SIZE = 40;
+
+	void WriteLittleEndian(std::vector<unsigned char>& out, unsigned long long value, int bytes)
+	{
+		for (int i = 0; i < bytes; ++i)
+			out.push_back(static_cast<unsigned char>(value >> (i * 8)));
+	}
+
+	unsigned long long ReadLittleEndian(const unsigned char* data, int bytes)
+	{
+		unsigned long long value = 0;
+		for (int i = 0; i < bytes; ++i)
+			value |= static_cast<unsigned long long>(data[i]) << (i * 8);
+		return value;
+	}
+
+	unsigned short QuirkBits(const Quirks& quirks)
+	{
+		return static_cast<unsigned short>((quirks.shiftUsesVY ? 1 : 0) | (quirks.loadStoreIncrementsI ? 2 : 0) | (quirks.jumpUsesVX ? 4 : 0)
+			| (quirks.logicResetsVF ? 8 : 0) | (quirks.clipSprites ? 16 : 0));
+	}
+
+	Quirks QuirksFromBits(unsigned short bits)
+	{
+		Quirks quirks;
+		quirks.shiftUsesVY = (bits & 1) != 0;
+		quirks.loadStoreIncrementsI = (bits & 2) != 0;
+		quirks.jumpUsesVX = (bits & 4) != 0;
+		quirks.logicResetsVF = (bits & 8) != 0;
+		quirks.clipSprites = (bits & 16) != 0;
+		return quirks;
+	}
+}
+
+InputMovie::InputMovie()
+{
+}
+
+void InputMovie::StartRecording(const Interpreter& interpreter, unsigned long long keyframeInterval)
+{
+	m_Events.clear();
+	m_Keyframes.clear();
+	m_Quirks = interpreter.GetQuirks();
+	m_InstructionsPerFrame = interpreter.GetInstructionsPerFrame();
+	m_Seed = interpreter.GetSeed();
+	m_KeyframeInterval = std::max(1ull, keyframeInterval);
+	m_EndCycle = interpreter.GetCycleCount();
+	m_Keypad = interpreter.m_Keypad;
+
+	AddKeyframe(interpreter);
+}
+
+void InputMovie::AddKeyframe(const Interpreter& interpreter)
+{
+	Keyframe keyframe;
+	keyframe.cycle = interpreter.GetCycleCount();
+	keyframe.eventIndex = m_Events.size();
+	interpreter.SaveState(keyframe.state);
+	m_Keyframes.push_back(std::move(keyframe));
+}
+
+void InputMovie::Record(const Interpreter& interpreter)
+{
+	const unsigned long long cycle = interpreter.GetCycleCount();
+	if (!m_Keyframes.empty() && cycle - m_Keyframes.back().cycle >= m_KeyframeInterval)
+		AddKeyframe(interpreter);
+
+	if (interpreter.m_Keypad != m_Keypad)
+	{
+		m_Events.push_back(Event{ cycle, interpreter.m_Keypad });
+		m_Keypad = interpreter.m_Keypad;
+	}
+	m_EndCycle = cycle;
+}
+
+void InputMovie::StopRecording(const Interpreter& interpreter)
+{
+	m_EndCycle = interpreter.GetCycleCount();
+}
+
+bool InputMovie::Restore(Interpreter& interpreter, const Keyframe& keyframe, Cursor& cursor) const
+{
+	interpreter.SetQuirks(m_Quirks);
+	interpreter.SetInstructionsPerFrame(m_InstructionsPerFrame);
+	interpreter.SetSeed(m_Seed);
+	if (!interpreter.LoadState(keyframe.state.data(), keyframe.state.size()))
+		return false;
+
+	//The keypad in the state is the one that was active at the keyframe
+	cursor.nextEvent = keyframe.eventIndex;
+	cursor.keypad = interpreter.m_Keypad;
+	return true;
+}
+
+bool InputMovie::StartPlayback(Interpreter& interpreter)
+{
+	return !m_Keyframes.empty() && Restore(interpreter, m_Keyframes.front(), m_Cursor);
+}
+
+bool InputMovie::Seek(Interpreter& interpreter, unsigned long long cycle)
+{
+	return Seek(interpreter, cycle, m_Cursor);
+}
+
+bool InputMovie::Seek(Interpreter& interpreter, unsigned long long cycle, Cursor& cursor) const
+{
+	//Keyframes are sorted by cycle
+	auto keyframe = std::upper_bound(m_Keyframes.begin(), m_Keyframes.end(), cycle,
+		[](unsigned long long value, const Keyframe& candidate) { return value < candidate.cycle; });
+	if (keyframe == m_Keyframes.begin())
+		return false;
+
+	return Restore(interpreter, *(keyframe - 1), cursor);
+}
+
+void InputMovie::Play(Interpreter& interpreter)
+{
+	Play(interpreter, m_Cursor);
+}
+
+void InputMovie::Play(Interpreter& interpreter, Cursor& cursor) const
+{
+	const unsigned long long cycle = interpreter.GetCycleCount();
+	while (cursor.nextEvent < m_Events.size() && m_Events[cursor.nextEvent].cycle <= cycle)
+		cursor.keypad = m_Events[cursor.nextEvent++].keypad;
+
+	interpreter.m_Keypad = cursor.keypad;
+}
+
+bool InputMovie::Save(const std::string& path) const
+{
+	std::vector<unsigned char> events;
+	unsigned long long previousCycle = m_Keyframes.empty() ? 0 : m_Keyframes.front().cycle;
+	for (const Event& event : m_Events)
+	{
+		WriteVarint(events, event.cycle - previousCycle);
+		WriteVarint(events, event.keypad);
+		previousCycle = event.cycle;
+	}
+
+	std::vector<unsigned char> bytes;
+	bytes.insert(bytes.end(), MOVIE_MAGIC, MOVIE_MAGIC + sizeof(MOVIE_MAGIC));
+	WriteLittleEndian(bytes, MOVIE_VERSION, 2);
+	WriteLittleEndian(bytes, QuirkBits(m_Quirks), 2);
+	WriteLittleEndian(bytes, static_cast<unsigned int>(m_InstructionsPerFrame), 4);
+	WriteLittleEndian(bytes, m_Seed, 8);
+	WriteLittleEndian(bytes, m_EndCycle, 8);
+	WriteLittleEndian(bytes, m_Events.size(), 4);
+	WriteLittleEndian(bytes, m_Keyframes.size(), 4);
+	WriteLittleEndian(bytes, events.size(), 4);
+	bytes.insert(bytes.end(), events.begin(), events.end());
+
+	for (const Keyframe& keyframe : m_Keyframes)
+	{
+		WriteLittleEndian(bytes, keyframe.cycle, 8);
+		WriteLittleEndian(bytes, keyframe.eventIndex, 4);
+		WriteLittleEndian(bytes, keyframe.state.size(), 4);
+		bytes.insert(bytes.end(), keyframe.state.begin(), keyframe.state.end());
+	}
+
+	std::ofstream file(path, std::ios_base::binary);
+	file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+	if (file.fail())
+	{
+		std::cout << "Failed to write movie " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool InputMovie::Load(const std::string& path)
+{
+	std::ifstream file(path, std::ios_base::binary | std::ios_base::ate);
+	if (file.fail())
+	{
+		std::cout << "Failed to load movie with path " << path << std::endl;
+		return false;
+	}
+
+	std::vector<unsigned char> bytes(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+
+	if (file.fail() || bytes.size() < HEADER_SIZE || std::memcmp(bytes.data(), MOVIE_MAGIC, sizeof(MOVIE_MAGIC)) != 0
+		|| ReadLittleEndian(bytes.data() + 4, 2) != MOVIE_VERSION)
+	{
+		std::cout << "Unsupported movie " << path << std::endl;
+		return false;
+	}
+
+	m_Quirks = QuirksFromBits(static_cast<unsigned short>(ReadLittleEndian(bytes.data() + 6, 2)));
+	m_InstructionsPerFrame = static_cast<int>(ReadLittleEndian(bytes.data() + 8, 4));
+	m_Seed = ReadLittleEndian(bytes.data() + 12, 8);
+	m_EndCycle = ReadLittleEndian(bytes.data() + 20, 8);
+	const size_t eventCount = static_cast<size_t>(ReadLittleEndian(bytes.data() + 28, 4));
+	const size_t keyframeCount = static_cast<size_t>(ReadLittleEndian(bytes.data() + 32, 4));
+	const size_t eventBytes = static_cast<size_t>(ReadLittleEndian(bytes.data() + 36, 4));
+
+	m_Events.clear();
+	m_Keyframes.clear();
+	bool valid = eventBytes <= bytes.size() - HEADER_SIZE;
+
+	//Keyframes come first in time but last in the file, the first one is the base of the event cycles
+	size_t position = HEADER_SIZE + (valid ? eventBytes : 0);
+	for (size_t i = 0; valid && i < keyframeCount; ++i)
+	{
+		if (bytes.size() - position < 16)
+		{
+			valid = false;
+			break;
+		}
+
+		Keyframe keyframe;
+		keyframe.cycle = ReadLittleEndian(bytes.data() + position, 8);
+		keyframe.eventIndex = static_cast<size_t>(ReadLittleEndian(bytes.data() + position + 8, 4));
+		const size_t stateSize = static_cast<size_t>(ReadLittleEndian(bytes.data() + position + 12, 4));
+		position += 16;
+		if (bytes.size() - position < stateSize || keyframe.eventIndex > eventCount)
+		{
+			valid = false;
+			break;
+		}
+
+		keyframe.state.assign(bytes.begin() + position, bytes.begin() + position + stateSize);
+		position += stateSize;
+		m_Keyframes.push_back(std::move(keyframe));
+	}
+
+	size_t eventPosition = 0;
+	const unsigned char* events = bytes.data() + HEADER_SIZE;
+	unsigned long long cycle = m_Keyframes.empty() ? 0 : m_Keyframes.front().cycle;
+	for (size_t i = 0; valid && i < eventCount; ++i)
+	{
+		unsigned long long delta;
+		unsigned long long keypad;
+		valid = ReadVarint(events, eventBytes, eventPosition, delta) && ReadVarint(events, eventBytes, eventPosition, keypad);
+		cycle += delta;
+		m_Events.push_back(Event{ cycle, static_cast<unsigned short>(keypad) });
+	}
+
+	if (!valid || m_Keyframes.empty())
+	{
+		std::cout << "Corrupt movie " << path << std::endl;
+		m_Events.clear();
+		m_Keyframes.clear();
+		return false;
+	}
+
+	m_Cursor = Cursor();
+	return true;
+}
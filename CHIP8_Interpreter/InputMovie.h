@@ -0,0 +1,93 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Interpreter.h"
+
+/* Recording of the keypad over a run, replaying it on the same start state gives a bit exact copy of the run.
+The start state (including the random generator) is the first keyframe, so playback doesn't need the rom file.
+File layout (little endian):
+Header 	"C8MV", u16 version, u16 quirk bits, u32 instructions per frame, u64 seed, u64 end cycle,
+		u32 event count, u32 keyframe count, u32 event bytes
+Events 	per keypad change: varint cycles since the previous change, varint keypad
+Index 	per keyframe: u64 cycle, u32 event index, u32 state size, a save state (see Interpreter::SaveState)*/
+class InputMovie
+{
+public:
+	//Playback position, several threads can play one movie with a cursor each
+	struct Cursor
+	{
+		size_t nextEvent = 0;
+		unsigned short keypad = 0;
+	};
+
+	InputMovie();
+
+	//Starts a new movie from the current interpreter state, keyframeInterval is in cycles
+	void StartRecording(const Interpreter& interpreter, unsigned long long keyframeInterval = 60000);
+
+	//Call before every RunFrame, stores the keypad when it changed and a keyframe every keyframe interval
+	void Record(const Interpreter& interpreter);
+
+	//Marks where the recording ended, playback stops there
+	void StopRecording(const Interpreter& interpreter);
+
+	//Restores the start state, quirks and speed of the recording
+	bool StartPlayback(Interpreter& interpreter);
+
+	//Restores the last keyframe at or before cycle, the caller runs frames from there
+	bool Seek(Interpreter& interpreter, unsigned long long cycle);
+
+	//Call before every RunFrame, sets the keypad recorded for the current cycle
+	void Play(Interpreter& interpreter);
+
+	bool Seek(Interpreter& interpreter, unsigned long long cycle, Cursor& cursor) const;
+	void Play(Interpreter& interpreter, Cursor& cursor) const;
+	bool IsFinished(const Interpreter& interpreter) const { return interpreter.GetCycleCount() >= m_EndCycle; }
+
+	//True once Play has applied the last keypad change, the keypad stays the same until the end
+	bool IsInputFinished() const { return m_Cursor.nextEvent >= m_Events.size(); }
+
+	bool Save(const std::string& path) const;
+	bool Load(const std::string& path);
+
+	unsigned long long GetEndCycle() const { return m_EndCycle; }
+	size_t GetEventCount() const { return m_Events.size(); }
+
+	//Keyframes are in cycle order, the first one is the start of the movie
+	size_t GetKeyframeCount() const { return m_Keyframes.size(); }
+	unsigned long long GetKeyframeCycle(size_t index) const { return m_Keyframes[index].cycle; }
+
+private:
+	struct Event
+	{
+		unsigned long long cycle;
+		unsigned short keypad;
+	};
+
+	struct Keyframe
+	{
+		unsigned long long cycle;
+		size_t eventIndex; //first event at or after the keyframe
+		std::vector<unsigned char> state;
+	};
+
+	std::vector<Event> m_Events;
+	std::vector<Keyframe> m_Keyframes;
+
+	Quirks m_Quirks;
+	int m_InstructionsPerFrame = 10;
+	unsigned long long m_Seed = 0;
+	unsigned long long m_EndCycle = 0;
+	unsigned long long m_KeyframeInterval = 60000;
+
+	//Playback position of Play without a cursor
+	Cursor m_Cursor;
+
+	//Keypad as of the last Record
+	unsigned short m_Keypad = 0;
+
+	void AddKeyframe(const Interpreter& interpreter);
+	bool Restore(Interpreter& interpreter, const Keyframe& keyframe, Cursor& cursor) const;
+};
@@ -1,18 +1,50 @@
 #include "Interpreter.h"
+#include "RomAnalyzer.h"
 
+#ifdef CHIP8_PROFILE
+#include "CallProfiler.h"
+#include "OpcodeProfiler.h"
+#endif
+
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 
-#define DEBUG
+//Define CHIP8_TRACE_OPCODES to print every executed opcode, printing dominates the run time when enabled
+//#define CHIP8_TRACE_OPCODES
 
 Interpreter::Interpreter()
 {
+	SetSeed(m_Seed);
 }
 
 Interpreter::~Interpreter()
 {
 }
 
+namespace
+{
+	//splitmix64 finalizer, the offset keeps 0 from hashing to 0
+	unsigned long long Mix(unsigned long long value)
+	{
+		value += 0x9E3779B97F4A7C15ull;
+		value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+		value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+		return value ^ (value >> 31);
+	}
+
+	unsigned long long MemoryKey(unsigned int address, unsigned char value)
+	{
+		return Mix((address & 0xFFF) << 8 | value);
+	}
+
+	unsigned long long PixelKey(int index)
+	{
+		return Mix(0x100000ull | static_cast<unsigned int>(index));
+	}
+}
+
 inline int ScaleTo(int value, int from, int to)
 {
 	float fraction = static_cast<float>(to) / static_cast<float>(from);
@@ -27,13 +59,58 @@ unsigned int RgbaToU32(unsigned char r, unsigned char g, unsigned char b, unsign
 
 void Interpreter::ClearScreen()
 {
-	m_PixelOn = RgbaToU32(255, 255, 255, 0);
-	m_PixelOff = RgbaToU32(0, 0, 0, 0);
-
 	for (int i = 0; i < 2048; ++i)
 		m_Screen[i] = m_PixelOff;
+	m_ScreenHash = 0;
+	m_DirtyPages |= ~0ull << PagedState::MEMORY_PAGES;
+
+	m_DrawFlag = true;
+}
 
+void Interpreter::SetColors(unsigned int pixelOn, unsigned int pixelOff)
+{
+	for (int i = 0; i < PIXEL_COUNT; ++i)
+		m_Screen[i] = (m_Screen[i] == m_PixelOn) ? pixelOn : pixelOff;
+
+	m_PixelOn = pixelOn;
+	m_PixelOff = pixelOff;
 	m_DrawFlag = true;
+	m_DirtyPages |= ~0ull << PagedState::MEMORY_PAGES;
+}
+
+void Interpreter::SetSeed(unsigned long long seed)
+{
+	m_Seed = seed;
+
+	//splitmix64 spreads any seed (including 0) over the whole state
+	for (int i = 0; i < 4; i += 2)
+	{
+		seed += 0x9E3779B97F4A7C15ull;
+		unsigned long long z = seed;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		z ^= z >> 31;
+		m_RandomState[i] = static_cast<unsigned int>(z);
+		m_RandomState[i + 1] = static_cast<unsigned int>(z >> 32);
+	}
+}
+
+unsigned int Interpreter::NextRandom()
+{
+	//xoshiro128**
+	unsigned int* s = m_RandomState;
+	const unsigned int product = s[1] * 5;
+	const unsigned int result = ((product << 7) | (product >> 25)) * 9;
+	const unsigned int t = s[1] << 9;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = (s[3] << 11) | (s[3] >> 21);
+
+	return result;
 }
 
 void Interpreter::Initialize()
@@ -46,6 +123,24 @@ void Interpreter::Initialize()
 	for (int i = 0; i < STACK_COUNT; ++i)
 		m_Stack[i] = 0;
 
+	m_IndexRegister = 0;
+	m_ProgramCounter = PROGRAM_START;
+	m_StackPointer = 0;
+	m_DelayTimer = 0;
+	m_SoundTimer = 0;
+	m_Keypad = 0;
+	m_CycleCount = 0;
+	m_FrameCycle = 0;
+	m_FrameDrawn = false;
+	m_AtBreakpoint = false;
+	m_AtWatchpoint = false;
+	m_PredecodeStale = true;
+	m_StateHashStale = true;
+	m_DirtyPages = ~0ull;
+	SetSeed(m_Seed);
+
+	std::memset(m_Memory, 0, sizeof(m_Memory));
+
 	/*Loading the fontset to memory.
 	Wikipedia: In modern CHIP-8 implementations,
 	where the interpreter is running natively outside the 4K memory space,
@@ -68,6 +163,244 @@ void Interpreter::LoadRom(const std::string& path)
 	Rom.seekg(0); //go back to the beginning of the file
 
 	Rom.read(reinterpret_cast<char*>(m_Memory + 512), fileSize);
+	m_PredecodeStale = true;
+	m_StateHashStale = true;
+	m_DirtyPages = ~0ull;
+}
+
+void Interpreter::LoadRom(const unsigned char* data, size_t size)
+{
+	std::memcpy(m_Memory + PROGRAM_START, data, std::min(size, static_cast<size_t>(MEMORY_SIZE - PROGRAM_START)));
+	m_PredecodeStale = true;
+	m_StateHashStale = true;
+	m_DirtyPages = ~0ull;
+}
+
+void Interpreter::SaveSnapshot(Snapshot& snapshot) const
+{
+	std::memcpy(snapshot.memory, m_Memory, sizeof(m_Memory));
+	std::memcpy(snapshot.screen, m_Screen, sizeof(m_Screen));
+	std::memcpy(snapshot.v, m_V, sizeof(m_V));
+	std::memcpy(snapshot.stack, m_Stack, sizeof(m_Stack));
+	std::memcpy(snapshot.randomState, m_RandomState, sizeof(m_RandomState));
+	snapshot.cycleCount = m_CycleCount;
+	snapshot.indexRegister = m_IndexRegister;
+	snapshot.programCounter = m_ProgramCounter;
+	snapshot.stackPointer = m_StackPointer;
+	snapshot.keypad = m_Keypad;
+	snapshot.delayTimer = m_DelayTimer;
+	snapshot.soundTimer = m_SoundTimer;
+	snapshot.drawFlag = m_DrawFlag;
+	snapshot.frameCycle = m_FrameCycle;
+	snapshot.frameDrawn = m_FrameDrawn;
+}
+
+void Interpreter::LoadSnapshot(const Snapshot& snapshot)
+{
+	//Run-ahead and rollback load snapshots every frame, mostly with the same code
+	if (!m_Predecoded.empty() && std::memcmp(m_Memory, snapshot.memory, sizeof(m_Memory)) != 0)
+		m_PredecodeStale = true;
+	m_StateHashStale = true;
+	m_DirtyPages = ~0ull;
+
+	std::memcpy(m_Memory, snapshot.memory, sizeof(m_Memory));
+	std::memcpy(m_Screen, snapshot.screen, sizeof(m_Screen));
+	std::memcpy(m_V, snapshot.v, sizeof(m_V));
+	std::memcpy(m_Stack, snapshot.stack, sizeof(m_Stack));
+	std::memcpy(m_RandomState, snapshot.randomState, sizeof(m_RandomState));
+	m_CycleCount = snapshot.cycleCount;
+	m_IndexRegister = snapshot.indexRegister;
+	m_ProgramCounter = snapshot.programCounter;
+	m_StackPointer = snapshot.stackPointer;
+	m_Keypad = snapshot.keypad;
+	m_DelayTimer = snapshot.delayTimer;
+	m_SoundTimer = snapshot.soundTimer;
+	m_DrawFlag = snapshot.drawFlag;
+	m_FrameCycle = snapshot.frameCycle;
+	m_FrameDrawn = snapshot.frameDrawn;
+	m_AtBreakpoint = false;
+	m_AtWatchpoint = false;
+}
+
+namespace
+{
+	const unsigned char STATE_MAGIC[4] = { 'C', '8', 'S', 'S' };
+	//Version 3 has the layout of version 2, it marks the FX33 fix: older states of roms that display a number don't run the same anymore
+	const unsigned short STATE_VERSION = 3;
+
+	void WriteU16(std::vector<unsigned char>& state, unsigned short value)
+	{
+		state.push_back(static_cast<unsigned char>(value & 0xFF));
+		state.push_back(static_cast<unsigned char>(value >> 8));
+	}
+
+	unsigned short ReadU16(const unsigned char* data)
+	{
+		return static_cast<unsigned short>(data[0] | (data[1] << 8));
+	}
+
+	void WriteU32(std::vector<unsigned char>& state, unsigned int value)
+	{
+		WriteU16(state, static_cast<unsigned short>(value & 0xFFFF));
+		WriteU16(state, static_cast<unsigned short>(value >> 16));
+	}
+
+	unsigned int ReadU32(const unsigned char* data)
+	{
+		return ReadU16(data) | (static_cast<unsigned int>(ReadU16(data + 2)) << 16);
+	}
+}
+
+/* Save state layout, version 3:
+magic "C8SS", u16 version, memory (4096), V0-VF (16), u16 I, u16 PC, u8 SP, stack (16 x u16),
+u8 delay timer, u8 sound timer, u16 keypad, u8 draw flag, display (2048 bits, row major, msb first),
+random state (4 x u32), u64 cycle count.
+Older versions are rejected*/
+void Interpreter::SaveState(std::vector<unsigned char>& state) const
+{
+	state.clear();
+	state.reserve(STATE_SIZE);
+
+	state.insert(state.end(), STATE_MAGIC, STATE_MAGIC + sizeof(STATE_MAGIC));
+	WriteU16(state, STATE_VERSION);
+
+	state.insert(state.end(), m_Memory, m_Memory + MEMORY_SIZE);
+	state.insert(state.end(), m_V, m_V + REGISTER_COUNT);
+	WriteU16(state, m_IndexRegister);
+	WriteU16(state, m_ProgramCounter);
+	state.push_back(static_cast<unsigned char>(m_StackPointer));
+	for (int i = 0; i < STACK_COUNT; ++i)
+		WriteU16(state, m_Stack[i]);
+	state.push_back(m_DelayTimer);
+	state.push_back(m_SoundTimer);
+	WriteU16(state, m_Keypad);
+	state.push_back(m_DrawFlag ? 1 : 0);
+
+	unsigned char screen[PACKED_SCREEN_SIZE];
+	PackScreen(screen);
+	state.insert(state.end(), screen, screen + PACKED_SCREEN_SIZE);
+
+	for (int i = 0; i < 4; ++i)
+		WriteU32(state, m_RandomState[i]);
+	WriteU32(state, static_cast<unsigned int>(m_CycleCount));
+	WriteU32(state, static_cast<unsigned int>(m_CycleCount >> 32));
+}
+
+bool Interpreter::LoadState(const unsigned char* data, size_t size)
+{
+	if (size < sizeof(STATE_MAGIC) + 2 || std::memcmp(data, STATE_MAGIC, sizeof(STATE_MAGIC)) != 0)
+	{
+		std::cout << "Not a save state" << std::endl;
+		return false;
+	}
+
+	const unsigned short version = ReadU16(data + sizeof(STATE_MAGIC));
+	if (version != STATE_VERSION || size != static_cast<size_t>(STATE_SIZE))
+	{
+		std::cout << "Unsupported save state version " << version << std::endl;
+		return false;
+	}
+
+	const unsigned char* read = data + sizeof(STATE_MAGIC) + 2;
+	if (read[MEMORY_SIZE + REGISTER_COUNT + 4] > STACK_COUNT)
+	{
+		std::cout << "Corrupt save state" << std::endl;
+		return false;
+	}
+
+	std::memcpy(m_Memory, read, MEMORY_SIZE);
+	m_PredecodeStale = true;
+	m_StateHashStale = true;
+	m_DirtyPages = ~0ull;
+	read += MEMORY_SIZE;
+	std::memcpy(m_V, read, REGISTER_COUNT);
+	read += REGISTER_COUNT;
+	m_IndexRegister = ReadU16(read) & 0x0FFF;
+	m_ProgramCounter = ReadU16(read + 2) & 0x0FFF;
+	m_StackPointer = read[4];
+	read += 5;
+	for (int i = 0; i < STACK_COUNT; ++i, read += 2)
+		m_Stack[i] = ReadU16(read);
+	m_DelayTimer = read[0];
+	m_SoundTimer = read[1];
+	m_Keypad = ReadU16(read + 2);
+	m_DrawFlag = true; //the display changed even if the saved frame had nothing new
+	read += 5;
+
+	for (int i = 0; i < PIXEL_COUNT; ++i)
+		m_Screen[i] = (read[i / 8] & (0x80 >> (i % 8))) ? m_PixelOn : m_PixelOff;
+	read += PIXEL_COUNT / 8;
+
+	for (int i = 0; i < 4; ++i, read += 4)
+		m_RandomState[i] = ReadU32(read);
+	m_CycleCount = ReadU32(read) | (static_cast<unsigned long long>(ReadU32(read + 4)) << 32);
+
+	//States are saved between frames
+	m_FrameCycle = 0;
+	m_FrameDrawn = false;
+	m_AtBreakpoint = false;
+	m_AtWatchpoint = false;
+	return true;
+}
+
+void Interpreter::DrawSprite(const unsigned char* sprite, unsigned char x, unsigned char y, unsigned char height, bool collision)
+{
+	x %= SCREEN_WIDTH;
+	y %= SCREEN_HEIGHT;
+
+	if (collision)
+		m_V[0xF] = 0;
+	for (int h = 0; h < height; ++h)
+	{
+		int row = y + h;
+		if (row >= SCREEN_HEIGHT)
+		{
+			if (m_Quirks.clipSprites)
+				break;
+			row -= SCREEN_HEIGHT;
+		}
+		m_DirtyPages |= 1ull << (PagedState::MEMORY_PAGES + row);
+
+		unsigned char line = sprite[h];
+		for (int w = 0; w < 8; ++w)
+		{
+			if ((line & (0x80 >> w)) != 0)
+			{
+				int column = x + w;
+				if (column >= SCREEN_WIDTH)
+				{
+					if (m_Quirks.clipSprites)
+						break;
+					column -= SCREEN_WIDTH;
+				}
+
+				const int idx = column + row * SCREEN_WIDTH;
+
+				int curState = (m_Screen[idx] == m_PixelOn);
+				if (curState == 1 && collision)
+					m_V[0xF] = 1;
+
+				const int result = (curState ^= 1);
+				m_Screen[idx] = (result) ? m_PixelOn : m_PixelOff;
+				if (m_StateHashing)
+					m_ScreenHash ^= PixelKey(idx);
+			}
+		}
+	}
+}
+
+void Interpreter::PackScreen(unsigned char* bits) const
+{
+	for (int i = 0; i < PIXEL_COUNT; i += 8)
+	{
+		unsigned char byte = 0;
+		for (int bit = 0; bit < 8; ++bit)
+		{
+			if (m_Screen[i + bit] == m_PixelOn)
+				byte |= 0x80 >> bit;
+		}
+		bits[i / 8] = byte;
+	}
 }
 
 unsigned int* Interpreter::GetScreen()
@@ -85,7 +418,7 @@ void Interpreter::DecreaseTimers() //timers count down at 60hz so might want to
 	{
 		--m_SoundTimer;
 
-		if (m_SoundTimer == 1)
+		if (m_SoundTimer == 1 && m_SoundEnabled)
 			std::cout << "Beep\n";
 	}
 }
@@ -95,18 +428,486 @@ bool Interpreter::Cycle()
 	// Reset draw flag
 	m_DrawFlag = false;
 
-	// Fetch opcode: fetch memory from the location specified by the program counter
-	unsigned char o = m_Memory[m_ProgramCounter++]; //increment counter here (1)
-	unsigned char p = m_Memory[m_ProgramCounter++]; //increment counter here (2), 2 times incremented => next instruction
-
-	// Opcode is 2 bytes, memory is 1 byte so add them together
+	// Predecoded instructions come from the table, see SetPredecoded
+	const PredecodedInstruction* predecoded = m_Predecoded.empty() ? nullptr : FindPredecoded();
 	unsigned short opCode;
-	opCode = o << 8 | p;
+	if (predecoded != nullptr)
+	{
+		opCode = predecoded->opCode;
+		m_ProgramCounter += 2;
+	}
+	else
+	{
+		// Fetch opcode: fetch memory from the location specified by the program counter
+		unsigned char o = ReadMemory(m_ProgramCounter++); //increment counter here (1)
+		unsigned char p = ReadMemory(m_ProgramCounter++); //increment counter here (2), 2 times incremented => next instruction
+
+		// Opcode is 2 bytes, memory is 1 byte so add them together
+		opCode = o << 8 | p;
+	}
+	++m_CycleCount;
 
-#ifdef DEBUG
+#ifdef CHIP8_TRACE_OPCODES
 	std::cout << std::hex << "Opcode: " << opCode << std::endl;
 #endif
 
+#ifdef CHIP8_PROFILE
+	if (m_OpcodeProfiler != nullptr)
+		m_OpcodeProfiler->Record(m_ProgramCounter - 2, opCode);
+	if (m_CallProfiler != nullptr)
+		m_CallProfiler->Record(opCode);
+#endif
+
+	if (predecoded != nullptr && predecoded->flagDead)
+		return ExecuteWithoutFlag(opCode);
+	return Execute(opCode);
+}
+
+bool Interpreter::RunFrame()
+{
+	//The loop is picked once per frame, without breakpoints or watchpoints there is no check per instruction
+	if (m_BreakpointCount != 0 || m_WatchpointCount != 0)
+		return RunFrameChecked();
+
+	//A stop at a breakpoint or watchpoint that was removed since then is over
+	m_AtBreakpoint = false;
+	m_AtWatchpoint = false;
+
+	if (m_FastForward && m_OpcodeProfiler == nullptr && m_CallProfiler == nullptr && SkipDelayWait())
+		return true;
+
+	bool drawn = m_FrameDrawn;
+	for (int i = m_FrameCycle; i < m_InstructionsPerFrame; ++i)
+	{
+		if (!Cycle())
+			return false;
+
+		drawn |= m_DrawFlag;
+	}
+
+	EndFrame(drawn);
+	return true;
+}
+
+bool Interpreter::RunFrameChecked()
+{
+	//Resuming from a breakpoint runs the instruction it stopped at
+	bool resuming = m_AtBreakpoint;
+	m_AtBreakpoint = false;
+	m_AtWatchpoint = false;
+	for (; m_FrameCycle < m_InstructionsPerFrame; ++m_FrameCycle)
+	{
+		if (!resuming && HasBreakpoint(m_ProgramCounter))
+		{
+			m_AtBreakpoint = true;
+			m_DrawFlag = m_FrameDrawn;
+			return true;
+		}
+		resuming = false;
+
+		if (!Cycle())
+			return false;
+
+		m_FrameDrawn |= m_DrawFlag;
+
+		//Stops after the instruction, so the state shows what it did
+		if (m_AtWatchpoint && m_FrameCycle + 1 < m_InstructionsPerFrame)
+		{
+			++m_FrameCycle;
+			m_DrawFlag = m_FrameDrawn;
+			return true;
+		}
+	}
+
+	EndFrame(m_FrameDrawn);
+	return true;
+}
+
+bool Interpreter::SkipDelayWait()
+{
+	//FX07 at start, 3X00 at start + 2 and 1NNN jumping back to start: the timer only changes between frames, so once the loop runs
+	//with the timer above 0 it runs until the end of the frame
+	unsigned int start = m_ProgramCounter;
+	int toStart = 0;
+	if (IsDelayLoop(m_ProgramCounter - 4u))
+	{
+		start = m_ProgramCounter - 4u;
+		toStart = 1;
+	}
+	else if (IsDelayLoop(m_ProgramCounter - 2u))
+	{
+		//The 3X00 tests the timer value the last FX07 read
+		start = m_ProgramCounter - 2u;
+		if (m_V[(PeekOpCode(start) & 0x0F00) >> 8] == 0)
+			return false;
+		toStart = 2;
+	}
+	else if (!IsDelayLoop(start))
+	{
+		return false;
+	}
+
+	const int remaining = m_InstructionsPerFrame - m_FrameCycle;
+	if (m_DelayTimer == 0 || remaining <= toStart)
+		return false;
+
+	//From start on every third instruction is an FX07, the program counter ends where the last one left it
+	const int fromStart = remaining - toStart;
+	m_V[(PeekOpCode(start) & 0x0F00) >> 8] = m_DelayTimer;
+	m_ProgramCounter = static_cast<unsigned short>(start + (fromStart % 3) * 2);
+	m_CycleCount += remaining;
+	EndFrame(m_FrameDrawn);
+	return true;
+}
+
+bool Interpreter::IsDelayLoop(unsigned int address) const
+{
+	const unsigned short load = PeekOpCode(address);
+	return address < MEMORY_SIZE && (load & 0xF0FF) == 0xF007
+		&& PeekOpCode(address + 2) == (0x3000 | (load & 0x0F00))
+		&& PeekOpCode(address + 4) == (0x1000 | address);
+}
+
+bool Interpreter::Step()
+{
+	m_AtBreakpoint = false;
+	m_AtWatchpoint = false;
+	if (!Cycle())
+		return false;
+
+	m_FrameDrawn |= m_DrawFlag;
+	if (++m_FrameCycle >= m_InstructionsPerFrame)
+		EndFrame(m_FrameDrawn);
+	return true;
+}
+
+void Interpreter::EndFrame(bool drawn)
+{
+	//Timers count down at 60hz, once per frame
+	DecreaseTimers();
+
+	m_DrawFlag = drawn;
+	m_FrameCycle = 0;
+	m_FrameDrawn = false;
+}
+
+void Interpreter::SetBreakpoint(unsigned short address, bool enabled)
+{
+	if (HasBreakpoint(address) == enabled)
+		return;
+
+	m_Breakpoints[(address & 0xFFF) >> 6] ^= 1ull << (address & 63);
+	m_BreakpointCount += enabled ? 1 : -1;
+}
+
+void Interpreter::ClearBreakpoints()
+{
+	std::fill(m_Breakpoints, m_Breakpoints + MEMORY_SIZE / 64, 0ull);
+	m_BreakpointCount = 0;
+	m_AtBreakpoint = false;
+}
+
+void Interpreter::SetWatchpoint(unsigned short address, int access)
+{
+	address &= 0xFFF;
+	const unsigned long long bit = 1ull << (address & 63);
+	if (GetWatchpoint(address) != 0)
+		--m_WatchpointCount;
+	if (access != 0)
+		++m_WatchpointCount;
+
+	m_ReadWatchpoints[address >> 6] = (access & WATCH_READ) ? (m_ReadWatchpoints[address >> 6] | bit) : (m_ReadWatchpoints[address >> 6] & ~bit);
+	m_WriteWatchpoints[address >> 6] = (access & WATCH_WRITE) ? (m_WriteWatchpoints[address >> 6] | bit) : (m_WriteWatchpoints[address >> 6] & ~bit);
+	UpdateWatchedPages();
+}
+
+int Interpreter::GetWatchpoint(unsigned short address) const
+{
+	address &= 0xFFF;
+	return static_cast<int>(((m_ReadWatchpoints[address >> 6] >> (address & 63)) & 1) * WATCH_READ
+		| ((m_WriteWatchpoints[address >> 6] >> (address & 63)) & 1) * WATCH_WRITE);
+}
+
+void Interpreter::ClearWatchpoints()
+{
+	std::fill(m_ReadWatchpoints, m_ReadWatchpoints + MEMORY_SIZE / 64, 0ull);
+	std::fill(m_WriteWatchpoints, m_WriteWatchpoints + MEMORY_SIZE / 64, 0ull);
+	m_WatchpointCount = 0;
+	m_AtWatchpoint = false;
+	UpdateWatchedPages();
+}
+
+void Interpreter::SetPredecoded(bool enabled)
+{
+	if (enabled)
+		m_Predecoded.assign(MEMORY_SIZE, PredecodedInstruction());
+	else
+		std::vector<PredecodedInstruction>().swap(m_Predecoded);
+
+	m_PredecodedPages = 0;
+	m_PredecodeStale = true;
+	UpdateWatchedPages();
+}
+
+void Interpreter::Predecode()
+{
+	//The analysis takes a few dozen microseconds, memory only changes under predecoded code in self-modifying roms.
+	//Zeros at the end are not code, the instruction that ends in the first of them still is
+	int end = MEMORY_SIZE;
+	while (end > PROGRAM_START && m_Memory[end - 1] == 0)
+		--end;
+	RomAnalysis analysis;
+	analysis.Analyze(m_Memory + PROGRAM_START, std::min(end + 1, static_cast<int>(MEMORY_SIZE)) - PROGRAM_START);
+
+	m_PredecodedPages = 0;
+	for (int address = 0; address < MEMORY_SIZE; ++address)
+	{
+		PredecodedInstruction& instruction = m_Predecoded[address];
+		instruction.opCode = static_cast<unsigned short>(m_Memory[address] << 8 | m_Memory[(address + 1) & 0xFFF]);
+		instruction.decoded = (analysis.GetFlags(static_cast<unsigned short>(address)) & ROM_INSTRUCTION) != 0;
+		instruction.flagDead = false;
+		if (instruction.decoded)
+			m_PredecodedPages |= PageRange(address, 2);
+	}
+
+	for (unsigned short address : analysis.FindDeadFlagWrites(m_Quirks))
+		m_Predecoded[address].flagDead = true;
+
+	m_PredecodeStale = false;
+	UpdateWatchedPages();
+}
+
+void Interpreter::CheckWrite(unsigned short address, unsigned char value)
+{
+	if ((m_WriteWatchedPages >> ((address >> 8) & 0xF)) & 1)
+		CheckWatchpoint(address, WATCH_WRITE, value);
+
+	if (m_StateHashing)
+		m_MemoryHash ^= MemoryKey(address, m_Memory[address & 0xFFF]) ^ MemoryKey(address, value);
+	m_DirtyPages |= 1ull << ((address >> 8) & 0xF);
+
+	//Changing either byte of a predecoded instruction decodes memory again before the next one runs
+	if (!m_Predecoded.empty() && m_Memory[address & 0xFFF] != value
+		&& (m_Predecoded[address & 0xFFF].decoded || m_Predecoded[(address - 1) & 0xFFF].decoded))
+		m_PredecodeStale = true;
+}
+
+void Interpreter::UpdateWatchedPages()
+{
+	//A page is 4 words of the bitmaps
+	m_ReadWatchedPages = 0;
+	m_WriteWatchedPages = 0;
+	for (int page = 0; page < 16; ++page)
+	{
+		for (int word = page * 4; word < page * 4 + 4; ++word)
+		{
+			if (m_ReadWatchpoints[word] != 0)
+				m_ReadWatchedPages |= 1 << page;
+			if (m_WriteWatchpoints[word] != 0)
+				m_WriteWatchedPages |= 1 << page;
+		}
+	}
+	m_CheckedWritePages = (m_StateHashing || !m_ForkBase.IsEmpty()) ? 0xFFFF : (m_WriteWatchedPages | m_PredecodedPages);
+}
+
+void Interpreter::SetStateHashing(bool enabled)
+{
+	m_StateHashing = enabled;
+	m_StateHashStale = true;
+	UpdateWatchedPages();
+}
+
+void Interpreter::HashMemoryAndScreen()
+{
+	m_MemoryHash = 0;
+	for (int address = 0; address < MEMORY_SIZE; ++address)
+		m_MemoryHash ^= MemoryKey(address, m_Memory[address]);
+
+	m_ScreenHash = 0;
+	for (int i = 0; i < PIXEL_COUNT; ++i)
+	{
+		if (m_Screen[i] == m_PixelOn)
+			m_ScreenHash ^= PixelKey(i);
+	}
+	m_StateHashStale = !m_StateHashing;
+}
+
+unsigned long long Interpreter::GetStateHash()
+{
+	if (m_StateHashStale || !m_StateHashing)
+		HashMemoryAndScreen();
+
+	unsigned long long hash = Mix(m_MemoryHash ^ Mix(m_ScreenHash));
+	auto add = [&hash](unsigned long long value) { hash = Mix(hash ^ value); };
+	for (int i = 0; i < REGISTER_COUNT; i += 8)
+	{
+		unsigned long long registers = 0;
+		for (int j = 0; j < 8; ++j)
+			registers |= static_cast<unsigned long long>(m_V[i + j]) << (j * 8);
+		add(registers);
+	}
+	add(static_cast<unsigned long long>(m_IndexRegister) | static_cast<unsigned long long>(m_ProgramCounter) << 16
+		| static_cast<unsigned long long>(m_StackPointer) << 32 | static_cast<unsigned long long>(m_DelayTimer) << 48
+		| static_cast<unsigned long long>(m_SoundTimer) << 56);
+	for (int i = 0; i < m_StackPointer && i < STACK_COUNT; ++i)
+		add(m_Stack[i]);
+	add(m_RandomState[0] | static_cast<unsigned long long>(m_RandomState[1]) << 32);
+	add(m_RandomState[2] | static_cast<unsigned long long>(m_RandomState[3]) << 32);
+	add(static_cast<unsigned long long>(m_FrameCycle));
+	return hash;
+}
+
+unsigned char* Interpreter::PageBytes(int page)
+{
+	static_assert(sizeof(m_Memory) == PagedState::MEMORY_PAGES * PagePool::PAGE_SIZE, "memory doesn't fill its pages");
+	static_assert(sizeof(m_Screen) == PagedState::SCREEN_PAGES * PagePool::PAGE_SIZE, "the display doesn't fill its pages");
+
+	if (page < PagedState::MEMORY_PAGES)
+		return m_Memory + page * PagePool::PAGE_SIZE;
+	return reinterpret_cast<unsigned char*>(m_Screen) + (page - PagedState::MEMORY_PAGES) * PagePool::PAGE_SIZE;
+}
+
+void Interpreter::Fork(PagePool& pool, PagedState& state)
+{
+	const bool tracking = !m_ForkBase.IsEmpty();
+	if (m_ForkBase.m_Pool != &pool)
+	{
+		m_ForkBase.Clear();
+		m_ForkBase.m_Pool = &pool;
+		m_DirtyPages = ~0ull;
+	}
+
+	//Pages that weren't written stay shared, a written page only gets a copy if its contents changed
+	for (int page = 0; page < PagedState::PAGE_COUNT; ++page)
+	{
+		if (((m_DirtyPages >> page) & 1) == 0)
+			continue;
+
+		const unsigned char* bytes = PageBytes(page);
+		const PagePool::Page* shared = m_ForkBase.m_Pages[page];
+		if (shared != nullptr && std::memcmp(shared->bytes, bytes, PagePool::PAGE_SIZE) == 0)
+			continue;
+
+		PagePool::Page* copy = pool.Allocate();
+		std::memcpy(copy->bytes, bytes, PagePool::PAGE_SIZE);
+		m_ForkBase.SetPage(page, copy);
+	}
+	m_DirtyPages = 0;
+	if (!tracking)
+		UpdateWatchedPages();
+
+	state = m_ForkBase;
+	std::memcpy(state.m_V, m_V, sizeof(m_V));
+	std::memcpy(state.m_Stack, m_Stack, sizeof(m_Stack));
+	std::memcpy(state.m_RandomState, m_RandomState, sizeof(m_RandomState));
+	state.m_IndexRegister = m_IndexRegister;
+	state.m_ProgramCounter = m_ProgramCounter;
+	state.m_StackPointer = m_StackPointer;
+	state.m_Keypad = m_Keypad;
+	state.m_CycleCount = m_CycleCount;
+	state.m_DelayTimer = m_DelayTimer;
+	state.m_SoundTimer = m_SoundTimer;
+	state.m_DrawFlag = m_DrawFlag;
+	state.m_FrameCycle = m_FrameCycle;
+	state.m_FrameDrawn = m_FrameDrawn;
+}
+
+void Interpreter::Restore(const PagedState& state)
+{
+	if (state.IsEmpty())
+	{
+		std::cout << "Can't restore an empty paged state" << std::endl;
+		return;
+	}
+
+	const bool tracking = !m_ForkBase.IsEmpty();
+	for (int page = 0; page < PagedState::PAGE_COUNT; ++page)
+	{
+		if (state.m_Pages[page] != m_ForkBase.m_Pages[page] || ((m_DirtyPages >> page) & 1) != 0)
+			RestorePage(page, state.m_Pages[page]->bytes);
+	}
+	m_ForkBase = state;
+	m_DirtyPages = 0;
+	if (!tracking)
+		UpdateWatchedPages();
+
+	std::memcpy(m_V, state.m_V, sizeof(m_V));
+	std::memcpy(m_Stack, state.m_Stack, sizeof(m_Stack));
+	std::memcpy(m_RandomState, state.m_RandomState, sizeof(m_RandomState));
+	m_IndexRegister = state.m_IndexRegister;
+	m_ProgramCounter = state.m_ProgramCounter;
+	m_StackPointer = state.m_StackPointer;
+	m_Keypad = state.m_Keypad;
+	m_CycleCount = state.m_CycleCount;
+	m_DelayTimer = state.m_DelayTimer;
+	m_SoundTimer = state.m_SoundTimer;
+	m_DrawFlag = state.m_DrawFlag;
+	m_FrameCycle = state.m_FrameCycle;
+	m_FrameDrawn = state.m_FrameDrawn;
+	m_AtBreakpoint = false;
+	m_AtWatchpoint = false;
+}
+
+void Interpreter::RestorePage(int page, const unsigned char* bytes)
+{
+	unsigned char* target = PageBytes(page);
+	if (std::memcmp(target, bytes, PagePool::PAGE_SIZE) == 0)
+		return;
+
+	//Keep the state hash and the predecoded code up to date with the bytes that change, like a write would
+	const bool hashing = m_StateHashing && !m_StateHashStale;
+	if (page < PagedState::MEMORY_PAGES)
+	{
+		const int start = page * PagePool::PAGE_SIZE;
+		for (int address = start; address < start + PagePool::PAGE_SIZE; ++address)
+		{
+			const unsigned char value = bytes[address - start];
+			if (m_Memory[address] == value)
+				continue;
+
+			if (hashing)
+				m_MemoryHash ^= MemoryKey(address, m_Memory[address]) ^ MemoryKey(address, value);
+			if (!m_Predecoded.empty() && (m_Predecoded[address].decoded || m_Predecoded[(address - 1) & 0xFFF].decoded))
+				m_PredecodeStale = true;
+		}
+	}
+	else if (hashing)
+	{
+		const unsigned int* pixels = reinterpret_cast<const unsigned int*>(bytes);
+		const int start = (page - PagedState::MEMORY_PAGES) * SCREEN_WIDTH;
+		for (int i = 0; i < SCREEN_WIDTH; ++i)
+		{
+			if ((m_Screen[start + i] == m_PixelOn) != (pixels[i] == m_PixelOn))
+				m_ScreenHash ^= PixelKey(start + i);
+		}
+	}
+	std::memcpy(target, bytes, PagePool::PAGE_SIZE);
+}
+
+void Interpreter::CheckWatchpoint(unsigned short address, WatchAccess access, unsigned char value)
+{
+	if (m_AtWatchpoint || (GetWatchpoint(address) & access) == 0)
+		return;
+
+	//The instructions that access memory don't jump, so the program counter is still right behind them
+	m_AtWatchpoint = true;
+	m_WatchHit.address = address & 0xFFF;
+	m_WatchHit.instruction = static_cast<unsigned short>(m_ProgramCounter - 2);
+	m_WatchHit.value = value;
+	m_WatchHit.access = access;
+}
+
+void Interpreter::CheckReadWatchpoints(unsigned short address, int length)
+{
+	for (int i = 0; i < length; ++i)
+	{
+		const unsigned short current = static_cast<unsigned short>((address + i) & 0xFFF);
+		CheckWatchpoint(current, WATCH_READ, m_Memory[current]);
+	}
+}
+
+bool Interpreter::Execute(unsigned short opCode)
+{
 	// Decode opcode
 	switch (opCode & 0xF000) // read the first four bits of the current opcode (0xF000 in binary is 1111000000000000)
 	{
@@ -193,14 +994,20 @@ bool Interpreter::Cycle()
 
 		case 0x0001: //8XY1 	Sets VX to VX or VY.
 			m_V[X] = m_V[X] | m_V[Y];
+			if (m_Quirks.logicResetsVF)
+				m_V[0xF] = 0;
 			break;
 
 		case 0x0002: //8XY2 	Sets VX to VX and VY.
 			m_V[X] = m_V[X] & m_V[Y];
+			if (m_Quirks.logicResetsVF)
+				m_V[0xF] = 0;
 			break;
 
 		case 0x0003: //8XY3 	Sets VX to VX xor VY.
 			m_V[X] = m_V[X] ^ m_V[Y];
+			if (m_Quirks.logicResetsVF)
+				m_V[0xF] = 0;
 			break;
 
 		case 0x0004: /*8XY4		Adds VY to VX.
@@ -216,9 +1023,12 @@ bool Interpreter::Cycle()
 			break;
 
 		case 0x0006: //8XY6 	Shifts VX right by one. VF is set to the value of the least significant bit of VX before the shift.[2]
-			m_V[0xF] = m_V[X] & 1; //least significant bit
-			m_V[X] = m_V[X] >> 1;
-			break;
+		{
+			const unsigned char value = m_Quirks.shiftUsesVY ? m_V[Y] : m_V[X];
+			m_V[0xF] = value & 1; //least significant bit
+			m_V[X] = value >> 1;
+		}
+		break;
 
 		case 0x0007: //8XY7 	Sets VX to VY minus VX. VF is set to 0 when there's a borrow, and 1 when there isn't.
 			m_V[0xF] = (m_V[Y] > m_V[X]) ? 0 : 1;
@@ -226,9 +1036,12 @@ bool Interpreter::Cycle()
 			break;
 
 		case 0x000E: //8XYE 	Shifts VX left by one. VF is set to the value of the most significant bit of VX before the shift.
-			m_V[0xF] = (m_V[X] >> 7) & 1; // most significant bit
-			m_V[X] = m_V[X] << 1;
-			break;
+		{
+			const unsigned char value = m_Quirks.shiftUsesVY ? m_V[Y] : m_V[X];
+			m_V[0xF] = (value >> 7) & 1; // most significant bit
+			m_V[X] = value << 1;
+		}
+		break;
 
 		default: std::cout << "Invalid opcode in case 0x8000 \n";
 			break;
@@ -253,7 +1066,8 @@ bool Interpreter::Cycle()
 
 	case 0xB000: //BNNN 	Jumps to the address NNN plus V0.
 	{
-		m_ProgramCounter = (opCode & 0x0FFF) + m_V[0];
+		const unsigned char X = m_Quirks.jumpUsesVX ? (opCode & 0x0F00) >> 8 : 0;
+		m_ProgramCounter = (opCode & 0x0FFF) + m_V[X];
 	}
 	break;
 
@@ -261,7 +1075,7 @@ bool Interpreter::Cycle()
 	{
 		unsigned char X = (opCode & 0x0F00) >> 8;
 		unsigned char NN = (opCode & 0x00FF);
-		unsigned char randomNr = static_cast<unsigned char>(rand());
+		unsigned char randomNr = static_cast<unsigned char>(NextRandom() >> 24);
 		m_V[X] = randomNr & NN;
 	}
 	break;
@@ -270,33 +1084,17 @@ bool Interpreter::Cycle()
 	{
 		/*Draws a sprite at coordinate (VX, VY) that has a width of 8 pixels and a height of N pixels.
 		Each row of 8 pixels is read as bit-coded starting from memory location I;
-		I value doesnt change after the execution of this instruction.
+		I value doesn�t change after the execution of this instruction.
 		As described above, VF is set to 1 if any screen pixels are flipped from set to unset when the sprite is drawn,
-		and to 0 if that doesnt happen.*/
+		and to 0 if that doesn�t happen.*/
 
 		unsigned char x = m_V[(opCode & 0x0F00) >> 8];
 		unsigned char y = m_V[(opCode & 0x00F0) >> 4];
 		unsigned char height = (opCode & 0x000F);
 
-		m_V[0xF] = 0;
-		for (int h = 0; h < height; ++h)
-		{
-			unsigned char sprite = m_Memory[m_IndexRegister + h];
-			for (int w = 0; w < 8; ++w)
-			{
-				if ((sprite & (0x80 >> w)) != 0)
-				{
-					const int idx = (x + w + ((y + h) * SCREEN_WIDTH));
-
-					int curState = (m_Screen[idx] == m_PixelOn);
-					if (curState == 1)
-						m_V[0xF] = 1;
-
-					const int result = (curState ^= 1);
-					m_Screen[idx] = (result) ? m_PixelOn : m_PixelOff;
-				}
-			}
-		}
+		unsigned char rows[15];
+		WatchRead(m_IndexRegister, height);
+		DrawSprite(SpriteRows(m_IndexRegister, height, rows), x, y, height);
 		m_DrawFlag = true;
 	}
 	break;
@@ -400,12 +1198,12 @@ bool Interpreter::Cycle()
 			place the hundreds digit in memory at location in I,
 			the tens digit at location I+1, and the ones digit at location I+2.)*/
 
-			unsigned char dec = m_V[X] >> 8;
+			const unsigned char dec = m_V[X];
 
 			//e.g 261
-			m_Memory[m_IndexRegister] = dec / 100; //261 / 100 = 2
-			m_Memory[m_IndexRegister + 1] = (dec / 10) % 10; //261 / 10 = 26 -> 26 % 10 = 6
-			m_Memory[m_IndexRegister + 2] = dec % 10;
+			WriteMemory(m_IndexRegister, dec / 100); //261 / 100 = 2
+			WriteMemory(m_IndexRegister + 1, (dec / 10) % 10); //261 / 10 = 26 -> 26 % 10 = 6
+			WriteMemory(m_IndexRegister + 2, dec % 10);
 		}
 		break;
 
@@ -414,18 +1212,21 @@ bool Interpreter::Cycle()
 					 //			On current implementations, I is left unchanged.
 		{
 			for (int i = 0; i <= X; ++i)
-				m_Memory[m_IndexRegister + i] = m_V[i];
+				WriteMemory(static_cast<unsigned short>(m_IndexRegister + i), m_V[i]);
 
-			m_IndexRegister += X + 1;
+			if (m_Quirks.loadStoreIncrementsI)
+				m_IndexRegister += X + 1;
 		}
 		break;
 
 		case 0x0060: //FX65 	Fills V0 to VX (including VX) with values from memory starting at address I.[4]
 		{
+			WatchRead(m_IndexRegister, X + 1);
 			for (int i = 0; i <= X; ++i)
-				m_V[i] = m_Memory[m_IndexRegister + i];
+				m_V[i] = ReadMemory(static_cast<unsigned short>(m_IndexRegister + i));
 
-			m_IndexRegister += X + 1;
+			if (m_Quirks.loadStoreIncrementsI)
+				m_IndexRegister += X + 1;
 		}
 		break;
 		}
@@ -440,8 +1241,49 @@ bool Interpreter::Cycle()
 	break;
 	}
 
-	//Update timers
-	DecreaseTimers();
+	return true;
+}
+
+bool Interpreter::ExecuteWithoutFlag(unsigned short opCode)
+{
+	const unsigned char X = (opCode & 0x0F00) >> 8;
+	const unsigned char Y = (opCode & 0x00F0) >> 4;
+	switch (opCode & 0xF00F)
+	{
+	case 0x8004: //8XY4
+		m_V[X] += m_V[Y];
+		break;
+	case 0x8005: //8XY5
+		m_V[X] -= m_V[Y];
+		break;
+	case 0x8006: //8XY6
+		m_V[X] = (m_Quirks.shiftUsesVY ? m_V[Y] : m_V[X]) >> 1;
+		break;
+	case 0x8007: //8XY7
+		m_V[X] = m_V[Y] - m_V[X];
+		break;
+	case 0x800E: //8XYE
+		m_V[X] = (m_Quirks.shiftUsesVY ? m_V[Y] : m_V[X]) << 1;
+		break;
+	default:
+		if ((opCode & 0xF000) == 0xD000) //DXYN without collision detection
+		{
+			const unsigned char height = opCode & 0x000F;
+			unsigned char rows[15];
+			WatchRead(m_IndexRegister, height);
+			DrawSprite(SpriteRows(m_IndexRegister, height, rows), m_V[X], m_V[Y], height, false);
+			m_DrawFlag = true;
+		}
+		else if ((opCode & 0xF0FF) == 0xF01E) //FX1E
+		{
+			m_IndexRegister += m_V[X];
+		}
+		else
+		{
+			return Execute(opCode);
+		}
+		break;
+	}
 
 	return true;
 }
\ No newline at end of file
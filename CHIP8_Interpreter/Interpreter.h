@@ -1,28 +1,150 @@
 #pragma once
 
+#include "PagedState.h"
+
+#include <cstddef>
 #include <map>
 #include <string>
+#include <vector>
+
+class CallProfiler;
+class OpcodeProfiler;
+
+//Behaviour that differs between CHIP-8 implementations, the defaults match this interpreter's original behaviour
+struct Quirks
+{
+	bool shiftUsesVY = false; //8XY6/8XYE shift VY into VX (COSMAC VIP) instead of shifting VX in place
+	bool loadStoreIncrementsI = true; //FX55/FX65 leave I at I + X + 1 instead of unchanged
+	bool jumpUsesVX = false; //BXNN jumps to XNN + VX (CHIP-48) instead of NNN + V0
+	bool logicResetsVF = false; //8XY1/8XY2/8XY3 reset VF to 0
+	bool clipSprites = false; //sprites are clipped at the screen edges instead of wrapping around
+};
 
 class Interpreter
 {
 public:
 	Interpreter();
-	~Interpreter();
+	virtual ~Interpreter();
 
-	void LoadRom(const std::string& path);
+	virtual void LoadRom(const std::string& path);
 
-	void Initialize();
+	//Copies an already loaded rom (e.g. from a memory mapped RomArchive) to 0x200 with a single memcpy
+	virtual void LoadRom(const unsigned char* data, size_t size);
+
+	//Resets the whole machine, Initialize followed by LoadRom is a full rom reset
+	virtual void Initialize();
 	unsigned int* GetScreen();
 
-	bool Cycle();
+	//The display at 1 bit per pixel, row major with the leftmost pixel in the most significant bit
+	static const int PACKED_SCREEN_SIZE = 64 * 32 / 8;
+	void PackScreen(unsigned char* bits) const;
+
+	unsigned char GetSoundTimer() const { return m_SoundTimer; }
+	unsigned short GetProgramCounter() const { return m_ProgramCounter; }
+
+	//Single reads for tools that look at the machine after every frame, a Snapshot copies all of it
+	unsigned char ReadMemory(unsigned short address) const { return m_Memory[address & 0xFFF]; }
+	bool IsPixelOn(int x, int y) const { return m_Screen[(x % SCREEN_WIDTH) + (y % SCREEN_HEIGHT) * SCREEN_WIDTH] == m_PixelOn; }
+
+	virtual bool Cycle();
+
+	//Runs one 60hz frame: the configured amount of instructions followed by a timer tick.
+	//With breakpoints set the frame stops before an instruction at a breakpoint, the next RunFrame or Step finishes it
+	bool RunFrame();
+
+	//Runs a single instruction of the current frame, the last one of the frame also ticks the timers
+	bool Step();
+
+	//Breakpoints are a bitmap over the address space, RunFrame only checks it while at least one is set
+	void SetBreakpoint(unsigned short address, bool enabled);
+	bool HasBreakpoint(unsigned short address) const { return (m_Breakpoints[(address & 0xFFF) >> 6] >> (address & 63)) & 1; }
+	void ClearBreakpoints();
+	int GetBreakpointCount() const { return m_BreakpointCount; }
+
+	//Instructions of the current frame already run, 0 between frames
+	int GetFrameCycle() const { return m_FrameCycle; }
+
+	//True when the last RunFrame stopped at a breakpoint instead of finishing the frame
+	bool IsAtBreakpoint() const { return m_AtBreakpoint; }
+
+	//Watchpoints stop the frame after an instruction that reads (DXYN, FX65) or writes (FX33, FX55) a watched address.
+	//Memory is split in 16 pages of 256 bytes, an access to a page without watchpoints costs one bit test
+	enum WatchAccess
+	{
+		WATCH_READ = 1,
+		WATCH_WRITE = 2
+	};
+
+	struct WatchHit
+	{
+		unsigned short address;
+		unsigned short instruction; //address of the instruction that made the access
+		unsigned char value; //value read or written
+		WatchAccess access;
+	};
+
+	//access is a combination of WatchAccess flags, 0 removes the watchpoint
+	void SetWatchpoint(unsigned short address, int access);
+	int GetWatchpoint(unsigned short address) const;
+	void ClearWatchpoints();
+	int GetWatchpointCount() const { return m_WatchpointCount; }
+
+	//True when the last RunFrame or Step stopped after an instruction that hit a watchpoint, the first hit is kept
+	bool IsAtWatchpoint() const { return m_AtWatchpoint; }
+	const WatchHit& GetWatchHit() const { return m_WatchHit; }
+
+	void SetQuirks(const Quirks& quirks) { m_Quirks = quirks; m_PredecodeStale = true; }
+	const Quirks& GetQuirks() const { return m_Quirks; }
+
+	void SetInstructionsPerFrame(int instructionsPerFrame) { m_InstructionsPerFrame = instructionsPerFrame; }
+	int GetInstructionsPerFrame() const { return m_InstructionsPerFrame; }
+
+	//Changes the pixel colors, pixels already on the screen are recolored
+	void SetColors(unsigned int pixelOn, unsigned int pixelOff);
+
+	//CXNN draws from a per instance xoshiro128** generator, Initialize restarts it from this seed
+	void SetSeed(unsigned long long seed);
+	unsigned long long GetSeed() const { return m_Seed; }
 
-private:
+	//Frames that are simulated but not shown (run-ahead) shouldn't beep
+	void SetSoundEnabled(bool enabled) { m_SoundEnabled = enabled; }
+	bool IsSoundEnabled() const { return m_SoundEnabled; }
+
+	//64 bit hash of the machine state: memory, display, registers, the used part of the stack, timers and the random generator.
+	//With hashing enabled memory writes and pixel flips keep the memory and display parts up to date, so a call hashes a few dozen values
+	//instead of 6 KB. The keypad, cycle count and configuration are not part of it
+	void SetStateHashing(bool enabled);
+	unsigned long long GetStateHash();
+
+	//Instructions executed since Initialize, input movies are stamped with it
+	unsigned long long GetCycleCount() const { return m_CycleCount; }
+
+	/* Predecoded dispatch: the reachable code of memory (see RomAnalysis) is decoded into a table once, instructions that set VF as a side
+	result are run without computing it where the analysis found the program overwrites VF before reading it (a DXYN skips collision
+	detection). Writing a predecoded byte, loading a state or changing the quirks decodes again before the next instruction.
+	VF can hold a different value than with the plain dispatch until the program overwrites it, the program itself can't tell.
+	MEGA-CHIP keeps its own dispatch*/
+	void SetPredecoded(bool enabled);
+	bool IsPredecoded() const { return !m_Predecoded.empty(); }
+
+	//A frame that is spent in an FX07 / 3X00 / 1NNN loop polling the delay timer is finished in one step, with the registers, program counter
+	//and cycle count that running it would leave. For headless runs; the profilers have to see every instruction, so it is off while one is set
+	void SetFastForward(bool enabled) { m_FastForward = enabled; }
+	bool IsFastForward() const { return m_FastForward; }
+
+	//Only used when built with CHIP8_PROFILE, the profilers are not owned
+	void SetOpcodeProfiler(OpcodeProfiler* profiler) { m_OpcodeProfiler = profiler; }
+	void SetCallProfiler(CallProfiler* profiler) { m_CallProfiler = profiler; }
+
+protected:
 
 	/* Systems memory map (total system memory is 4096 bytes)
 	0x000-0x1FF - Chip 8 interpreter (contains font set in emu)
 	0x050-0x0A0 - Used for the built in 4x5 pixel font set (0-F)
 	0x200-0xFFF - Program ROM and work RAM*/
-	unsigned char m_Memory[4096];
+	static const int MEMORY_SIZE = 4096;
+	static const int PROGRAM_START = 0x200;
+	unsigned char m_Memory[MEMORY_SIZE];
 
 	static const int REGISTER_COUNT = 16;
 	unsigned char m_V[REGISTER_COUNT]; //16 8-bit registers named from V0 to VF
@@ -69,15 +191,175 @@ private:
 	};
 
 	//Current values for on and off (instead of boring black and white ;) )
-	unsigned int m_PixelOff = 0;
-	unsigned int m_PixelOn = 0;
+	unsigned int m_PixelOff = 0x00000000;
+	unsigned int m_PixelOn = 0xFFFFFF00;
+
+	Quirks m_Quirks;
+	int m_InstructionsPerFrame = 10;
+
+	unsigned long long m_Seed = 1;
+	unsigned int m_RandomState[4];
+	unsigned long long m_CycleCount = 0;
+	bool m_SoundEnabled = true;
+
+	OpcodeProfiler* m_OpcodeProfiler = nullptr;
+	CallProfiler* m_CallProfiler = nullptr;
+
+	unsigned long long m_Breakpoints[MEMORY_SIZE / 64] = {};
+	int m_BreakpointCount = 0;
+	bool m_AtBreakpoint = false;
+
+	unsigned long long m_ReadWatchpoints[MEMORY_SIZE / 64] = {};
+	unsigned long long m_WriteWatchpoints[MEMORY_SIZE / 64] = {};
+	unsigned short m_ReadWatchedPages = 0; //bit per 256 byte page with at least one watchpoint
+	unsigned short m_WriteWatchedPages = 0;
+	int m_WatchpointCount = 0;
+	bool m_AtWatchpoint = false;
+	WatchHit m_WatchHit = {};
+
+	struct PredecodedInstruction
+	{
+		unsigned short opCode;
+		bool decoded; //a reachable instruction, anything else is fetched from memory
+		bool flagDead; //VF is overwritten before it is read
+	};
+	std::vector<PredecodedInstruction> m_Predecoded; //one per address while enabled
+	unsigned short m_PredecodedPages = 0; //bit per 256 byte page holding predecoded code
+	unsigned short m_CheckedWritePages = 0; //pages with write watchpoints or predecoded code, all of them while hashing or forking
+	bool m_PredecodeStale = true;
+
+	bool m_FastForward = false;
+
+	bool m_StateHashing = false;
+	bool m_StateHashStale = true; //memory or display were replaced as a whole
+
+	//Pages of the last Fork or Restore and a bit per page (memory, then display rows) changed since, all of them when there is none
+	PagedState m_ForkBase;
+	unsigned long long m_DirtyPages = ~0ull;
+	unsigned long long m_MemoryHash = 0; //xor of a key per address and value
+	unsigned long long m_ScreenHash = 0; //xor of a key per lit pixel
+
+	//Progress of a frame that a breakpoint, watchpoint or Step interrupted
+	int m_FrameCycle = 0;
+	bool m_FrameDrawn = false;
 
 public:
 	//unsigned char m_Keypad[KEYPAD_COUNT];
 	unsigned short m_Keypad; //work with one 16 bit integer instead of a 1 bit char array of 16, easier to check if none have been pressed
 	bool m_DrawFlag = false;
 
-private:
+	//Plain copy of the machine state for in-process clones (run-ahead, rewind, search), saving and loading are a handful of memcpys.
+	//Configuration (quirks, speed, colors) and the MEGA-CHIP extension state are not part of it
+	struct Snapshot
+	{
+		unsigned char memory[MEMORY_SIZE];
+		unsigned int screen[PIXEL_COUNT];
+		unsigned char v[REGISTER_COUNT];
+		unsigned short stack[STACK_COUNT];
+		unsigned short indexRegister;
+		unsigned short programCounter;
+		unsigned short stackPointer;
+		unsigned short keypad;
+		unsigned int randomState[4];
+		unsigned long long cycleCount;
+		unsigned char delayTimer;
+		unsigned char soundTimer;
+		bool drawFlag;
+		int frameCycle; //instructions of the current frame already run, 0 outside the debugger
+		bool frameDrawn;
+	};
+
+	void SaveSnapshot(Snapshot& snapshot) const;
+	void LoadSnapshot(const Snapshot& snapshot);
+
+	/* Copy-on-write clones for tree search: Fork stores the machine state in state as pages of pool, sharing every page that wasn't written
+	since the last Fork or Restore (memory writes and drawn display rows are tracked per page), so forking a machine that ran a few frames
+	copies a handful of pages and a state kept in many places shares its memory. Restore copies back only the pages that differ from the
+	ones the interpreter last forked or restored, going back and forth between a node and its children is cheap in both directions.
+	Neither allocates once the pool holds enough pages. The interpreter keeps the pages of its last Fork or Restore, the pool has to outlive it.
+	Covers what a Snapshot covers*/
+	void Fork(PagePool& pool, PagedState& state);
+	void Restore(const PagedState& state);
+
+	//Versioned binary save state for files, little endian with the display packed to 1 bit per pixel
+	static const int STATE_SIZE = 6 + MEMORY_SIZE + REGISTER_COUNT + 5 + STACK_COUNT * 2 + 5 + PIXEL_COUNT / 8 + 24;
+	void SaveState(std::vector<unsigned char>& state) const;
+	bool LoadState(const unsigned char* data, size_t size);
+
+protected:
 	void DecreaseTimers();
+	bool RunFrameChecked();
+	bool SkipDelayWait();
+	bool IsDelayLoop(unsigned int address) const;
+
+	//The opcode the next Cycle would run at address
+	virtual unsigned short PeekOpCode(unsigned int address) const { return static_cast<unsigned short>(m_Memory[address & 0xFFF] << 8 | m_Memory[(address + 1) & 0xFFF]); }
+	void EndFrame(bool drawn);
+
+	//Instructions write memory through here, so watchpoints, the predecoded code, the state hash and forking see every write.
+	//An address past the end wraps around like the program counter
+	void WriteMemory(unsigned short address, unsigned char value)
+	{
+		address &= 0xFFF;
+		if ((m_CheckedWritePages >> (address >> 8)) & 1)
+			CheckWrite(address, value);
+		m_Memory[address] = value;
+	}
+
+	//The height rows of the sprite at address, copied to buffer when they wrap around the end of memory
+	const unsigned char* SpriteRows(unsigned short address, int height, unsigned char* buffer) const
+	{
+		address &= 0xFFF;
+		if (address + height <= MEMORY_SIZE)
+			return m_Memory + address;
+
+		for (int i = 0; i < height; ++i)
+			buffer[i] = m_Memory[(address + i) & 0xFFF];
+		return buffer;
+	}
+
+	//Called by instructions before they read length bytes from address
+	void WatchRead(unsigned short address, int length)
+	{
+		if ((m_ReadWatchedPages & PageRange(address, length)) != 0)
+			CheckReadWatchpoints(address, length);
+	}
+
+	static unsigned short PageRange(unsigned int address, int length)
+	{
+		const unsigned int first = (address >> 8) & 0xF;
+		const unsigned int last = ((address + length - 1) >> 8) & 0xF;
+		return static_cast<unsigned short>((last >= first) ? (2u << last) - (1u << first) : 0xFFFF);
+	}
+
+	void CheckWrite(unsigned short address, unsigned char value);
+	void CheckWatchpoint(unsigned short address, WatchAccess access, unsigned char value);
+	void CheckReadWatchpoints(unsigned short address, int length);
+	void UpdateWatchedPages();
+	void HashMemoryAndScreen();
+	void RestorePage(int page, const unsigned char* bytes);
+	unsigned char* PageBytes(int page);
+	void Predecode();
+
+	//The entry at the program counter, null when it has to be fetched from memory
+	const PredecodedInstruction* FindPredecoded()
+	{
+		if (m_PredecodeStale)
+			Predecode();
+
+		const PredecodedInstruction& instruction = m_Predecoded[m_ProgramCounter & 0xFFF];
+		return instruction.decoded ? &instruction : nullptr;
+	}
 	void ClearScreen();
+	unsigned int NextRandom();
+
+	//Executes an already fetched opcode, returns false when the opcode is invalid
+	bool Execute(unsigned short opCode);
+
+	//Executes an instruction whose VF result is never read, the ones that set VF as a side result leave it alone
+	bool ExecuteWithoutFlag(unsigned short opCode);
+
+	//Draws an 8 pixel wide sprite of height rows, VF is set on collision unless collision is false.
+	//The start position always wraps, the sprite itself wraps or clips depending on the quirks
+	void DrawSprite(const unsigned char* sprite, unsigned char x, unsigned char y, unsigned char height, bool collision = true);
 };
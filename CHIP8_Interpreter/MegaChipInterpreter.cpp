@@ -0,0 +1,522 @@
+#include "MegaChipInterpreter.h"
+
+#ifdef CHIP8_PROFILE
+#include "CallProfiler.h"
+#include "OpcodeProfiler.h"
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+
+unsigned int RgbaToU32(unsigned char r, unsigned char g, unsigned char b, unsigned char a);
+
+void MegaChipInterpreter::DirtyRegion::Add(int l, int t, int r, int b)
+{
+	if (r <= l || b <= t)
+		return;
+
+	if (IsEmpty())
+	{
+		left = l; top = t; right = r; bottom = b;
+		return;
+	}
+
+	left = std::min(left, l);
+	top = std::min(top, t);
+	right = std::max(right, r);
+	bottom = std::max(bottom, b);
+}
+
+MegaChipInterpreter::MegaChipInterpreter()
+	: m_MegaMemory(MEGA_MEMORY_SIZE + MEGA_MEMORY_PADDING, 0)
+	, m_BackIndices(MEGA_PIXEL_COUNT, 0)
+	, m_BackColors(MEGA_PIXEL_COUNT, 0)
+	, m_FrontIndices(MEGA_PIXEL_COUNT, 0)
+	, m_FrontColors(MEGA_PIXEL_COUNT, 0)
+{
+}
+
+MegaChipInterpreter::~MegaChipInterpreter()
+{
+}
+
+void MegaChipInterpreter::Initialize()
+{
+	Interpreter::Initialize();
+
+	//The fontset lives in the megachip address space as well, FX29 points I there
+	std::fill(m_MegaMemory.begin(), m_MegaMemory.end(), static_cast<unsigned char>(0));
+	for (int i = 0; i < FONTSET_SIZE; ++i)
+		m_MegaMemory[i] = m_Fontset[i];
+
+	m_MegaIndexRegister = 0;
+	m_MegaMode = false;
+	m_Halted = false;
+
+	m_Palette[0] = m_PixelOff;
+	for (int i = 1; i < PALETTE_SIZE; ++i)
+		m_Palette[i] = m_PixelOn;
+
+	m_SpriteWidth = 0;
+	m_SpriteHeight = 0;
+	m_ScreenAlpha = 0xFF;
+	m_BlendMode = BLEND_NORMAL;
+	m_CollisionColor = 0;
+
+	std::fill(m_BackIndices.begin(), m_BackIndices.end(), static_cast<unsigned char>(0));
+	std::fill(m_FrontIndices.begin(), m_FrontIndices.end(), static_cast<unsigned char>(0));
+	std::fill(m_BackColors.begin(), m_BackColors.end(), m_PixelOff);
+	std::fill(m_FrontColors.begin(), m_FrontColors.end(), m_PixelOff);
+
+	m_BackRegion.Clear();
+	m_FrontRegion.Clear();
+	m_UploadRegion.Clear();
+}
+
+void MegaChipInterpreter::LoadRom(const std::string& path)
+{
+	std::ifstream Rom;
+	Rom.open(path, std::ios_base::binary | std::ios_base::ate);
+	if (Rom.fail())
+	{
+		std::cout << "Failed to load Rom with path " << path << std::endl;
+		return;
+	}
+	const int fileSize = std::min(static_cast<int>(Rom.tellg()), MEGA_MEMORY_SIZE - 512);
+	Rom.seekg(0); //go back to the beginning of the file
+
+	Rom.read(reinterpret_cast<char*>(m_MegaMemory.data() + 512), fileSize);
+}
+
+void MegaChipInterpreter::LoadRom(const unsigned char* data, size_t size)
+{
+	std::memcpy(m_MegaMemory.data() + PROGRAM_START, data, std::min(size, static_cast<size_t>(MEGA_MEMORY_SIZE - PROGRAM_START)));
+}
+
+unsigned int* MegaChipInterpreter::GetMegaScreen()
+{
+	return m_FrontColors.data();
+}
+
+bool MegaChipInterpreter::Cycle()
+{
+	if (m_Halted)
+		return false;
+
+	// Reset draw flag
+	m_DrawFlag = false;
+
+	// Fetch opcode from the megachip address space
+	unsigned char o = ReadMega(m_ProgramCounter++);
+	unsigned char p = ReadMega(m_ProgramCounter++);
+	unsigned short opCode = o << 8 | p;
+	++m_CycleCount;
+
+#ifdef CHIP8_PROFILE
+	if (m_OpcodeProfiler != nullptr)
+		m_OpcodeProfiler->Record(m_ProgramCounter - 2, opCode);
+	if (m_CallProfiler != nullptr)
+		m_CallProfiler->Record(opCode);
+#endif
+
+	return ExecuteMega(opCode);
+}
+
+bool MegaChipInterpreter::ExecuteMega(unsigned short opCode)
+{
+	switch (opCode & 0xF000)
+	{
+	case 0x0000:
+	{
+		switch (opCode & 0xFF00)
+		{
+		case 0x0000:
+		{
+			if (opCode == 0x0010) //0010 	Disable megachip mode
+			{
+				EnableMegaMode(false);
+			}
+			else if (opCode == 0x0011) //0011 	Enable megachip mode
+			{
+				EnableMegaMode(true);
+			}
+			else if ((opCode & 0xFFF0) == 0x00B0) //00BN 	Scroll up N lines
+			{
+				if (m_MegaMode)
+					ScrollVertical(-(opCode & 0x000F));
+			}
+			else if ((opCode & 0xFFF0) == 0x00C0) //00CN 	Scroll down N lines
+			{
+				if (m_MegaMode)
+					ScrollVertical(opCode & 0x000F);
+			}
+			else if (opCode == 0x00E0) //00E0 	Present the drawn frame in megachip mode, clear the screen otherwise
+			{
+				if (m_MegaMode)
+					PresentFrame();
+				else
+					ClearScreen();
+			}
+			else if (opCode == 0x00FB) //00FB 	Scroll right 4 pixels
+			{
+				if (m_MegaMode)
+					ScrollHorizontal(4);
+			}
+			else if (opCode == 0x00FC) //00FC 	Scroll left 4 pixels
+			{
+				if (m_MegaMode)
+					ScrollHorizontal(-4);
+			}
+			else if (opCode == 0x00FD) //00FD 	Exit
+			{
+				m_Halted = true;
+				return false;
+			}
+			else if (opCode == 0x00FE || opCode == 0x00FF) //00FE/00FF 	Extended screen toggle, the megachip display is always 256x192
+			{
+			}
+			else
+			{
+				return Interpreter::Execute(opCode);
+			}
+		}
+		break;
+
+		case 0x0100: //01NN NNNN 	Sets I to the 24 bit address NNNNNN, the low 16 bits are the next word
+		{
+			const unsigned int low = ReadMega(m_ProgramCounter) << 8 | ReadMega(m_ProgramCounter + 1);
+			m_ProgramCounter += 2;
+			m_MegaIndexRegister = ((opCode & 0x00FF) << 16 | low) & MEGA_ADDRESS_MASK;
+		}
+		break;
+
+		case 0x0200: //02NN 	Loads NN ARGB colors from I into palette index 1 to NN
+		{
+			const int count = opCode & 0x00FF;
+			for (int i = 0; i < count; ++i)
+			{
+				const unsigned int address = m_MegaIndexRegister + i * 4;
+				m_Palette[i + 1] = RgbaToU32(ReadMega(address + 1), ReadMega(address + 2), ReadMega(address + 3), ReadMega(address));
+			}
+		}
+		break;
+
+		case 0x0300: //03NN 	Sets the sprite width to NN
+			m_SpriteWidth = ((opCode & 0x00FF) == 0) ? 256 : (opCode & 0x00FF);
+			break;
+
+		case 0x0400: //04NN 	Sets the sprite height to NN
+			m_SpriteHeight = ((opCode & 0x00FF) == 0) ? 256 : (opCode & 0x00FF);
+			break;
+
+		case 0x0500: //05NN 	Sets the screen alpha to NN
+			m_ScreenAlpha = opCode & 0x00FF;
+			break;
+
+		case 0x0600: //060N 	Play digitised sound at I
+		case 0x0700: //0700 	Stop sound
+			//There is no audio output, same as the buzzer only being printed
+			break;
+
+		case 0x0800: //080N 	Sets the sprite blend mode
+			m_BlendMode = opCode & 0x000F;
+			break;
+
+		case 0x0900: //09NN 	Sets the collision color index
+			m_CollisionColor = opCode & 0x00FF;
+			break;
+
+		default: std::cout << "Invalid megachip opcode: " << std::hex << opCode << std::endl;
+			break;
+		}
+	}
+	break;
+
+	case 0xA000: //ANNN 	Sets I to the address NNN.
+	{
+		m_MegaIndexRegister = opCode & 0x0FFF;
+	}
+	break;
+
+	case 0xD000: //DXYN
+	{
+		const unsigned char x = m_V[(opCode & 0x0F00) >> 8];
+		const unsigned char y = m_V[(opCode & 0x00F0) >> 4];
+		const unsigned char height = (opCode & 0x000F);
+
+		if (!m_MegaMode)
+		{
+			DrawSprite(&m_MegaMemory[m_MegaIndexRegister & MEGA_ADDRESS_MASK], x, y, height);
+			m_DrawFlag = true;
+		}
+		else if (m_MegaIndexRegister < FONTSET_SIZE)
+		{
+			DrawFontSprite(x, y, height);
+		}
+		else
+		{
+			DrawMegaSprite(x, y);
+		}
+	}
+	break;
+
+	case 0xF000:
+	{
+		switch (opCode & 0x00FF)
+		{
+		case 0x001E:
+		case 0x0029:
+		case 0x0033:
+		case 0x0055:
+		case 0x0065:
+			ExecuteLoadStore(opCode);
+			break;
+
+		default:
+			return Interpreter::Execute(opCode);
+		}
+	}
+	break;
+
+	default:
+		return Interpreter::Execute(opCode);
+	}
+
+	return true;
+}
+
+void MegaChipInterpreter::ExecuteLoadStore(unsigned short opCode)
+{
+	const unsigned char X = (opCode & 0x0F00) >> 8;
+
+	switch (opCode & 0x00FF)
+	{
+	case 0x001E: //FX1E 	Adds VX to I, VF is set on range overflow
+	{
+		const unsigned int sum = m_MegaIndexRegister + m_V[X];
+		m_V[0xF] = (sum > MEGA_ADDRESS_MASK) ? 1 : 0;
+		m_MegaIndexRegister = sum & MEGA_ADDRESS_MASK;
+	}
+	break;
+
+	case 0x0029: //FX29 	Sets I to the location of the font sprite for the character in VX
+		m_MegaIndexRegister = m_V[X] * 5;
+		break;
+
+	case 0x0033: //FX33 	Stores the binary-coded decimal representation of VX at I, I+1 and I+2
+	{
+		const unsigned char dec = m_V[X];
+		WriteMega(m_MegaIndexRegister, dec / 100);
+		WriteMega(m_MegaIndexRegister + 1, (dec / 10) % 10);
+		WriteMega(m_MegaIndexRegister + 2, dec % 10);
+	}
+	break;
+
+	case 0x0055: //FX55 	Stores V0 to VX (including VX) in memory starting at address I
+	{
+		for (int i = 0; i <= X; ++i)
+			WriteMega(m_MegaIndexRegister + i, m_V[i]);
+
+		if (m_Quirks.loadStoreIncrementsI)
+			m_MegaIndexRegister = (m_MegaIndexRegister + X + 1) & MEGA_ADDRESS_MASK;
+	}
+	break;
+
+	case 0x0065: //FX65 	Fills V0 to VX (including VX) with values from memory starting at address I
+	{
+		for (int i = 0; i <= X; ++i)
+			m_V[i] = ReadMega(m_MegaIndexRegister + i);
+
+		if (m_Quirks.loadStoreIncrementsI)
+			m_MegaIndexRegister = (m_MegaIndexRegister + X + 1) & MEGA_ADDRESS_MASK;
+	}
+	break;
+	}
+}
+
+void MegaChipInterpreter::EnableMegaMode(bool enable)
+{
+	m_MegaMode = enable;
+
+	if (enable)
+	{
+		m_FrontRegion.Add(0, 0, MEGA_WIDTH, MEGA_HEIGHT);
+		m_BackRegion.Add(0, 0, MEGA_WIDTH, MEGA_HEIGHT);
+		ClearBack(m_BackRegion);
+		PresentFrame();
+	}
+	else
+	{
+		ClearScreen();
+	}
+}
+
+void MegaChipInterpreter::PresentFrame()
+{
+	//Everything that differs between the old and new front buffer was drawn into one of them
+	m_UploadRegion.Add(m_FrontRegion);
+	m_UploadRegion.Add(m_BackRegion);
+
+	std::swap(m_FrontIndices, m_BackIndices);
+	std::swap(m_FrontColors, m_BackColors);
+
+	//The old front buffer becomes the back buffer, only the part that was drawn needs clearing
+	const DirtyRegion oldFront = m_FrontRegion;
+	m_FrontRegion = m_BackRegion;
+	ClearBack(oldFront);
+	m_BackRegion.Clear();
+
+	m_DrawFlag = true;
+}
+
+void MegaChipInterpreter::ClearBack(const DirtyRegion& region)
+{
+	if (region.IsEmpty())
+		return;
+
+	const int width = region.right - region.left;
+	for (int row = region.top; row < region.bottom; ++row)
+	{
+		const int start = row * MEGA_WIDTH + region.left;
+		std::fill_n(m_BackIndices.begin() + start, width, static_cast<unsigned char>(0));
+		std::fill_n(m_BackColors.begin() + start, width, m_PixelOff);
+	}
+}
+
+void MegaChipInterpreter::DrawMegaSprite(int x, int y)
+{
+	//Sprites are SpriteWidth x SpriteHeight palette indices, index 0 is transparent and sprites clip at the edges
+	m_V[0xF] = 0;
+
+	const int right = std::min(x + m_SpriteWidth, MEGA_WIDTH);
+	const int bottom = std::min(y + m_SpriteHeight, MEGA_HEIGHT);
+
+	for (int row = y; row < bottom; ++row)
+	{
+		unsigned int address = m_MegaIndexRegister + (row - y) * m_SpriteWidth;
+		for (int column = x; column < right; ++column, ++address)
+		{
+			const unsigned char index = ReadMega(address);
+			if (index == 0)
+				continue;
+
+			const int pixel = row * MEGA_WIDTH + column;
+			if (m_BackIndices[pixel] == m_CollisionColor)
+				m_V[0xF] = 1;
+
+			m_BackIndices[pixel] = index;
+			m_BackColors[pixel] = Blend(m_Palette[index], m_BackColors[pixel]);
+		}
+	}
+
+	m_BackRegion.Add(x, y, right, bottom);
+}
+
+void MegaChipInterpreter::DrawFontSprite(int x, int y, int height)
+{
+	//1 bit font sprites keep their xor behaviour and use the last palette entry
+	m_V[0xF] = 0;
+
+	const unsigned char index = PALETTE_SIZE - 1;
+	const int right = std::min(x + 8, MEGA_WIDTH);
+	const int bottom = std::min(y + height, MEGA_HEIGHT);
+
+	for (int row = y; row < bottom; ++row)
+	{
+		const unsigned char sprite = ReadMega(m_MegaIndexRegister + (row - y));
+		for (int column = x; column < right; ++column)
+		{
+			if ((sprite & (0x80 >> (column - x))) == 0)
+				continue;
+
+			const int pixel = row * MEGA_WIDTH + column;
+			if (m_BackIndices[pixel] != 0)
+			{
+				m_V[0xF] = 1;
+				m_BackIndices[pixel] = 0;
+				m_BackColors[pixel] = m_PixelOff;
+			}
+			else
+			{
+				m_BackIndices[pixel] = index;
+				m_BackColors[pixel] = m_Palette[index];
+			}
+		}
+	}
+
+	m_BackRegion.Add(x, y, right, bottom);
+}
+
+unsigned int MegaChipInterpreter::Blend(unsigned int src, unsigned int dst) const
+{
+	if (m_BlendMode == BLEND_NORMAL)
+		return src;
+
+	//Blend the r, g and b channels, alpha is taken from the sprite
+	unsigned int result = src & 0xFF;
+	for (int shift = 8; shift < 32; shift += 8)
+	{
+		const unsigned int s = (src >> shift) & 0xFF;
+		const unsigned int d = (dst >> shift) & 0xFF;
+
+		unsigned int c = s;
+		switch (m_BlendMode)
+		{
+		case BLEND_25: c = (s + 3 * d) / 4; break;
+		case BLEND_50: c = (s + d) / 2; break;
+		case BLEND_75: c = (3 * s + d) / 4; break;
+		case BLEND_ADD: c = std::min(s + d, 255u); break;
+		case BLEND_MULTIPLY: c = (s * d) / 255; break;
+		}
+
+		result |= c << shift;
+	}
+	return result;
+}
+
+void MegaChipInterpreter::ScrollVertical(int lines)
+{
+	//Positive lines scroll down, the uncovered rows are cleared
+	if (lines == 0)
+		return;
+
+	const int count = (MEGA_HEIGHT - std::abs(lines)) * MEGA_WIDTH;
+	const int src = (lines > 0) ? 0 : -lines * MEGA_WIDTH;
+	const int dst = (lines > 0) ? lines * MEGA_WIDTH : 0;
+	std::memmove(&m_BackIndices[dst], &m_BackIndices[src], count * sizeof(unsigned char));
+	std::memmove(&m_BackColors[dst], &m_BackColors[src], count * sizeof(unsigned int));
+
+	DirtyRegion uncovered;
+	if (lines > 0)
+		uncovered.Add(0, 0, MEGA_WIDTH, lines);
+	else
+		uncovered.Add(0, MEGA_HEIGHT + lines, MEGA_WIDTH, MEGA_HEIGHT);
+	ClearBack(uncovered);
+
+	m_BackRegion.Add(0, 0, MEGA_WIDTH, MEGA_HEIGHT);
+}
+
+void MegaChipInterpreter::ScrollHorizontal(int pixels)
+{
+	//Positive pixels scroll right, the uncovered columns are cleared
+	const int count = MEGA_WIDTH - std::abs(pixels);
+	for (int row = 0; row < MEGA_HEIGHT; ++row)
+	{
+		const int start = row * MEGA_WIDTH;
+		const int src = start + ((pixels > 0) ? 0 : -pixels);
+		const int dst = start + ((pixels > 0) ? pixels : 0);
+		std::memmove(&m_BackIndices[dst], &m_BackIndices[src], count * sizeof(unsigned char));
+		std::memmove(&m_BackColors[dst], &m_BackColors[src], count * sizeof(unsigned int));
+	}
+
+	DirtyRegion uncovered;
+	if (pixels > 0)
+		uncovered.Add(0, 0, pixels, MEGA_HEIGHT);
+	else
+		uncovered.Add(MEGA_WIDTH + pixels, 0, MEGA_WIDTH, MEGA_HEIGHT);
+	ClearBack(uncovered);
+
+	m_BackRegion.Add(0, 0, MEGA_WIDTH, MEGA_HEIGHT);
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Interpreter.h"
+
+#include <string>
+#include <vector>
+
+/* MEGA-CHIP runs regular CHIP-8 until 0011 switches it into megachip mode.
+Megachip mode adds a 256x192 display of 8 bit palette indices and 24 bit addressing for I.
+0010 	Disable megachip mode			0011 	Enable megachip mode
+01NN 	(+NNNN) I = NNNNNN (24 bit)		02NN 	Load NN palette colors (ARGB) from I into index 1..NN
+03NN 	Sprite width NN (0 = 256)		04NN 	Sprite height NN (0 = 256)
+05NN 	Screen alpha NN					060N 	Play digitised sound at I
+0700 	Stop sound						080N 	Sprite blend mode N
+09NN 	Collision color index NN		00BN 	Scroll up N lines
+00CN 	Scroll down N lines				00FB 	Scroll right 4 pixels
+00FC 	Scroll left 4 pixels			00FD 	Exit
+00FE 	Disable extended screen			00FF 	Enable extended screen
+In megachip mode 00E0 presents the drawn frame and clears the draw buffer*/
+class MegaChipInterpreter : public Interpreter
+{
+public:
+	MegaChipInterpreter();
+	~MegaChipInterpreter();
+
+	void LoadRom(const std::string& path) override;
+	void LoadRom(const unsigned char* data, size_t size) override;
+
+	void Initialize() override;
+	bool Cycle() override;
+
+	static const int MEGA_WIDTH = 256;
+	static const int MEGA_HEIGHT = 192;
+
+	bool IsMegaMode() const { return m_MegaMode; }
+
+	//Presented RGBA frame (same pixel format as GetScreen), only valid in megachip mode
+	unsigned int* GetMegaScreen();
+	//Opacity 05NN sets for the whole presented frame, 0xFF is opaque
+	unsigned char GetScreenAlpha() const { return m_ScreenAlpha; }
+
+	//Rectangle of the presented frame that changed since the last upload, right and bottom are exclusive
+	struct DirtyRegion
+	{
+		int left = 0, top = 0, right = 0, bottom = 0;
+
+		bool IsEmpty() const { return right <= left || bottom <= top; }
+		void Add(int l, int t, int r, int b);
+		void Add(const DirtyRegion& other) { Add(other.left, other.top, other.right, other.bottom); }
+		void Clear() { left = top = right = bottom = 0; }
+	};
+
+	const DirtyRegion& GetDirtyRegion() const { return m_UploadRegion; }
+	void ClearDirtyRegion() { m_UploadRegion.Clear(); }
+
+private:
+	//16 MB address space, padded so 1 bit sprite rows never need wrapping
+	static const int MEGA_MEMORY_SIZE = 1 << 24;
+	static const int MEGA_ADDRESS_MASK = MEGA_MEMORY_SIZE - 1;
+	static const int MEGA_MEMORY_PADDING = 16;
+	static const int MEGA_PIXEL_COUNT = MEGA_WIDTH * MEGA_HEIGHT;
+	static const int PALETTE_SIZE = 256;
+
+	enum BlendMode
+	{
+		BLEND_NORMAL = 0,
+		BLEND_25 = 1,
+		BLEND_50 = 2,
+		BLEND_75 = 3,
+		BLEND_ADD = 4,
+		BLEND_MULTIPLY = 5
+	};
+
+	std::vector<unsigned char> m_MegaMemory;
+	unsigned int m_MegaIndexRegister = 0; //24 bit I, replaces m_IndexRegister for every memory access
+
+	bool m_MegaMode = false;
+	bool m_Halted = false;
+
+	unsigned int m_Palette[PALETTE_SIZE]; //RGBA, index 0 is transparent for sprites
+	int m_SpriteWidth = 0;
+	int m_SpriteHeight = 0;
+	unsigned char m_ScreenAlpha = 0xFF;
+	unsigned char m_BlendMode = BLEND_NORMAL;
+	unsigned char m_CollisionColor = 0;
+
+	//Sprites are drawn to the back buffers, 00E0 swaps them to the front
+	std::vector<unsigned char> m_BackIndices;
+	std::vector<unsigned int> m_BackColors;
+	std::vector<unsigned char> m_FrontIndices;
+	std::vector<unsigned int> m_FrontColors;
+
+	DirtyRegion m_BackRegion; //drawn into the back buffer since the last clear
+	DirtyRegion m_FrontRegion; //drawn into the current front buffer
+	DirtyRegion m_UploadRegion; //changed in the front buffer since the last upload
+
+	bool ExecuteMega(unsigned short opCode);
+	void ExecuteLoadStore(unsigned short opCode);
+
+	void EnableMegaMode(bool enable);
+	void PresentFrame();
+	void ClearBack(const DirtyRegion& region);
+	void DrawMegaSprite(int x, int y);
+	void DrawFontSprite(int x, int y, int height);
+	unsigned int Blend(unsigned int src, unsigned int dst) const;
+
+	void ScrollVertical(int lines);
+	void ScrollHorizontal(int pixels);
+
+	unsigned char ReadMega(unsigned int address) const { return m_MegaMemory[address & MEGA_ADDRESS_MASK]; }
+	void WriteMega(unsigned int address, unsigned char value) { m_MegaMemory[address & MEGA_ADDRESS_MASK] = value; }
+
+	//Code runs from the megachip address space, nothing runs once halted
+	unsigned short PeekOpCode(unsigned int address) const override { return m_Halted ? 0 : static_cast<unsigned short>(ReadMega(address) << 8 | ReadMega(address + 1)); }
+};
@@ -0,0 +1,251 @@
+#include "NetplaySession.h"
+
+#include "RomHash.h"
+#include "Socket.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	const size_t HEADER_SIZE = 19;
+	const int MAX_PACKET_INPUTS = 64;
+	const unsigned int NO_FRAME = 0xFFFFFFFF;
+
+	void WriteU32(unsigned char* out, unsigned int value)
+	{
+		for (int i = 0; i < 4; ++i)
+			out[i] = static_cast<unsigned char>(value >> (i * 8));
+	}
+
+	unsigned int ReadU32(const unsigned char* data)
+	{
+		return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<unsigned int>(data[3]) << 24);
+	}
+
+	//Covers everything that influences later frames, but not the colors or the draw flag.
+	//The keypad is left out, every frame sets it from the input of both sides
+	unsigned int Digest(const Interpreter::Snapshot& snapshot)
+	{
+		std::vector<unsigned char> bytes(snapshot.memory, snapshot.memory + sizeof(snapshot.memory));
+		bytes.insert(bytes.end(), snapshot.v, snapshot.v + sizeof(snapshot.v));
+		const unsigned short words[] = { snapshot.indexRegister, snapshot.programCounter, snapshot.stackPointer,
+			snapshot.delayTimer, snapshot.soundTimer };
+		for (unsigned short word : words)
+		{
+			bytes.push_back(static_cast<unsigned char>(word));
+			bytes.push_back(static_cast<unsigned char>(word >> 8));
+		}
+		for (unsigned short entry : snapshot.stack)
+		{
+			bytes.push_back(static_cast<unsigned char>(entry));
+			bytes.push_back(static_cast<unsigned char>(entry >> 8));
+		}
+		for (unsigned int state : snapshot.randomState)
+		{
+			for (int i = 0; i < 4; ++i)
+				bytes.push_back(static_cast<unsigned char>(state >> (i * 8)));
+		}
+		return Crc32(bytes.data(), bytes.size());
+	}
+}
+
+NetplaySession::NetplaySession(Interpreter& interpreter, UdpSocket& socket)
+	: m_Interpreter(interpreter)
+	, m_Socket(socket)
+	, m_RollbackFrame(0)
+{
+	for (int i = 0; i < HISTORY; ++i)
+		m_RemoteFrames[i] = -1;
+}
+
+void NetplaySession::SetSimulatedConditions(int latencyFrames, double lossRate, unsigned int seed)
+{
+	m_LatencyFrames = std::max(0, latencyFrames);
+	m_LossRate = std::min(1.0, std::max(0.0, lossRate));
+	m_LossState = (seed != 0) ? seed : 1;
+}
+
+unsigned short NetplaySession::RemoteInputFor(int frame) const
+{
+	const int slot = frame % HISTORY;
+	if (m_RemoteFrames[slot] == frame)
+		return m_RemoteInputs[slot];
+
+	//Prediction: the remote player keeps holding what they held last
+	return (m_RemoteConfirmed >= 0) ? m_RemoteInputs[m_RemoteConfirmed % HISTORY] : 0;
+}
+
+void NetplaySession::RunFrame(int frame)
+{
+	m_Interpreter.SaveSnapshot(m_Snapshots[frame % SNAPSHOT_COUNT]);
+
+	const unsigned short remote = RemoteInputFor(frame);
+	m_UsedRemoteInputs[frame % HISTORY] = remote;
+	m_Interpreter.m_Keypad = m_LocalInputs[frame % HISTORY] | remote;
+	if (!m_Interpreter.RunFrame())
+		m_Halted = true;
+}
+
+bool NetplaySession::AdvanceFrame(unsigned short localKeypad)
+{
+	//The frontend may have left its keys in the interpreter's keypad, they only count through localKeypad
+	m_Interpreter.m_Keypad = 0;
+
+	++m_Tick;
+	ReceivePackets();
+
+	//Correct the frames that ran on a wrong prediction
+	if (m_RollbackFrame < m_Frame)
+	{
+		const int rollback = m_Frame - m_RollbackFrame;
+		m_Interpreter.LoadSnapshot(m_Snapshots[m_RollbackFrame % SNAPSHOT_COUNT]);
+		//A halt during the mispredicted frames may not happen with the corrected input
+		m_Halted = false;
+		for (int frame = m_RollbackFrame; frame < m_Frame && !m_Halted; ++frame)
+			RunFrame(frame);
+		m_Interpreter.m_DrawFlag = true;
+
+		++m_RollbackCount;
+		m_ResimulatedFrames += rollback;
+		m_MaxRollback = std::max(m_MaxRollback, rollback);
+	}
+	m_RollbackFrame = m_Frame;
+	UpdateDigests();
+
+	//The snapshot of the oldest unconfirmed frame has to stay available
+	const bool stalled = m_Halted || m_Frame - (m_RemoteConfirmed + 1) >= MAX_ROLLBACK;
+	if (!stalled)
+	{
+		m_LocalInputs[m_Frame % HISTORY] = localKeypad;
+		RunFrame(m_Frame);
+		++m_Frame;
+		m_RollbackFrame = m_Frame;
+		UpdateDigests();
+	}
+	else
+	{
+		++m_StallCount;
+	}
+
+	SendInput();
+	return !stalled;
+}
+
+void NetplaySession::ReceivePackets()
+{
+	unsigned char packet[HEADER_SIZE + MAX_PACKET_INPUTS * 2];
+	int size;
+	while ((size = m_Socket.Receive(packet, sizeof(packet))) >= 0)
+	{
+		if (size < static_cast<int>(HEADER_SIZE) || packet[0] != 'N' || packet[1] != 'P')
+			continue;
+
+		const int firstFrame = static_cast<int>(ReadU32(packet + 2));
+		const int count = packet[6];
+		const unsigned int ack = ReadU32(packet + 7);
+		const unsigned int digestFrame = ReadU32(packet + 11);
+		if (size < static_cast<int>(HEADER_SIZE) + count * 2)
+			continue;
+
+		if (ack != NO_FRAME)
+			m_RemoteAck = std::max(m_RemoteAck, static_cast<int>(ack));
+		if (digestFrame != NO_FRAME)
+			m_RemoteDigests[static_cast<int>(digestFrame)] = ReadU32(packet + 15);
+
+		for (int i = 0; i < count; ++i)
+		{
+			//Inputs that are already confirmed or too far ahead for the history are dropped, they'll be resent
+			const int frame = firstFrame + i;
+			if (frame <= m_RemoteConfirmed || frame >= m_Frame + HISTORY - MAX_ROLLBACK - 2)
+				continue;
+
+			const int slot = frame % HISTORY;
+			const unsigned short input = static_cast<unsigned short>(packet[HEADER_SIZE + i * 2] | (packet[HEADER_SIZE + i * 2 + 1] << 8));
+			m_RemoteFrames[slot] = frame;
+			m_RemoteInputs[slot] = input;
+
+			if (frame < m_Frame && m_UsedRemoteInputs[slot] != input)
+				m_RollbackFrame = std::min(m_RollbackFrame, frame);
+		}
+
+		while (m_RemoteFrames[(m_RemoteConfirmed + 1) % HISTORY] == m_RemoteConfirmed + 1)
+			++m_RemoteConfirmed;
+	}
+}
+
+void NetplaySession::SendInput()
+{
+	//Everything the remote side hasn't acknowledged, it can only confirm input without gaps
+	const int firstFrame = m_RemoteAck + 1;
+	const int count = std::min(m_Frame - firstFrame, MAX_PACKET_INPUTS);
+
+	std::vector<unsigned char> packet(HEADER_SIZE + std::max(0, count) * 2);
+	packet[0] = 'N';
+	packet[1] = 'P';
+	WriteU32(&packet[2], static_cast<unsigned int>(firstFrame));
+	packet[6] = static_cast<unsigned char>(std::max(0, count));
+	WriteU32(&packet[7], (m_RemoteConfirmed >= 0) ? static_cast<unsigned int>(m_RemoteConfirmed) : NO_FRAME);
+	WriteU32(&packet[11], (m_LocalDigestFrame >= 0) ? static_cast<unsigned int>(m_LocalDigestFrame) : NO_FRAME);
+	WriteU32(&packet[15], m_LocalDigest);
+	for (int i = 0; i < count; ++i)
+	{
+		const unsigned short input = m_LocalInputs[(firstFrame + i) % HISTORY];
+		packet[HEADER_SIZE + i * 2] = static_cast<unsigned char>(input);
+		packet[HEADER_SIZE + i * 2 + 1] = static_cast<unsigned char>(input >> 8);
+	}
+
+	//Loss is decided by a xorshift32 so test runs are repeatable
+	m_LossState ^= m_LossState << 13;
+	m_LossState ^= m_LossState >> 17;
+	m_LossState ^= m_LossState << 5;
+	if (static_cast<double>(m_LossState) / 4294967296.0 >= m_LossRate)
+		m_Pending.push_back(PendingPacket{ m_Tick + m_LatencyFrames, std::move(packet) });
+
+	while (!m_Pending.empty() && m_Pending.front().sendTick <= m_Tick)
+	{
+		m_Socket.Send(m_Pending.front().bytes.data(), m_Pending.front().bytes.size());
+		m_Pending.pop_front();
+	}
+}
+
+void NetplaySession::UpdateDigests()
+{
+	//The start of a frame is final once all input before it is confirmed and the rollbacks are done
+	while (m_NextDigestFrame <= m_RemoteConfirmed + 1 && m_NextDigestFrame < m_Frame)
+	{
+		if (m_NextDigestFrame >= m_Frame - SNAPSHOT_COUNT)
+		{
+			m_LocalDigest = Digest(m_Snapshots[m_NextDigestFrame % SNAPSHOT_COUNT]);
+			m_LocalDigestFrame = m_NextDigestFrame;
+			m_LocalDigests[m_LocalDigestFrame] = m_LocalDigest;
+		}
+		m_NextDigestFrame += DIGEST_INTERVAL;
+	}
+	CompareDigests();
+}
+
+void NetplaySession::CompareDigests()
+{
+	for (auto remote = m_RemoteDigests.begin(); remote != m_RemoteDigests.end();)
+	{
+		const auto local = m_LocalDigests.find(remote->first);
+		if (local == m_LocalDigests.end())
+		{
+			++remote;
+			continue;
+		}
+
+		++m_DigestsCompared;
+		if (local->second != remote->second && m_DesyncFrame == -1)
+			m_DesyncFrame = remote->first;
+		m_LocalDigests.erase(local);
+		remote = m_RemoteDigests.erase(remote);
+	}
+
+	//Digests the other side will never send again
+	while (m_LocalDigests.size() > 16)
+		m_LocalDigests.erase(m_LocalDigests.begin());
+	while (m_RemoteDigests.size() > 16)
+		m_RemoteDigests.erase(m_RemoteDigests.begin());
+}
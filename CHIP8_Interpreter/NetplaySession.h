@@ -0,0 +1,103 @@
+#pragma once
+
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "Interpreter.h"
+
+class UdpSocket;
+
+/* Two player rollback netplay, each side runs its own interpreter on the OR of both keypads.
+Remote input that hasn't arrived yet is predicted to be the last one received. When the real input differs,
+the session restores the snapshot of the first mispredicted frame and simulates the frames since then again.
+Every packet repeats all local input the other side hasn't acknowledged, so lost packets need no resend.
+Every DIGEST_INTERVAL frames both sides exchange a digest of the confirmed state to detect desyncs.
+Packet (little endian): "NP", u32 first frame, u8 input count, u32 ack, u32 digest frame, u32 digest, inputs (u16 each)*/
+class NetplaySession
+{
+public:
+	//Frames that can be simulated on predicted input, the session waits for the remote side beyond that
+	static const int MAX_ROLLBACK = 8;
+	static const int DIGEST_INTERVAL = 60;
+
+	NetplaySession(Interpreter& interpreter, UdpSocket& socket);
+
+	NetplaySession(const NetplaySession&) = delete;
+	NetplaySession& operator=(const NetplaySession&) = delete;
+
+	//Delays outgoing packets by latencyFrames calls to AdvanceFrame and drops lossRate (0 to 1) of them, for testing on loopback
+	void SetSimulatedConditions(int latencyFrames, double lossRate, unsigned int seed);
+
+	//Call once per host frame: exchanges input, rolls back when a prediction was wrong and runs the next frame.
+	//The interpreter's keypad is overwritten, so the frontend can collect its keys there and pass them as localKeypad.
+	//Returns false when the next frame has to wait for remote input, the interpreter is unchanged then apart from the keypad
+	bool AdvanceFrame(unsigned short localKeypad);
+
+	int GetFrame() const { return m_Frame; }
+	int GetConfirmedFrame() const { return m_RemoteConfirmed; }
+	bool IsHalted() const { return m_Halted; }
+
+	//Frame of the first digest that didn't match, -1 while in sync
+	int GetDesyncFrame() const { return m_DesyncFrame; }
+	int GetDigestsCompared() const { return m_DigestsCompared; }
+
+	int GetRollbackCount() const { return m_RollbackCount; }
+	int GetResimulatedFrames() const { return m_ResimulatedFrames; }
+	int GetMaxRollback() const { return m_MaxRollback; }
+	int GetStallCount() const { return m_StallCount; }
+
+private:
+	//Input history, indexed by frame modulo HISTORY
+	static const int HISTORY = 128;
+	static const int SNAPSHOT_COUNT = MAX_ROLLBACK + 2;
+
+	Interpreter& m_Interpreter;
+	UdpSocket& m_Socket;
+
+	unsigned short m_LocalInputs[HISTORY] = {};
+	unsigned short m_RemoteInputs[HISTORY] = {};
+	int m_RemoteFrames[HISTORY]; //frame the remote input slot belongs to, -1 when empty
+	unsigned short m_UsedRemoteInputs[HISTORY] = {}; //remote input a simulated frame ran with, predicted or not
+
+	//Interpreter state at the start of a frame, indexed by frame modulo SNAPSHOT_COUNT
+	Interpreter::Snapshot m_Snapshots[SNAPSHOT_COUNT] = {};
+
+	int m_Frame = 0; //next frame to simulate
+	int m_RemoteConfirmed = -1; //all remote input up to this frame has arrived
+	int m_RemoteAck = -1; //the remote side has all local input up to this frame
+	int m_RollbackFrame; //oldest frame that ran on a wrong prediction, m_Frame when none
+	bool m_Halted = false;
+
+	int m_NextDigestFrame = DIGEST_INTERVAL;
+	int m_LocalDigestFrame = -1;
+	unsigned int m_LocalDigest = 0;
+	std::map<int, unsigned int> m_LocalDigests;
+	std::map<int, unsigned int> m_RemoteDigests;
+	int m_DesyncFrame = -1;
+	int m_DigestsCompared = 0;
+
+	int m_RollbackCount = 0;
+	int m_ResimulatedFrames = 0;
+	int m_MaxRollback = 0;
+	int m_StallCount = 0;
+
+	//Simulated network conditions
+	struct PendingPacket
+	{
+		unsigned long long sendTick;
+		std::vector<unsigned char> bytes;
+	};
+	std::deque<PendingPacket> m_Pending;
+	unsigned long long m_Tick = 0;
+	int m_LatencyFrames = 0;
+	double m_LossRate = 0.0;
+	unsigned int m_LossState = 1;
+
+	unsigned short RemoteInputFor(int frame) const;
+	void RunFrame(int frame);
+	void ReceivePackets();
+	void SendInput();
+	void UpdateDigests();
+	void CompareDigests();
+};
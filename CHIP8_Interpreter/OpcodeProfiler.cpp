@@ -0,0 +1,216 @@
+#include "OpcodeProfiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+unsigned char OpcodeProfiler::m_ClassTable[65536];
+
+namespace
+{
+	const char* const CLASS_NAMES[OpcodeProfiler::CLASS_COUNT] =
+	{
+		"00E0", "00EE", "0NNN", "1NNN", "2NNN", "3XNN", "4XNN", "5XY0", "6XNN", "7XNN",
+		"8XY0", "8XY1", "8XY2", "8XY3", "8XY4", "8XY5", "8XY6", "8XY7", "8XYE",
+		"9XY0", "ANNN", "BNNN", "CXNN", "DXYN", "EX9E", "EXA1",
+		"FX07", "FX0A", "FX15", "FX18", "FX1E", "FX29", "FX33", "FX55", "FX65",
+		"invalid"
+	};
+
+	double Percentage(unsigned long long count, unsigned long long total)
+	{
+		return (total == 0) ? 0.0 : 100.0 * static_cast<double>(count) / static_cast<double>(total);
+	}
+}
+
+OpcodeProfiler::OpcodeProfiler()
+{
+	//The class table is shared, the first profiler fills it
+	static const bool tableFilled = []()
+	{
+		for (int opCode = 0; opCode < 65536; ++opCode)
+			m_ClassTable[opCode] = static_cast<unsigned char>(Classify(static_cast<unsigned short>(opCode)));
+		return true;
+	}();
+	(void)tableFilled;
+
+	Reset();
+}
+
+OpcodeProfiler::~OpcodeProfiler()
+{
+}
+
+OpcodeProfiler::OpcodeClass OpcodeProfiler::Classify(unsigned short opCode)
+{
+	switch (opCode & 0xF000)
+	{
+	case 0x0000:
+		if (opCode == 0x00E0) return OP_00E0;
+		if (opCode == 0x00EE) return OP_00EE;
+		return OP_0NNN;
+	case 0x1000: return OP_1NNN;
+	case 0x2000: return OP_2NNN;
+	case 0x3000: return OP_3XNN;
+	case 0x4000: return OP_4XNN;
+	case 0x5000: return ((opCode & 0x000F) == 0) ? OP_5XY0 : OP_INVALID;
+	case 0x6000: return OP_6XNN;
+	case 0x7000: return OP_7XNN;
+	case 0x8000:
+		switch (opCode & 0x000F)
+		{
+		case 0x0: return OP_8XY0;
+		case 0x1: return OP_8XY1;
+		case 0x2: return OP_8XY2;
+		case 0x3: return OP_8XY3;
+		case 0x4: return OP_8XY4;
+		case 0x5: return OP_8XY5;
+		case 0x6: return OP_8XY6;
+		case 0x7: return OP_8XY7;
+		case 0xE: return OP_8XYE;
+		default: return OP_INVALID;
+		}
+	case 0x9000: return ((opCode & 0x000F) == 0) ? OP_9XY0 : OP_INVALID;
+	case 0xA000: return OP_ANNN;
+	case 0xB000: return OP_BNNN;
+	case 0xC000: return OP_CXNN;
+	case 0xD000: return OP_DXYN;
+	case 0xE000:
+		if ((opCode & 0x00FF) == 0x9E) return OP_EX9E;
+		if ((opCode & 0x00FF) == 0xA1) return OP_EXA1;
+		return OP_INVALID;
+	default:
+		switch (opCode & 0x00FF)
+		{
+		case 0x07: return OP_FX07;
+		case 0x0A: return OP_FX0A;
+		case 0x15: return OP_FX15;
+		case 0x18: return OP_FX18;
+		case 0x1E: return OP_FX1E;
+		case 0x29: return OP_FX29;
+		case 0x33: return OP_FX33;
+		case 0x55: return OP_FX55;
+		case 0x65: return OP_FX65;
+		default: return OP_INVALID;
+		}
+	}
+}
+
+const char* OpcodeProfiler::GetClassName(OpcodeClass opCodeClass)
+{
+	return CLASS_NAMES[opCodeClass];
+}
+
+void OpcodeProfiler::Reset()
+{
+	std::memset(m_ClassCounts, 0, sizeof(m_ClassCounts));
+	std::memset(m_AddressCounts, 0, sizeof(m_AddressCounts));
+	std::memset(m_Bigrams, 0, sizeof(m_Bigrams));
+	m_Previous = OP_INVALID;
+}
+
+unsigned long long OpcodeProfiler::GetTotal() const
+{
+	unsigned long long total = 0;
+	for (int i = 0; i < CLASS_COUNT; ++i)
+		total += m_ClassCounts[i];
+	return total;
+}
+
+void OpcodeProfiler::WriteReport(std::ostream& out, int topCount) const
+{
+	//Formatted into a local stream, so the caller's stream keeps its flags and precision
+	std::ostringstream report;
+	const unsigned long long total = GetTotal();
+	report << "Executed instructions: " << total << "\n\n";
+
+	report << "Opcode classes\n";
+	std::vector<int> classes;
+	for (int i = 0; i < CLASS_COUNT; ++i)
+	{
+		if (m_ClassCounts[i] != 0)
+			classes.push_back(i);
+	}
+	std::sort(classes.begin(), classes.end(), [this](int a, int b) { return m_ClassCounts[a] > m_ClassCounts[b]; });
+	for (int opCodeClass : classes)
+	{
+		report << "  " << std::left << std::setw(8) << CLASS_NAMES[opCodeClass] << std::right << std::setw(14) << m_ClassCounts[opCodeClass]
+			<< std::setw(9) << std::fixed << std::setprecision(2) << Percentage(m_ClassCounts[opCodeClass], total) << "%\n";
+	}
+
+	report << "\nHottest addresses\n";
+	std::vector<int> addresses;
+	for (int i = 0; i < ADDRESS_COUNT; ++i)
+	{
+		if (m_AddressCounts[i] != 0)
+			addresses.push_back(i);
+	}
+	std::sort(addresses.begin(), addresses.end(), [this](int a, int b) { return m_AddressCounts[a] > m_AddressCounts[b]; });
+	for (size_t i = 0; i < addresses.size() && i < static_cast<size_t>(topCount); ++i)
+	{
+		const int address = addresses[i];
+		report << "  0x" << std::hex << std::uppercase << std::setw(3) << std::setfill('0') << address << std::dec << std::nouppercase << std::setfill(' ')
+			<< std::setw(14) << m_AddressCounts[address] << std::setw(9) << Percentage(m_AddressCounts[address], total) << "%\n";
+	}
+
+	report << "\nMost frequent opcode pairs\n";
+	std::vector<std::pair<int, int>> bigrams;
+	for (int a = 0; a < CLASS_COUNT; ++a)
+	{
+		for (int b = 0; b < CLASS_COUNT; ++b)
+		{
+			if (m_Bigrams[a][b] != 0)
+				bigrams.emplace_back(a, b);
+		}
+	}
+	std::sort(bigrams.begin(), bigrams.end(), [this](const std::pair<int, int>& a, const std::pair<int, int>& b)
+	{
+		return m_Bigrams[a.first][a.second] > m_Bigrams[b.first][b.second];
+	});
+	for (size_t i = 0; i < bigrams.size() && i < static_cast<size_t>(topCount); ++i)
+	{
+		const unsigned long long count = m_Bigrams[bigrams[i].first][bigrams[i].second];
+		report << "  " << CLASS_NAMES[bigrams[i].first] << " -> " << std::left << std::setw(8) << CLASS_NAMES[bigrams[i].second] << std::right
+			<< std::setw(14) << count << std::setw(9) << Percentage(count, total) << "%\n";
+	}
+
+	out << report.str();
+}
+
+bool OpcodeProfiler::WriteHeatmap(const std::string& path) const
+{
+	std::ofstream file(path, std::ios_base::binary);
+	if (file.fail())
+		return false;
+
+	const int size = 64;
+	file << "P6\n" << size << " " << size << "\n255\n";
+
+	unsigned long long maximum = 0;
+	for (int i = 0; i < ADDRESS_COUNT; ++i)
+		maximum = std::max(maximum, m_AddressCounts[i]);
+	const double scale = (maximum > 0) ? 1.0 / std::log(1.0 + static_cast<double>(maximum)) : 0.0;
+
+	//Black for never executed, then blue -> red -> yellow -> white with the log of the count
+	for (int i = 0; i < ADDRESS_COUNT; ++i)
+	{
+		unsigned char rgb[3] = { 0, 0, 0 };
+		if (m_AddressCounts[i] != 0)
+		{
+			const double heat = std::log(1.0 + static_cast<double>(m_AddressCounts[i])) * scale;
+			const double r = std::min(1.0, heat * 2.0);
+			const double g = std::max(0.0, std::min(1.0, heat * 2.0 - 0.6));
+			const double b = (heat < 0.3) ? 0.6 - heat : std::max(0.0, heat * 3.0 - 2.0);
+			rgb[0] = static_cast<unsigned char>(r * 255.0);
+			rgb[1] = static_cast<unsigned char>(g * 255.0);
+			rgb[2] = static_cast<unsigned char>(std::min(1.0, b) * 255.0);
+		}
+		file.write(reinterpret_cast<const char*>(rgb), sizeof(rgb));
+	}
+
+	return !file.fail();
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+
+/* Counts executed instructions per opcode class, per program address and per pair of consecutive opcode classes.
+The interpreter only calls Record when built with CHIP8_PROFILE defined, without it the hook compiles away.*/
+class OpcodeProfiler
+{
+public:
+	enum OpcodeClass
+	{
+		OP_00E0, OP_00EE, OP_0NNN, OP_1NNN, OP_2NNN, OP_3XNN, OP_4XNN, OP_5XY0, OP_6XNN, OP_7XNN,
+		OP_8XY0, OP_8XY1, OP_8XY2, OP_8XY3, OP_8XY4, OP_8XY5, OP_8XY6, OP_8XY7, OP_8XYE,
+		OP_9XY0, OP_ANNN, OP_BNNN, OP_CXNN, OP_DXYN, OP_EX9E, OP_EXA1,
+		OP_FX07, OP_FX0A, OP_FX15, OP_FX18, OP_FX1E, OP_FX29, OP_FX33, OP_FX55, OP_FX65,
+		OP_INVALID,
+		CLASS_COUNT
+	};
+
+	static const int ADDRESS_COUNT = 4096;
+
+	OpcodeProfiler();
+	~OpcodeProfiler();
+
+	static OpcodeClass Classify(unsigned short opCode);
+	static const char* GetClassName(OpcodeClass opCodeClass);
+
+	void Record(unsigned short address, unsigned short opCode)
+	{
+		const unsigned char opCodeClass = m_ClassTable[opCode];
+		++m_ClassCounts[opCodeClass];
+		++m_AddressCounts[address & (ADDRESS_COUNT - 1)];
+		++m_Bigrams[m_Previous][opCodeClass];
+		m_Previous = opCodeClass;
+	}
+
+	void Reset();
+
+	unsigned long long GetTotal() const;
+	unsigned long long GetClassCount(OpcodeClass opCodeClass) const { return m_ClassCounts[opCodeClass]; }
+	unsigned long long GetAddressCount(unsigned short address) const { return m_AddressCounts[address & (ADDRESS_COUNT - 1)]; }
+
+	//Text report: class histogram, hottest addresses and most frequent opcode class pairs
+	void WriteReport(std::ostream& out, int topCount = 20) const;
+
+	//64x64 binary PPM of the 4 KB address space, one pixel per address (row = address / 64), log scaled
+	bool WriteHeatmap(const std::string& path) const;
+
+private:
+	//Opcode to class lookup, shared by all profilers
+	static unsigned char m_ClassTable[65536];
+
+	unsigned long long m_ClassCounts[CLASS_COUNT];
+	unsigned long long m_AddressCounts[ADDRESS_COUNT];
+	unsigned long long m_Bigrams[CLASS_COUNT][CLASS_COUNT];
+	unsigned char m_Previous = OP_INVALID;
+};
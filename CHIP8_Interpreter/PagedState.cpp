@@ -0,0 +1,97 @@
+#include "PagedState.h"
+#include <cstring>
+
+PagePool::PagePool(size_t pagesPerChunk)
+	: m_PagesPerChunk(pagesPerChunk > 0 ? pagesPerChunk : 1)
+{
+}
+
+PagePool::Page* PagePool::Allocate()
+{
+	if (m_Free == nullptr)
+	{
+		m_Chunks.emplace_back(new Page[m_PagesPerChunk]);
+		Page* chunk = m_Chunks.back().get();
+		for (size_t i = 0; i < m_PagesPerChunk; ++i)
+		{
+			chunk[i].next = m_Free;
+			m_Free = &chunk[i];
+		}
+		m_FreeCount += m_PagesPerChunk;
+	}
+
+	Page* page = m_Free;
+	m_Free = page->next;
+	--m_FreeCount;
+	page->references = 1;
+	return page;
+}
+
+void PagePool::Release(Page* page)
+{
+	if (--page->references > 0)
+		return;
+
+	page->next = m_Free;
+	m_Free = page;
+	++m_FreeCount;
+}
+
+PagedState::PagedState(const PagedState& other)
+{
+	*this = other;
+}
+
+PagedState& PagedState::operator=(const PagedState& other)
+{
+	if (this == &other)
+		return *this;
+
+	if (m_Pool != other.m_Pool)
+		Clear();
+
+	m_Pool = other.m_Pool;
+	for (int i = 0; i < PAGE_COUNT; ++i)
+	{
+		if (m_Pages[i] != other.m_Pages[i])
+		{
+			if (other.m_Pages[i] != nullptr)
+				m_Pool->AddReference(other.m_Pages[i]);
+			SetPage(i, other.m_Pages[i]);
+		}
+	}
+
+	std::memcpy(m_V, other.m_V, sizeof(m_V));
+	std::memcpy(m_Stack, other.m_Stack, sizeof(m_Stack));
+	std::memcpy(m_RandomState, other.m_RandomState, sizeof(m_RandomState));
+	m_IndexRegister = other.m_IndexRegister;
+	m_ProgramCounter = other.m_ProgramCounter;
+	m_StackPointer = other.m_StackPointer;
+	m_Keypad = other.m_Keypad;
+	m_CycleCount = other.m_CycleCount;
+	m_DelayTimer = other.m_DelayTimer;
+	m_SoundTimer = other.m_SoundTimer;
+	m_DrawFlag = other.m_DrawFlag;
+	m_FrameCycle = other.m_FrameCycle;
+	m_FrameDrawn = other.m_FrameDrawn;
+	return *this;
+}
+
+PagedState::~PagedState()
+{
+	Clear();
+}
+
+void PagedState::Clear()
+{
+	for (int i = 0; i < PAGE_COUNT; ++i)
+		SetPage(i, nullptr);
+	m_Pool = nullptr;
+}
+
+void PagedState::SetPage(int index, PagePool::Page* page)
+{
+	if (m_Pages[index] != nullptr)
+		m_Pool->Release(m_Pages[index]);
+	m_Pages[index] = page;
+}
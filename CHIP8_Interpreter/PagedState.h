@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/* Reference counted 256 byte pages, allocated in chunks and recycled through a free list so forking allocates nothing once the pool
+has grown to the working set. Not thread safe, a search thread uses its own pool.*/
+class PagePool
+{
+public:
+	static const int PAGE_SIZE = 256;
+
+	struct Page
+	{
+		unsigned char bytes[PAGE_SIZE];
+		int references;
+		Page* next; //free list
+	};
+
+	explicit PagePool(size_t pagesPerChunk = 1024);
+
+	PagePool(const PagePool&) = delete;
+	PagePool& operator=(const PagePool&) = delete;
+
+	//A page with one reference and undefined contents
+	Page* Allocate();
+	void AddReference(Page* page) { ++page->references; }
+	void Release(Page* page);
+
+	size_t GetPageCount() const { return m_Chunks.size() * m_PagesPerChunk; }
+	size_t GetFreeCount() const { return m_FreeCount; }
+
+private:
+	std::vector<std::unique_ptr<Page[]>> m_Chunks;
+	size_t m_PagesPerChunk;
+	Page* m_Free = nullptr;
+	size_t m_FreeCount = 0;
+};
+
+/* A forked machine state (see Interpreter::Fork): memory and display as pages of a PagePool plus the registers.
+Copies share the pages, so keeping a state in several places costs a reference count per page. The pool has to outlive its states.
+Like Interpreter::Snapshot, configuration and the MEGA-CHIP extension state are not part of it*/
+class PagedState
+{
+public:
+	static const int MEMORY_PAGES = 16; //4 KB
+	static const int SCREEN_PAGES = 32; //a display row of 64 pixels is one page
+	static const int PAGE_COUNT = MEMORY_PAGES + SCREEN_PAGES;
+
+	PagedState() = default;
+	PagedState(const PagedState& other);
+	PagedState& operator=(const PagedState& other);
+	~PagedState();
+
+	bool IsEmpty() const { return m_Pool == nullptr; }
+	void Clear();
+
+	unsigned long long GetCycleCount() const { return m_CycleCount; }
+
+private:
+	friend class Interpreter;
+
+	PagePool* m_Pool = nullptr;
+	PagePool::Page* m_Pages[PAGE_COUNT] = {};
+
+	unsigned char m_V[16] = {};
+	unsigned short m_Stack[16] = {};
+	unsigned short m_IndexRegister = 0;
+	unsigned short m_ProgramCounter = 0;
+	unsigned short m_StackPointer = 0;
+	unsigned short m_Keypad = 0;
+	unsigned int m_RandomState[4] = {};
+	unsigned long long m_CycleCount = 0;
+	unsigned char m_DelayTimer = 0;
+	unsigned char m_SoundTimer = 0;
+	bool m_DrawFlag = false;
+	int m_FrameCycle = 0;
+	bool m_FrameDrawn = false;
+
+	//Points page at another pool page, the old one is released
+	void SetPage(int index, PagePool::Page* page);
+};
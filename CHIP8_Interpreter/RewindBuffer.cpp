@@ -0,0 +1,94 @@
+#include "RewindBuffer.h"
+
+#include "DeltaCodec.h"
+
+namespace
+{
+	unsigned char* Bytes(Interpreter::Snapshot& snapshot)
+	{
+		return reinterpret_cast<unsigned char*>(&snapshot);
+	}
+}
+
+RewindBuffer::RewindBuffer(size_t byteBudget, int keyframeInterval)
+	: m_ByteBudget(byteBudget)
+	, m_KeyframeInterval(keyframeInterval > 0 ? keyframeInterval : 1)
+{
+}
+
+void RewindBuffer::Clear()
+{
+	m_Groups.clear();
+	m_FrameCount = 0;
+	m_ByteSize = 0;
+}
+
+void RewindBuffer::Push(const Interpreter& interpreter)
+{
+	interpreter.SaveSnapshot(m_Scratch);
+
+	if (m_Groups.empty() || m_Groups.back().frameOffsets.size() >= static_cast<size_t>(m_KeyframeInterval))
+	{
+		//The finished group won't grow anymore
+		if (!m_Groups.empty())
+			m_Groups.back().bytes.shrink_to_fit();
+
+		m_Groups.emplace_back();
+		m_Keyframe = m_Scratch;
+	}
+
+	Group& group = m_Groups.back();
+	const size_t start = group.bytes.size();
+	group.frameOffsets.push_back(start);
+	if (group.frameOffsets.size() == 1)
+		DeltaEncode(Bytes(m_Scratch), nullptr, sizeof(m_Scratch), group.bytes);
+	else
+		DeltaEncode(Bytes(m_Scratch), Bytes(m_Keyframe), sizeof(m_Scratch), group.bytes);
+
+	m_ByteSize += group.bytes.size() - start;
+	++m_FrameCount;
+
+	//Always keep the group that is being written
+	while (m_ByteSize > m_ByteBudget && m_Groups.size() > 1)
+	{
+		m_ByteSize -= m_Groups.front().bytes.size();
+		m_FrameCount -= m_Groups.front().frameOffsets.size();
+		m_Groups.pop_front();
+	}
+}
+
+bool RewindBuffer::Rewind(Interpreter& interpreter)
+{
+	if (m_Groups.empty())
+		return false;
+
+	Group& group = m_Groups.back();
+	const size_t start = group.frameOffsets.back();
+	const size_t size = group.bytes.size() - start;
+	if (group.frameOffsets.size() == 1)
+		m_Scratch = m_Keyframe;
+	else if (!DeltaDecode(group.bytes.data() + start, size, Bytes(m_Keyframe), Bytes(m_Scratch), sizeof(m_Scratch)))
+		return false;
+
+	interpreter.LoadSnapshot(m_Scratch);
+	interpreter.m_DrawFlag = true;
+
+	group.bytes.resize(start);
+	group.frameOffsets.pop_back();
+	m_ByteSize -= size;
+	--m_FrameCount;
+
+	if (group.frameOffsets.empty())
+	{
+		m_Groups.pop_back();
+		if (!m_Groups.empty() && !DecodeKeyframe(m_Groups.back()))
+			Clear();
+	}
+	return true;
+}
+
+bool RewindBuffer::DecodeKeyframe(const Group& group)
+{
+	const size_t end = (group.frameOffsets.size() > 1) ? group.frameOffsets[1] : group.bytes.size();
+	return DeltaDecode(group.bytes.data(), end, nullptr, Bytes(m_Keyframe), sizeof(m_Keyframe));
+}
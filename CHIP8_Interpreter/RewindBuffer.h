@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+#include "Interpreter.h"
+
+/* History of interpreter snapshots for rewinding, one per frame.
+Every keyframeInterval frames a keyframe is stored zero run compressed, the frames after it are stored as
+XOR deltas against that keyframe (see DeltaCodec.h), so any frame decodes with a single pass.
+Between frames little of the memory and display changes, a frame typically takes under a few hundred bytes.*/
+class RewindBuffer
+{
+public:
+	//byteBudget bounds the compressed history, the oldest keyframe groups are dropped when it is exceeded
+	explicit RewindBuffer(size_t byteBudget = 4 * 1024 * 1024, int keyframeInterval = 30);
+
+	RewindBuffer(const RewindBuffer&) = delete;
+	RewindBuffer& operator=(const RewindBuffer&) = delete;
+
+	//Captures the interpreter state, the frontend pushes before every RunFrame
+	void Push(const Interpreter& interpreter);
+
+	//Restores the most recently pushed state and removes it from the history, returns false when there is nothing left
+	bool Rewind(Interpreter& interpreter);
+
+	void Clear();
+
+	size_t GetFrameCount() const { return m_FrameCount; }
+	size_t GetByteSize() const { return m_ByteSize; }
+
+private:
+	//A keyframe and the frames after it
+	struct Group
+	{
+		std::vector<unsigned char> bytes;
+		std::vector<size_t> frameOffsets; //start of every frame in bytes, the first one is the keyframe
+	};
+
+	std::deque<Group> m_Groups;
+	Interpreter::Snapshot m_Keyframe = {}; //decoded keyframe of the newest group
+	Interpreter::Snapshot m_Scratch = {};
+
+	size_t m_ByteBudget;
+	int m_KeyframeInterval;
+	size_t m_FrameCount = 0;
+	size_t m_ByteSize = 0;
+
+	bool DecodeKeyframe(const Group& group);
+};
@@ -0,0 +1,638 @@
+#include "RomAnalyzer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include "DeltaCodec.h"
+#include "Disassembler.h"
+#include "RomHash.h"
+
+namespace
+{
+	const unsigned char VERSION = 1;
+
+	//Value of I along a path: an address, a table base that an unknown index was added to, or unknown
+	const int UNVISITED = -2;
+	const int UNKNOWN = -1;
+	const int INDEXED = 0x1000;
+
+	enum Flow
+	{
+		FLOW_NEXT, //continues with the next instruction
+		FLOW_JUMP,
+		FLOW_CALL,
+		FLOW_SKIP,
+		FLOW_RETURN,
+		FLOW_INDIRECT,
+		FLOW_INVALID
+	};
+
+	Flow GetFlow(unsigned short opCode)
+	{
+		const int n = opCode & 0x000F;
+		const int nn = opCode & 0x00FF;
+		switch (opCode & 0xF000)
+		{
+		case 0x0000:
+			if (opCode == 0x00E0)
+				return FLOW_NEXT;
+			return (opCode == 0x00EE) ? FLOW_RETURN : FLOW_INVALID;
+		case 0x1000: return FLOW_JUMP;
+		case 0x2000: return FLOW_CALL;
+		case 0x3000:
+		case 0x4000: return FLOW_SKIP;
+		case 0x5000:
+		case 0x9000: return (n == 0) ? FLOW_SKIP : FLOW_INVALID;
+		case 0x8000: return (n <= 7 || n == 0xE) ? FLOW_NEXT : FLOW_INVALID;
+		case 0xB000: return FLOW_INDIRECT;
+		case 0xE000: return (nn == 0x9E || nn == 0xA1) ? FLOW_SKIP : FLOW_INVALID;
+		case 0xF000:
+			switch (nn)
+			{
+			case 0x07: case 0x0A: case 0x15: case 0x18: case 0x1E: case 0x29: case 0x33: case 0x55: case 0x65:
+				return FLOW_NEXT;
+			}
+			return FLOW_INVALID;
+		}
+		return FLOW_NEXT;
+	}
+
+	//Conservative: any instruction that names VF in a field it reads
+	bool ReadsFlag(unsigned short opCode, const Quirks& quirks)
+	{
+		const bool x = (opCode & 0x0F00) == 0x0F00;
+		const bool y = (opCode & 0x00F0) == 0x00F0;
+		const int n = opCode & 0x000F;
+		const int nn = opCode & 0x00FF;
+		switch (opCode & 0xF000)
+		{
+		case 0x3000:
+		case 0x4000:
+		case 0x7000:
+		case 0xE000:
+			return x;
+		case 0x5000:
+		case 0x9000:
+		case 0xD000:
+			return x || y;
+		case 0x8000:
+			if (n == 0x0)
+				return y;
+			if (n == 0x6 || n == 0xE)
+				return quirks.shiftUsesVY ? y : x;
+			return x || y;
+		case 0xB000:
+			return quirks.jumpUsesVX && x;
+		case 0xF000:
+			return x && nn != 0x07 && nn != 0x0A && nn != 0x65;
+		}
+		return false;
+	}
+
+	//Instructions after which VF never holds the value it had before
+	bool OverwritesFlag(unsigned short opCode, const Quirks& quirks)
+	{
+		const bool x = (opCode & 0x0F00) == 0x0F00;
+		const int n = opCode & 0x000F;
+		const int nn = opCode & 0x00FF;
+		switch (opCode & 0xF000)
+		{
+		case 0x6000:
+		case 0xC000:
+			return x;
+		case 0x8000:
+			if (n <= 0x3)
+				return x || (n != 0x0 && quirks.logicResetsVF);
+			return n <= 0x7 || n == 0xE;
+		case 0xD000:
+			return true;
+		case 0xF000:
+			return nn == 0x1E || (x && (nn == 0x07 || nn == 0x65));
+		}
+		return false;
+	}
+
+	bool SetsFlag(unsigned short opCode)
+	{
+		const int n = opCode & 0x000F;
+		switch (opCode & 0xF000)
+		{
+		case 0x8000:
+			//8XY4, 8XY5 and 8XY7 write VF before computing VX, with X or Y = F the flag changes the result
+			if (n == 0x4 || n == 0x5 || n == 0x7)
+				return (opCode & 0x0F00) != 0x0F00 && (opCode & 0x00F0) != 0x00F0;
+			return n == 0x6 || n == 0xE;
+		case 0xD000: return true;
+		case 0xF000: return (opCode & 0x00FF) == 0x1E;
+		}
+		return false;
+	}
+
+	void WriteList(std::vector<unsigned char>& data, const std::vector<unsigned short>& list)
+	{
+		WriteVarint(data, list.size());
+		for (unsigned short value : list)
+			WriteVarint(data, value);
+	}
+
+	bool ReadList(const unsigned char* data, size_t size, size_t& position, std::vector<unsigned short>& list)
+	{
+		unsigned long long count;
+		if (!ReadVarint(data, size, position, count) || count > RomAnalysis::ADDRESS_COUNT)
+			return false;
+
+		list.resize(static_cast<size_t>(count));
+		for (unsigned short& value : list)
+		{
+			unsigned long long read;
+			if (!ReadVarint(data, size, position, read))
+				return false;
+			value = static_cast<unsigned short>(read);
+		}
+		return true;
+	}
+
+	std::string Hex(unsigned int value)
+	{
+		char text[8];
+		std::snprintf(text, sizeof(text), "0x%03X", value);
+		return text;
+	}
+}
+
+void RomAnalysis::Analyze(const unsigned char* rom, size_t size)
+{
+	std::memset(m_Memory, 0, sizeof(m_Memory));
+	std::memset(m_Flags, 0, sizeof(m_Flags));
+	m_Blocks.clear();
+	m_Subroutines.clear();
+	m_UnknownReads.clear();
+	m_UnknownWrites.clear();
+
+	size = std::min(size, static_cast<size_t>(ADDRESS_COUNT - PROGRAM_START));
+	std::memcpy(m_Memory + PROGRAM_START, rom, size);
+	m_RomEnd = static_cast<unsigned short>(PROGRAM_START + size);
+
+	//Worklist over instructions with the value of I when they are reached, a second value at the same instruction makes it unknown
+	std::vector<int> states(ADDRESS_COUNT, UNVISITED);
+	std::vector<unsigned short> work;
+	auto visit = [&](unsigned int address, int state)
+	{
+		if (address < PROGRAM_START || address + 1 >= m_RomEnd)
+			return;
+
+		int& current = states[address];
+		const int merged = (current == UNVISITED || current == state) ? state : UNKNOWN;
+		if (merged != current)
+		{
+			current = merged;
+			work.push_back(static_cast<unsigned short>(address));
+		}
+	};
+
+	visit(PROGRAM_START, 0);
+	while (!work.empty())
+	{
+		const unsigned short address = work.back();
+		work.pop_back();
+
+		const int state = states[address];
+		const unsigned short opCode = OpCodeAt(address);
+		const int x = (opCode & 0x0F00) >> 8;
+		const int nnn = opCode & 0x0FFF;
+		const unsigned int next = address + 2u;
+		switch (GetFlow(opCode))
+		{
+		case FLOW_JUMP:
+			visit(nnn, state);
+			break;
+		case FLOW_CALL:
+			//The callee may change I, so the return continues without knowing it
+			m_Flags[nnn] |= ROM_SUBROUTINE;
+			visit(nnn, state);
+			visit(next, UNKNOWN);
+			break;
+		case FLOW_SKIP:
+			visit(next, state);
+			visit(next + 2, state);
+			break;
+		case FLOW_RETURN:
+		case FLOW_INDIRECT:
+		case FLOW_INVALID:
+			break;
+		case FLOW_NEXT:
+		{
+			int after = state;
+			if ((opCode & 0xF000) == 0xA000)
+			{
+				after = nnn;
+			}
+			else if ((opCode & 0xF000) == 0xD000)
+			{
+				Mark(state, opCode & 0x000F, ROM_SPRITE, m_UnknownReads, address);
+			}
+			else if ((opCode & 0xF000) == 0xF000)
+			{
+				switch (opCode & 0x00FF)
+				{
+				case 0x1E: after = (state == UNKNOWN) ? UNKNOWN : (INDEXED | (state & 0xFFF)); break;
+				case 0x29: after = INDEXED; break; //into the font, below the rom
+				case 0x33: Mark(state, 3, ROM_WRITTEN, m_UnknownWrites, address); break;
+				case 0x55:
+				case 0x65:
+					Mark(state, x + 1, ((opCode & 0x00FF) == 0x55) ? ROM_WRITTEN : ROM_DATA, ((opCode & 0x00FF) == 0x55) ? m_UnknownWrites : m_UnknownReads, address);
+
+					//Depending on the quirk I moves past the registers, either way it stays within the table
+					if (state != UNKNOWN)
+						after = INDEXED | (state & 0xFFF);
+					break;
+				}
+			}
+			visit(next, after);
+			break;
+		}
+		}
+	}
+
+	for (int address = PROGRAM_START; address < m_RomEnd; ++address)
+	{
+		if (states[address] != UNVISITED && GetFlow(OpCodeAt(static_cast<unsigned short>(address))) != FLOW_INVALID)
+		{
+			m_Flags[address] |= ROM_CODE | ROM_INSTRUCTION;
+			m_Flags[address + 1] |= ROM_CODE;
+		}
+		if (m_Flags[address] & ROM_SUBROUTINE)
+			m_Subroutines.push_back(static_cast<unsigned short>(address));
+	}
+
+	for (std::vector<unsigned short>* list : { &m_UnknownReads, &m_UnknownWrites })
+	{
+		std::sort(list->begin(), list->end());
+		list->erase(std::unique(list->begin(), list->end()), list->end());
+	}
+
+	BuildBlocks();
+}
+
+void RomAnalysis::Mark(int state, int length, unsigned char flag, std::vector<unsigned short>& unknown, unsigned short instruction)
+{
+	//The index into a table is not known: a read marks the table from its base for the length of one access, a write could go anywhere
+	if (state == UNKNOWN || ((state & INDEXED) != 0 && flag == ROM_WRITTEN))
+	{
+		unknown.push_back(instruction);
+		return;
+	}
+
+	for (int i = 0; i < length; ++i)
+		m_Flags[((state & 0xFFF) + i) & 0xFFF] |= flag;
+}
+
+void RomAnalysis::BuildBlocks()
+{
+	auto isInstruction = [&](unsigned int address) { return address < ADDRESS_COUNT && (m_Flags[address] & ROM_INSTRUCTION) != 0; };
+
+	//Leaders: the entry, every branch target and whatever follows a branch
+	m_Flags[PROGRAM_START] |= ROM_BLOCK_START;
+	for (unsigned int address = PROGRAM_START; address < m_RomEnd; ++address)
+	{
+		if (!isInstruction(address))
+			continue;
+
+		const unsigned short opCode = OpCodeAt(static_cast<unsigned short>(address));
+		const Flow flow = GetFlow(opCode);
+		if (flow == FLOW_JUMP || flow == FLOW_CALL)
+			m_Flags[opCode & 0x0FFF] |= ROM_BLOCK_START;
+		if (flow == FLOW_SKIP)
+			m_Flags[(address + 4) & 0xFFF] |= ROM_BLOCK_START;
+		if (flow != FLOW_NEXT)
+			m_Flags[(address + 2) & 0xFFF] |= ROM_BLOCK_START;
+		if (!isInstruction(address - 2))
+			m_Flags[address] |= ROM_BLOCK_START;
+	}
+
+	for (unsigned int start = PROGRAM_START; start < m_RomEnd; ++start)
+	{
+		if (!isInstruction(start) || (m_Flags[start] & ROM_BLOCK_START) == 0)
+			continue;
+
+		BasicBlock block;
+		block.start = static_cast<unsigned short>(start);
+		unsigned int address = start;
+		for (;;)
+		{
+			const unsigned short opCode = OpCodeAt(static_cast<unsigned short>(address));
+			const unsigned int next = address + 2;
+			const Flow flow = GetFlow(opCode);
+			if (flow == FLOW_NEXT && isInstruction(next) && (m_Flags[next] & ROM_BLOCK_START) == 0)
+			{
+				address = next;
+				continue;
+			}
+
+			block.end = static_cast<unsigned short>(next);
+			switch (flow)
+			{
+			case FLOW_NEXT: block.successors = { static_cast<unsigned short>(next) }; break;
+			case FLOW_JUMP: block.successors = { static_cast<unsigned short>(opCode & 0x0FFF) }; break;
+			case FLOW_CALL: block.successors = { static_cast<unsigned short>(next), static_cast<unsigned short>(opCode & 0x0FFF) }; break;
+			case FLOW_SKIP: block.successors = { static_cast<unsigned short>(next), static_cast<unsigned short>(next + 2) }; break;
+			case FLOW_RETURN: block.returns = true; break;
+			case FLOW_INDIRECT: block.indirect = true; break;
+			case FLOW_INVALID: break;
+			}
+
+			//Successors that run off the rom or into an invalid opcode end the path there
+			for (size_t i = 0; i < block.successors.size(); ++i)
+			{
+				if (!isInstruction(block.successors[i]))
+				{
+					block.invalid = true;
+					block.successors.erase(block.successors.begin() + i--);
+				}
+			}
+			break;
+		}
+		m_Blocks.push_back(block);
+	}
+}
+
+bool RomAnalysis::IsSelfModifying() const
+{
+	for (int address = PROGRAM_START; address < ADDRESS_COUNT; ++address)
+	{
+		if ((m_Flags[address] & (ROM_CODE | ROM_WRITTEN)) == (ROM_CODE | ROM_WRITTEN))
+			return true;
+	}
+	return false;
+}
+
+size_t RomAnalysis::CountBytes(unsigned char flags) const
+{
+	return std::count_if(m_Flags, m_Flags + ADDRESS_COUNT, [flags](unsigned char value) { return (value & flags) != 0; });
+}
+
+std::vector<unsigned short> RomAnalysis::FindDeadFlagWrites(const Quirks& quirks) const
+{
+	std::vector<int> blockAt(ADDRESS_COUNT, -1);
+	for (size_t i = 0; i < m_Blocks.size(); ++i)
+		blockAt[m_Blocks[i].start] = static_cast<int>(i);
+
+	//Returns go to whatever follows one of the calls, that set is only complete when no path leaves the analysed code
+	bool closed = true;
+	std::vector<unsigned short> returnSites;
+	for (const BasicBlock& block : m_Blocks)
+	{
+		closed &= !block.indirect && !block.invalid;
+		if ((OpCodeAt(block.end - 2) & 0xF000) == 0x2000)
+			returnSites.push_back(block.end);
+	}
+
+	//Whether VF is read before being overwritten from the start of each block, grows until nothing changes
+	std::vector<bool> liveIn(m_Blocks.size(), false);
+	auto scan = [&](const BasicBlock& block, std::vector<unsigned short>* dead)
+	{
+		bool live = block.indirect || block.invalid || (block.returns && !closed);
+		for (unsigned short successor : (block.returns ? returnSites : block.successors))
+			live = live || successor >= ADDRESS_COUNT || blockAt[successor] < 0 || liveIn[blockAt[successor]];
+
+		for (unsigned int address = block.end; address > block.start;)
+		{
+			address -= 2;
+			const unsigned short opCode = OpCodeAt(static_cast<unsigned short>(address));
+			if (dead != nullptr && !live && SetsFlag(opCode))
+				dead->push_back(static_cast<unsigned short>(address));
+			live = ReadsFlag(opCode, quirks) || (!OverwritesFlag(opCode, quirks) && live);
+		}
+		return live;
+	};
+
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+		for (size_t i = m_Blocks.size(); i-- > 0;)
+		{
+			if (!liveIn[i] && scan(m_Blocks[i], nullptr))
+			{
+				liveIn[i] = true;
+				changed = true;
+			}
+		}
+	}
+
+	std::vector<unsigned short> dead;
+	for (const BasicBlock& block : m_Blocks)
+		scan(block, &dead);
+	std::sort(dead.begin(), dead.end());
+	return dead;
+}
+
+void RomAnalysis::WriteSummary(std::ostream& out) const
+{
+	size_t indirect = 0;
+	for (const BasicBlock& block : m_Blocks)
+		indirect += block.indirect ? 1 : 0;
+
+	out << (m_RomEnd - PROGRAM_START) << " bytes, " << CountBytes(ROM_CODE) << " code, " << CountBytes(ROM_SPRITE) << " sprite, "
+		<< CountBytes(ROM_DATA) << " data, " << CountBytes(ROM_WRITTEN) << " written, " << m_Blocks.size() << " blocks, "
+		<< m_Subroutines.size() << " subroutines, " << indirect << " indirect jumps, " << m_UnknownReads.size() << " unknown reads, "
+		<< m_UnknownWrites.size() << " unknown writes" << (IsSelfModifying() ? ", self-modifying" : "") << std::endl;
+}
+
+void RomAnalysis::WriteBlocks(std::ostream& out) const
+{
+	for (const BasicBlock& block : m_Blocks)
+	{
+		out << ((m_Flags[block.start] & ROM_SUBROUTINE) ? "sub " : "block ") << Hex(block.start) << " ->";
+		for (unsigned short successor : block.successors)
+			out << " " << Hex(successor);
+		out << (block.returns ? " ret" : "") << (block.indirect ? " indirect" : "") << (block.invalid ? " invalid" : "") << std::endl;
+
+		for (unsigned int address = block.start; address < block.end; address += 2)
+		{
+			out << "  " << Hex(address) << "  " << ((m_Flags[address] & ROM_WRITTEN) ? "W " : "  ")
+				<< Disassemble(OpCodeAt(static_cast<unsigned short>(address))) << std::endl;
+		}
+	}
+}
+
+void RomAnalysis::WriteMap(std::ostream& out) const
+{
+	//! code that is written, C code, W written, S sprite, D data, . not reached
+	for (int row = PROGRAM_START; row < m_RomEnd; row += 64)
+	{
+		out << Hex(row) << " ";
+		for (int address = row; address < row + 64 && address < m_RomEnd; ++address)
+		{
+			const unsigned char flags = m_Flags[address];
+			if ((flags & ROM_CODE) && (flags & ROM_WRITTEN))
+				out << '!';
+			else if (flags & ROM_CODE)
+				out << 'C';
+			else if (flags & ROM_WRITTEN)
+				out << 'W';
+			else if (flags & ROM_SPRITE)
+				out << 'S';
+			else if (flags & ROM_DATA)
+				out << 'D';
+			else
+				out << '.';
+		}
+		out << std::endl;
+	}
+}
+
+void RomAnalysis::WriteDot(std::ostream& out, const std::string& name) const
+{
+	out << "digraph \"" << name << "\" {" << std::endl;
+	out << "\tnode [shape=box, fontname=monospace];" << std::endl;
+	for (const BasicBlock& block : m_Blocks)
+	{
+		out << "\t\"" << Hex(block.start) << "\" [label=\"";
+		for (unsigned int address = block.start; address < block.end; address += 2)
+			out << Hex(address) << "  " << Disassemble(OpCodeAt(static_cast<unsigned short>(address))) << "\\l";
+		out << "\"" << ((m_Flags[block.start] & ROM_SUBROUTINE) ? ", penwidth=3" : "") << "];" << std::endl;
+
+		for (size_t i = 0; i < block.successors.size(); ++i)
+		{
+			const bool call = (i == 1 && GetFlow(OpCodeAt(static_cast<unsigned short>(block.end - 2))) == FLOW_CALL);
+			out << "\t\"" << Hex(block.start) << "\" -> \"" << Hex(block.successors[i]) << "\"" << (call ? " [style=dashed]" : "") << ";" << std::endl;
+		}
+	}
+	out << "}" << std::endl;
+}
+
+void RomAnalysis::Serialize(std::vector<unsigned char>& data) const
+{
+	data.clear();
+	data.push_back(VERSION);
+	WriteVarint(data, m_RomEnd);
+	data.insert(data.end(), m_Memory + PROGRAM_START, m_Memory + m_RomEnd);
+
+	std::vector<unsigned char> flags;
+	DeltaEncode(m_Flags, nullptr, ADDRESS_COUNT, flags);
+	WriteVarint(data, flags.size());
+	data.insert(data.end(), flags.begin(), flags.end());
+
+	WriteVarint(data, m_Blocks.size());
+	for (const BasicBlock& block : m_Blocks)
+	{
+		WriteVarint(data, block.start);
+		WriteVarint(data, block.end);
+		data.push_back(static_cast<unsigned char>((block.returns ? 1 : 0) | (block.indirect ? 2 : 0) | (block.invalid ? 4 : 0)));
+		WriteList(data, block.successors);
+	}
+	WriteList(data, m_Subroutines);
+	WriteList(data, m_UnknownReads);
+	WriteList(data, m_UnknownWrites);
+}
+
+bool RomAnalysis::Deserialize(const unsigned char* data, size_t size)
+{
+	size_t position = 1;
+	unsigned long long romEnd;
+	unsigned long long flagsSize;
+	if (size < 1 || data[0] != VERSION || !ReadVarint(data, size, position, romEnd) || romEnd < PROGRAM_START || romEnd > ADDRESS_COUNT
+		|| size - position < romEnd - PROGRAM_START)
+		return false;
+
+	std::memset(m_Memory, 0, sizeof(m_Memory));
+	m_RomEnd = static_cast<unsigned short>(romEnd);
+	std::memcpy(m_Memory + PROGRAM_START, data + position, m_RomEnd - PROGRAM_START);
+	position += m_RomEnd - PROGRAM_START;
+
+	if (!ReadVarint(data, size, position, flagsSize) || size - position < flagsSize
+		|| !DeltaDecode(data + position, static_cast<size_t>(flagsSize), nullptr, m_Flags, ADDRESS_COUNT))
+		return false;
+	position += static_cast<size_t>(flagsSize);
+
+	unsigned long long blockCount;
+	if (!ReadVarint(data, size, position, blockCount) || blockCount > ADDRESS_COUNT)
+		return false;
+
+	m_Blocks.resize(static_cast<size_t>(blockCount));
+	for (BasicBlock& block : m_Blocks)
+	{
+		unsigned long long start;
+		unsigned long long end;
+		if (!ReadVarint(data, size, position, start) || !ReadVarint(data, size, position, end) || position >= size)
+			return false;
+
+		block.start = static_cast<unsigned short>(start);
+		block.end = static_cast<unsigned short>(end);
+		const unsigned char bits = data[position++];
+		block.returns = (bits & 1) != 0;
+		block.indirect = (bits & 2) != 0;
+		block.invalid = (bits & 4) != 0;
+		if (!ReadList(data, size, position, block.successors))
+			return false;
+	}
+
+	return ReadList(data, size, position, m_Subroutines) && ReadList(data, size, position, m_UnknownReads)
+		&& ReadList(data, size, position, m_UnknownWrites) && position == size;
+}
+
+bool RomAnalysisCache::Load(const std::string& path)
+{
+	std::ifstream file(path, std::ios_base::binary);
+	if (file.fail())
+		return false;
+
+	char sha1[40];
+	unsigned char sizeBytes[4];
+	std::vector<unsigned char> data;
+	while (file.read(sha1, sizeof(sha1)) && file.read(reinterpret_cast<char*>(sizeBytes), sizeof(sizeBytes)))
+	{
+		data.resize(sizeBytes[0] | (sizeBytes[1] << 8) | (sizeBytes[2] << 16) | (static_cast<size_t>(sizeBytes[3]) << 24));
+		if (!file.read(reinterpret_cast<char*>(data.data()), data.size()))
+			break;
+
+		//Records of an older version are analysed again
+		RomAnalysis analysis;
+		if (analysis.Deserialize(data.data(), data.size()))
+			m_Analyses[std::string(sha1, sizeof(sha1))] = analysis;
+	}
+	return true;
+}
+
+bool RomAnalysisCache::Save(const std::string& path) const
+{
+	std::ofstream file(path, std::ios_base::binary);
+	std::vector<unsigned char> data;
+	for (const auto& entry : m_Analyses)
+	{
+		entry.second.Serialize(data);
+		const unsigned char sizeBytes[4] = { static_cast<unsigned char>(data.size()), static_cast<unsigned char>(data.size() >> 8),
+			static_cast<unsigned char>(data.size() >> 16), static_cast<unsigned char>(data.size() >> 24) };
+		file.write(entry.first.data(), entry.first.size());
+		file.write(reinterpret_cast<const char*>(sizeBytes), sizeof(sizeBytes));
+		file.write(reinterpret_cast<const char*>(data.data()), data.size());
+	}
+
+	if (file.fail())
+	{
+		std::cout << "Failed to write the analysis cache " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+const RomAnalysis& RomAnalysisCache::Get(const unsigned char* rom, size_t size)
+{
+	const std::string sha1 = Sha1Hex(rom, size);
+	const auto cached = m_Analyses.find(sha1);
+	if (cached != m_Analyses.end())
+	{
+		++m_Hits;
+		return cached->second;
+	}
+
+	++m_Misses;
+	RomAnalysis& analysis = m_Analyses[sha1];
+	analysis.Analyze(rom, size);
+	return analysis;
+}
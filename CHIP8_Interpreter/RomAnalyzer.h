@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Interpreter.h"
+
+//What the analysis found out about a byte of the address space, combined as flags
+enum RomByteFlags
+{
+	ROM_CODE = 1, //part of a reachable instruction
+	ROM_INSTRUCTION = 2, //first byte of a reachable instruction
+	ROM_BLOCK_START = 4,
+	ROM_SUBROUTINE = 8, //target of a 2NNN
+	ROM_SPRITE = 16, //drawn by a DXYN with I set by an ANNN
+	ROM_DATA = 32, //read by an FX65
+	ROM_WRITTEN = 64 //written by an FX33 or FX55
+};
+
+//Straight line code from start to end (exclusive), only the last instruction can branch
+struct BasicBlock
+{
+	unsigned short start;
+	unsigned short end;
+	std::vector<unsigned short> successors; //the fall through or not taken successor first, then the jump, call or skip target
+	bool returns = false; //ends with 00EE
+	bool indirect = false; //ends with BNNN, the successors depend on V0
+	bool invalid = false; //ends at an invalid opcode or the end of the rom
+};
+
+/* Static analysis of a rom loaded at 0x200: follows every jump (1NNN), call (2NNN) and skip from 0x200 to find the reachable code,
+splits it into basic blocks and tracks the value of I along the way, so sprites (ANNN then DXYN), data (FX65) and writes (FX33, FX55) are
+attributed to the bytes they touch. I is known after ANNN, after ADD I, VX a read is attributed to the table at the base address from
+its first byte on and a write is unknown, anywhere else (after a RET, where paths with different values meet) it is unknown.
+Predecoding and translating backends can use it to see which code may be overwritten: code that is ROM_WRITTEN, or any code at all when
+HasUnknownWrites is true, has to be checked at run time.*/
+class RomAnalysis
+{
+public:
+	static const unsigned short PROGRAM_START = 0x200;
+	static const int ADDRESS_COUNT = 0x1000;
+
+	void Analyze(const unsigned char* rom, size_t size);
+
+	unsigned char GetFlags(unsigned short address) const { return m_Flags[address & 0xFFF]; }
+	const std::vector<BasicBlock>& GetBlocks() const { return m_Blocks; }
+	const std::vector<unsigned short>& GetSubroutines() const { return m_Subroutines; }
+
+	//Instructions that access memory through an I the analysis couldn't follow
+	const std::vector<unsigned short>& GetUnknownReads() const { return m_UnknownReads; }
+	const std::vector<unsigned short>& GetUnknownWrites() const { return m_UnknownWrites; }
+	bool HasUnknownWrites() const { return !m_UnknownWrites.empty(); }
+
+	//Reachable code that a write found by the analysis overlaps
+	bool IsSelfModifying() const;
+
+	size_t CountBytes(unsigned char flags) const;
+
+	//Instructions that set VF as a side result (8XY4-8XYE, DXYN, FX1E) where every path overwrites VF before reading it.
+	//Backward liveness over the blocks, a path that leaves the analysed code (BNNN, an invalid opcode) counts as a read
+	std::vector<unsigned short> FindDeadFlagWrites(const Quirks& quirks) const;
+
+	//Summary, the blocks with their disassembly and a map with a character per byte of the rom
+	void WriteSummary(std::ostream& out) const;
+	void WriteBlocks(std::ostream& out) const;
+	void WriteMap(std::ostream& out) const;
+
+	//Graphviz digraph of the blocks, subroutine entries are drawn bold and call edges dashed
+	void WriteDot(std::ostream& out, const std::string& name) const;
+
+	//Binary form for caches, Deserialize returns false for data of another version
+	void Serialize(std::vector<unsigned char>& data) const;
+	bool Deserialize(const unsigned char* data, size_t size);
+
+private:
+	unsigned char m_Memory[ADDRESS_COUNT] = {};
+	unsigned char m_Flags[ADDRESS_COUNT] = {};
+	unsigned short m_RomEnd = PROGRAM_START;
+	std::vector<BasicBlock> m_Blocks;
+	std::vector<unsigned short> m_Subroutines;
+	std::vector<unsigned short> m_UnknownReads;
+	std::vector<unsigned short> m_UnknownWrites;
+
+	unsigned short OpCodeAt(unsigned short address) const { return static_cast<unsigned short>((m_Memory[address & 0xFFF] << 8) | m_Memory[(address + 1) & 0xFFF]); }
+	void Mark(int state, int length, unsigned char flag, std::vector<unsigned short>& unknown, unsigned short instruction);
+	void BuildBlocks();
+};
+
+/* Analyses of roms by SHA-1 in a file, one record per rom: 40 hex characters, a u32 little endian size and the serialized analysis.
+Analysing a rom takes microseconds, the cache keeps the results of a whole directory for tools that need them on every start.*/
+class RomAnalysisCache
+{
+public:
+	bool Load(const std::string& path);
+	bool Save(const std::string& path) const;
+
+	//Returns the cached analysis of the rom or analyses and adds it
+	const RomAnalysis& Get(const unsigned char* rom, size_t size);
+
+	size_t GetHits() const { return m_Hits; }
+	size_t GetMisses() const { return m_Misses; }
+
+private:
+	std::unordered_map<std::string, RomAnalysis> m_Analyses;
+	size_t m_Hits = 0;
+	size_t m_Misses = 0;
+};
@@ -0,0 +1,278 @@
+#include "RomArchive.h"
+#include "RomHash.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	struct Header
+	{
+		char magic[4];
+		unsigned int version;
+		unsigned int entryCount;
+		unsigned int tocOffset;
+		unsigned int namesOffset;
+		unsigned int alignment;
+		unsigned long long reserved;
+	};
+
+	static_assert(sizeof(Header) == 32, "archive header must be 32 bytes");
+	static_assert(sizeof(RomArchive::Entry) == 32, "archive toc entries must be 32 bytes");
+
+	const char MAGIC[4] = { 'C', '8', 'R', 'A' };
+
+	unsigned int AlignUp(unsigned int value, unsigned int alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+RomArchive::RomArchive()
+{
+}
+
+RomArchive::~RomArchive()
+{
+	Close();
+}
+
+unsigned long long RomArchive::HashName(const std::string& name)
+{
+	unsigned long long hash = 14695981039346656037ull;
+	for (char c : name)
+	{
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+bool RomArchive::Build(const std::string& directory, const std::string& archivePath)
+{
+	struct Rom
+	{
+		std::string name;
+		std::vector<unsigned char> bytes;
+		Entry entry;
+	};
+	std::vector<Rom> roms;
+
+	std::error_code error;
+	for (const auto& file : std::filesystem::directory_iterator(directory, error))
+	{
+		const std::string extension = file.path().extension().string();
+		if (!file.is_regular_file() || !(extension.empty() || extension == ".ch8" || extension == ".c8"))
+			continue;
+
+		Rom rom;
+		rom.name = file.path().filename().string();
+
+		std::ifstream input(file.path(), std::ios_base::binary | std::ios_base::ate);
+		rom.bytes.resize(static_cast<size_t>(input.tellg()));
+		input.seekg(0);
+		input.read(reinterpret_cast<char*>(rom.bytes.data()), rom.bytes.size());
+		if (input.fail())
+		{
+			std::cout << "Failed to read rom " << file.path().string() << std::endl;
+			return false;
+		}
+
+		rom.entry = Entry();
+		rom.entry.nameHash = HashName(rom.name);
+		rom.entry.nameLength = static_cast<unsigned int>(rom.name.size());
+		rom.entry.dataSize = static_cast<unsigned int>(rom.bytes.size());
+		rom.entry.crc = Crc32(rom.bytes.data(), rom.bytes.size());
+		roms.push_back(std::move(rom));
+	}
+
+	if (error)
+	{
+		std::cout << "Failed to read rom directory " << directory << std::endl;
+		return false;
+	}
+
+	std::sort(roms.begin(), roms.end(), [](const Rom& a, const Rom& b) { return a.entry.nameHash < b.entry.nameHash; });
+
+	//Lay out header, toc, names and the aligned payloads
+	Header header = {};
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.entryCount = static_cast<unsigned int>(roms.size());
+	header.tocOffset = sizeof(Header);
+	header.namesOffset = header.tocOffset + header.entryCount * sizeof(Entry);
+	header.alignment = ALIGNMENT;
+
+	unsigned int offset = header.namesOffset;
+	for (Rom& rom : roms)
+	{
+		rom.entry.nameOffset = offset;
+		offset += rom.entry.nameLength;
+	}
+	for (Rom& rom : roms)
+	{
+		offset = AlignUp(offset, ALIGNMENT);
+		rom.entry.dataOffset = offset;
+		offset += rom.entry.dataSize;
+	}
+
+	std::vector<unsigned char> archive(offset, 0);
+	std::memcpy(archive.data(), &header, sizeof(header));
+	for (size_t i = 0; i < roms.size(); ++i)
+	{
+		const Rom& rom = roms[i];
+		std::memcpy(archive.data() + header.tocOffset + i * sizeof(Entry), &rom.entry, sizeof(Entry));
+		std::memcpy(archive.data() + rom.entry.nameOffset, rom.name.data(), rom.entry.nameLength);
+		std::memcpy(archive.data() + rom.entry.dataOffset, rom.bytes.data(), rom.entry.dataSize);
+	}
+
+	std::ofstream output(archivePath, std::ios_base::binary);
+	output.write(reinterpret_cast<const char*>(archive.data()), archive.size());
+	if (output.fail())
+	{
+		std::cout << "Failed to write rom archive " << archivePath << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool RomArchive::Open(const std::string& path)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		std::cout << "Failed to open rom archive " << path << std::endl;
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	GetFileSizeEx(file, &size);
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	const void* view = (mapping != NULL) ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (view == nullptr)
+	{
+		if (mapping != NULL)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		std::cout << "Failed to map rom archive " << path << std::endl;
+		return false;
+	}
+
+	m_File = file;
+	m_Mapping = mapping;
+	m_Data = static_cast<const unsigned char*>(view);
+	m_Size = static_cast<size_t>(size.QuadPart);
+#else
+	const int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		std::cout << "Failed to open rom archive " << path << std::endl;
+		return false;
+	}
+
+	struct stat status;
+	void* view = MAP_FAILED;
+	if (fstat(file, &status) == 0 && status.st_size > 0)
+		view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_SHARED, file, 0);
+	close(file); //the mapping keeps the file alive
+
+	if (view == MAP_FAILED)
+	{
+		std::cout << "Failed to map rom archive " << path << std::endl;
+		return false;
+	}
+
+	m_Data = static_cast<const unsigned char*>(view);
+	m_Size = static_cast<size_t>(status.st_size);
+#endif
+
+	//Validate everything once here, lookups trust the toc afterwards
+	Header header;
+	bool valid = m_Size >= sizeof(Header);
+	if (valid)
+	{
+		std::memcpy(&header, m_Data, sizeof(header));
+		valid = std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.version == VERSION
+			&& header.tocOffset + static_cast<unsigned long long>(header.entryCount) * sizeof(Entry) <= m_Size
+			&& header.tocOffset % alignof(Entry) == 0;
+	}
+
+	if (valid)
+	{
+		m_Entries = reinterpret_cast<const Entry*>(m_Data + header.tocOffset);
+		m_Count = header.entryCount;
+		for (size_t i = 0; i < m_Count && valid; ++i)
+		{
+			const Entry& entry = m_Entries[i];
+			valid = static_cast<unsigned long long>(entry.nameOffset) + entry.nameLength <= m_Size
+				&& static_cast<unsigned long long>(entry.dataOffset) + entry.dataSize <= m_Size;
+		}
+	}
+
+	if (!valid)
+	{
+		std::cout << "Invalid rom archive " << path << std::endl;
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void RomArchive::Close()
+{
+	if (m_Data == nullptr)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(m_Data);
+	CloseHandle(static_cast<HANDLE>(m_Mapping));
+	CloseHandle(static_cast<HANDLE>(m_File));
+	m_File = nullptr;
+	m_Mapping = nullptr;
+#else
+	munmap(const_cast<unsigned char*>(m_Data), m_Size);
+#endif
+
+	m_Data = nullptr;
+	m_Size = 0;
+	m_Entries = nullptr;
+	m_Count = 0;
+}
+
+std::string RomArchive::GetName(const Entry& entry) const
+{
+	return std::string(reinterpret_cast<const char*>(m_Data + entry.nameOffset), entry.nameLength);
+}
+
+const RomArchive::Entry* RomArchive::Find(const std::string& name) const
+{
+	const unsigned long long hash = HashName(name);
+	const Entry* end = m_Entries + m_Count;
+	const Entry* it = std::lower_bound(m_Entries, end, hash, [](const Entry& entry, unsigned long long value) { return entry.nameHash < value; });
+
+	//Names with colliding hashes are adjacent
+	for (; it != end && it->nameHash == hash; ++it)
+	{
+		if (it->nameLength == name.size() && std::memcmp(m_Data + it->nameOffset, name.data(), name.size()) == 0)
+			return it;
+	}
+	return nullptr;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/* Single file rom archive that is memory mapped once, so loading a rom is a lookup and a memcpy.
+Layout (little endian):
+Header 	32 bytes: "C8RA", version, entry count, toc offset, names offset, payload alignment, 8 reserved bytes
+Toc 	32 bytes per entry sorted by name hash: name hash (FNV-1a 64), name offset, name length, data offset, data size, crc32, reserved
+Names 	the entry names, not terminated
+Data 	the rom payloads, each aligned to the payload alignment*/
+class RomArchive
+{
+public:
+	struct Entry
+	{
+		unsigned long long nameHash;
+		unsigned int nameOffset;
+		unsigned int nameLength;
+		unsigned int dataOffset;
+		unsigned int dataSize;
+		unsigned int crc;
+		unsigned int reserved;
+	};
+
+	RomArchive();
+	~RomArchive();
+
+	RomArchive(const RomArchive&) = delete;
+	RomArchive& operator=(const RomArchive&) = delete;
+
+	//Packs every rom in directory (regular files without an extension or with .ch8/.c8) into archivePath
+	static bool Build(const std::string& directory, const std::string& archivePath);
+
+	bool Open(const std::string& path);
+	void Close();
+	bool IsOpen() const { return m_Data != nullptr; }
+
+	size_t GetCount() const { return m_Count; }
+	const Entry& GetEntry(size_t index) const { return m_Entries[index]; }
+	std::string GetName(const Entry& entry) const;
+	const unsigned char* GetData(const Entry& entry) const { return m_Data + entry.dataOffset; }
+
+	//Binary search on the name hash, nullptr when the archive has no rom with that name
+	const Entry* Find(const std::string& name) const;
+
+	static unsigned long long HashName(const std::string& name);
+
+private:
+	static const unsigned int VERSION = 1;
+	static const unsigned int ALIGNMENT = 64;
+
+	const unsigned char* m_Data = nullptr;
+	size_t m_Size = 0;
+	const Entry* m_Entries = nullptr;
+	size_t m_Count = 0;
+
+#ifdef _WIN32
+	void* m_File = nullptr;
+	void* m_Mapping = nullptr;
+#endif
+};
@@ -0,0 +1,249 @@
+#include "RomDatabase.h"
+#include "RomHash.h"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+const char* const RomProfile::DEFAULT_KEYS = "X123QWEASDZC4RFV";
+
+void RomProfile::Apply(Interpreter& interpreter) const
+{
+	interpreter.SetQuirks(quirks);
+	interpreter.SetInstructionsPerFrame(instructionsPerFrame);
+	interpreter.SetColors(pixelOn, pixelOff);
+}
+
+namespace
+{
+	bool ReadFile(const std::string& path, std::vector<unsigned char>& bytes)
+	{
+		std::ifstream file(path, std::ios_base::binary | std::ios_base::ate);
+		if (file.fail())
+			return false;
+
+		bytes.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+		return !file.fail();
+	}
+
+	bool ParseQuirks(const std::string& text, Quirks& quirks)
+	{
+		quirks.shiftUsesVY = false;
+		quirks.loadStoreIncrementsI = false;
+		quirks.jumpUsesVX = false;
+		quirks.logicResetsVF = false;
+		quirks.clipSprites = false;
+
+		if (text == "-")
+			return true;
+
+		for (char c : text)
+		{
+			switch (c)
+			{
+			case 's': quirks.shiftUsesVY = true; break;
+			case 'i': quirks.loadStoreIncrementsI = true; break;
+			case 'j': quirks.jumpUsesVX = true; break;
+			case 'v': quirks.logicResetsVF = true; break;
+			case 'c': quirks.clipSprites = true; break;
+			default: return false;
+			}
+		}
+		return true;
+	}
+
+	long long ModifiedTime(const std::filesystem::path& path)
+	{
+		std::error_code error;
+		const auto time = std::filesystem::last_write_time(path, error);
+		return error ? 0 : static_cast<long long>(time.time_since_epoch().count());
+	}
+}
+
+RomDatabase::RomDatabase()
+{
+}
+
+RomDatabase::~RomDatabase()
+{
+}
+
+bool RomDatabase::Load(const std::string& path)
+{
+	std::ifstream file(path);
+	if (file.fail())
+	{
+		std::cout << "Failed to load rom database with path " << path << std::endl;
+		return false;
+	}
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		++lineNumber;
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::istringstream stream(line);
+		RomProfile profile;
+		std::string quirks;
+		stream >> profile.sha1 >> std::hex >> profile.crc >> std::dec >> profile.instructionsPerFrame >> quirks
+			>> std::hex >> profile.pixelOn >> profile.pixelOff >> std::dec >> profile.keys;
+		std::getline(stream >> std::ws, profile.name);
+
+		if (stream.fail() || profile.sha1.size() != 40 || profile.keys.size() != 16 || !ParseQuirks(quirks, profile.quirks))
+		{
+			std::cout << "Invalid rom database entry on line " << lineNumber << " of " << path << std::endl;
+			continue;
+		}
+
+		std::transform(profile.sha1.begin(), profile.sha1.end(), profile.sha1.begin(), [](char c) { return static_cast<char>(::tolower(c)); });
+		m_Profiles.push_back(profile);
+	}
+
+	//Pointers into m_Profiles are only handed out after loading, so the index is built once here
+	m_ProfilesByCrc.clear();
+	for (size_t i = 0; i < m_Profiles.size(); ++i)
+		m_ProfilesByCrc.emplace(m_Profiles[i].crc, i);
+
+	return true;
+}
+
+const RomProfile* RomDatabase::Find(unsigned int crc, const std::string& sha1) const
+{
+	const auto range = m_ProfilesByCrc.equal_range(crc);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		if (m_Profiles[it->second].sha1 == sha1)
+			return &m_Profiles[it->second];
+	}
+	return nullptr;
+}
+
+const RomProfile* RomDatabase::Identify(const unsigned char* data, size_t size) const
+{
+	const unsigned int crc = Crc32(data, size);
+	if (!HasCrc(crc))
+		return nullptr;
+
+	return Find(crc, Sha1Hex(data, size));
+}
+
+const RomProfile* RomDatabase::IdentifyFile(const std::string& path) const
+{
+	std::vector<unsigned char> bytes;
+	if (!ReadFile(path, bytes))
+		return nullptr;
+
+	return Identify(bytes.data(), bytes.size());
+}
+
+void RomDatabase::ScanFile(RomScanEntry& entry, const RomScanEntry* cached) const
+{
+	const bool upToDate = cached != nullptr && cached->size == entry.size && cached->modified == entry.modified;
+	if (upToDate)
+	{
+		entry.crc = cached->crc;
+		entry.sha1 = cached->sha1;
+	}
+
+	//Only read the file when the cache can't answer: unknown file, or a crc match that was never hashed
+	if (!upToDate || (entry.sha1.empty() && HasCrc(entry.crc)))
+	{
+		std::vector<unsigned char> bytes;
+		if (!ReadFile(entry.path, bytes))
+			return;
+
+		entry.crc = Crc32(bytes.data(), bytes.size());
+		if (HasCrc(entry.crc))
+			entry.sha1 = Sha1Hex(bytes.data(), bytes.size());
+	}
+
+	if (!entry.sha1.empty())
+		entry.profile = Find(entry.crc, entry.sha1);
+}
+
+std::vector<RomScanEntry> RomDatabase::ScanDirectory(const std::string& directory, const std::string& cachePath, int threadCount) const
+{
+	std::vector<RomScanEntry> entries;
+
+	std::error_code error;
+	for (const auto& file : std::filesystem::directory_iterator(directory, error))
+	{
+		if (!file.is_regular_file())
+			continue;
+
+		RomScanEntry entry;
+		entry.path = file.path().string();
+		entry.size = file.file_size();
+		entry.modified = ModifiedTime(file.path());
+		entries.push_back(entry);
+	}
+
+	if (error)
+	{
+		std::cout << "Failed to scan rom directory " << directory << std::endl;
+		return entries;
+	}
+
+	//Cache lines: <crc> <sha1 or -> <size> <modified> <path>
+	std::unordered_map<std::string, RomScanEntry> cache;
+	if (!cachePath.empty())
+	{
+		std::ifstream cacheFile(cachePath);
+		std::string line;
+		while (std::getline(cacheFile, line))
+		{
+			std::istringstream stream(line);
+			RomScanEntry cached;
+			stream >> std::hex >> cached.crc >> std::dec >> cached.sha1 >> cached.size >> cached.modified;
+			std::getline(stream >> std::ws, cached.path);
+			if (stream.fail())
+				continue;
+
+			if (cached.sha1 == "-")
+				cached.sha1.clear();
+			cache[cached.path] = cached;
+		}
+	}
+
+	if (threadCount <= 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	threadCount = std::min(threadCount, static_cast<int>(entries.size()));
+
+	std::atomic<size_t> next(0);
+	auto worker = [&]()
+	{
+		for (size_t i = next++; i < entries.size(); i = next++)
+		{
+			const auto cached = cache.find(entries[i].path);
+			ScanFile(entries[i], (cached != cache.end()) ? &cached->second : nullptr);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int i = 1; i < threadCount; ++i)
+		threads.emplace_back(worker);
+	worker();
+	for (std::thread& thread : threads)
+		thread.join();
+
+	if (!cachePath.empty())
+	{
+		std::ofstream cacheFile(cachePath);
+		for (const RomScanEntry& entry : entries)
+		{
+			cacheFile << std::hex << entry.crc << std::dec << ' ' << (entry.sha1.empty() ? "-" : entry.sha1) << ' '
+				<< entry.size << ' ' << entry.modified << ' ' << entry.path << '\n';
+		}
+	}
+
+	return entries;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Interpreter.h"
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//Settings a specific rom needs to run correctly, looked up by the rom's content hash
+struct RomProfile
+{
+	//Host key (GLFW key code, which is the uppercase character for letters and digits) for CHIP-8 keys 0 to F
+	static const char* const DEFAULT_KEYS;
+
+	std::string name;
+	std::string sha1;
+	unsigned int crc = 0;
+
+	Quirks quirks;
+	int instructionsPerFrame = 10;
+	unsigned int pixelOn = 0xFFFFFF00;
+	unsigned int pixelOff = 0x00000000;
+	std::string keys = DEFAULT_KEYS;
+
+	//Applies quirks, speed and colors, the key layout is up to the frontend
+	void Apply(Interpreter& interpreter) const;
+};
+
+//Result of scanning a single file
+struct RomScanEntry
+{
+	std::string path;
+	unsigned long long size = 0;
+	long long modified = 0;
+	unsigned int crc = 0;
+	std::string sha1; //empty when no database entry shares the crc, there is no need to hash those
+	const RomProfile* profile = nullptr;
+};
+
+/* Content addressed rom database, one rom per line (# starts a comment):
+<sha1> <crc32> <instructions per frame> <quirks> <on color> <off color> <keys> <name>
+Quirks are letters: s = shiftUsesVY, i = loadStoreIncrementsI, j = jumpUsesVX, v = logicResetsVF, c = clipSprites, - = none.
+Colors are RRGGBBAA hex, keys are the 16 host keys for CHIP-8 keys 0 to F.*/
+class RomDatabase
+{
+public:
+	RomDatabase();
+	~RomDatabase();
+
+	bool Load(const std::string& path);
+	size_t GetSize() const { return m_Profiles.size(); }
+
+	const RomProfile* Find(unsigned int crc, const std::string& sha1) const;
+
+	//Computes the crc first and only hashes with SHA-1 when an entry with that crc exists
+	const RomProfile* Identify(const unsigned char* data, size_t size) const;
+	const RomProfile* IdentifyFile(const std::string& path) const;
+
+	/*Identifies every regular file in directory using all hardware threads (or threadCount).
+	Hashes are cached in cachePath by file size and modification time, so unchanged files are not read again.
+	An empty cachePath disables the cache.*/
+	std::vector<RomScanEntry> ScanDirectory(const std::string& directory, const std::string& cachePath, int threadCount = 0) const;
+
+private:
+	std::vector<RomProfile> m_Profiles;
+	std::unordered_multimap<unsigned int, size_t> m_ProfilesByCrc;
+
+	bool HasCrc(unsigned int crc) const { return m_ProfilesByCrc.count(crc) != 0; }
+	void ScanFile(RomScanEntry& entry, const RomScanEntry* cached) const;
+};
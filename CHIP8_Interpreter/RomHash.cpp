@@ -0,0 +1,118 @@
+#include "RomHash.h"
+
+#include <cstring>
+
+namespace
+{
+	struct Crc32Table
+	{
+		unsigned int entries[256];
+
+		Crc32Table()
+		{
+			for (unsigned int i = 0; i < 256; ++i)
+			{
+				unsigned int crc = i;
+				for (int bit = 0; bit < 8; ++bit)
+					crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+				entries[i] = crc;
+			}
+		}
+	};
+
+	inline unsigned int RotateLeft(unsigned int value, int bits)
+	{
+		return (value << bits) | (value >> (32 - bits));
+	}
+
+	void Sha1Block(unsigned int state[5], const unsigned char* block)
+	{
+		unsigned int w[80];
+		for (int i = 0; i < 16; ++i)
+			w[i] = block[i * 4] << 24 | block[i * 4 + 1] << 16 | block[i * 4 + 2] << 8 | block[i * 4 + 3];
+		for (int i = 16; i < 80; ++i)
+			w[i] = RotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+		unsigned int a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+		for (int i = 0; i < 80; ++i)
+		{
+			unsigned int f, k;
+			if (i < 20)
+			{
+				f = (b & c) | (~b & d);
+				k = 0x5A827999;
+			}
+			else if (i < 40)
+			{
+				f = b ^ c ^ d;
+				k = 0x6ED9EBA1;
+			}
+			else if (i < 60)
+			{
+				f = (b & c) | (b & d) | (c & d);
+				k = 0x8F1BBCDC;
+			}
+			else
+			{
+				f = b ^ c ^ d;
+				k = 0xCA62C1D6;
+			}
+
+			const unsigned int temp = RotateLeft(a, 5) + f + e + k + w[i];
+			e = d;
+			d = c;
+			c = RotateLeft(b, 30);
+			b = a;
+			a = temp;
+		}
+
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+	}
+}
+
+unsigned int Crc32(const unsigned char* data, size_t size)
+{
+	static const Crc32Table table;
+
+	unsigned int crc = 0xFFFFFFFFu;
+	for (size_t i = 0; i < size; ++i)
+		crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return crc ^ 0xFFFFFFFFu;
+}
+
+std::string Sha1Hex(const unsigned char* data, size_t size)
+{
+	unsigned int state[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+	size_t offset = 0;
+	for (; offset + 64 <= size; offset += 64)
+		Sha1Block(state, data + offset);
+
+	//Pad the tail with 0x80, zeroes and the message length in bits (big endian)
+	unsigned char tail[128] = {};
+	const size_t remaining = size - offset;
+	std::memcpy(tail, data + offset, remaining);
+	tail[remaining] = 0x80;
+
+	const size_t tailSize = (remaining < 56) ? 64 : 128;
+	const unsigned long long bitCount = static_cast<unsigned long long>(size) * 8;
+	for (int i = 0; i < 8; ++i)
+		tail[tailSize - 1 - i] = static_cast<unsigned char>(bitCount >> (i * 8));
+
+	for (size_t i = 0; i < tailSize; i += 64)
+		Sha1Block(state, tail + i);
+
+	static const char hexDigits[] = "0123456789abcdef";
+	std::string hex(40, '0');
+	for (int i = 0; i < 20; ++i)
+	{
+		const unsigned char byte = static_cast<unsigned char>(state[i / 4] >> (24 - (i % 4) * 8));
+		hex[i * 2] = hexDigits[byte >> 4];
+		hex[i * 2 + 1] = hexDigits[byte & 0xF];
+	}
+	return hex;
+}
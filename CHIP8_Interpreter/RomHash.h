@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+//CRC-32 (IEEE 802.3), cheap enough to compute for every file while scanning
+unsigned int Crc32(const unsigned char* data, size_t size);
+
+//SHA-1 of data as 40 lowercase hex characters, used as the content address of a rom
+std::string Sha1Hex(const unsigned char* data, size_t size);
@@ -0,0 +1,313 @@
+#include "Socket.h"
+
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef int socklen_t;
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+//Writing to a closed connection fails instead of raising SIGPIPE
+#ifdef MSG_NOSIGNAL
+const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+const int SEND_FLAGS = 0;
+#endif
+
+namespace
+{
+	bool SetNonBlocking(SocketHandle handle)
+	{
+#ifdef _WIN32
+		u_long nonBlocking = 1;
+		return ioctlsocket(handle, FIONBIO, &nonBlocking) == 0;
+#else
+		const int flags = fcntl(handle, F_GETFL, 0);
+		return flags != -1 && fcntl(handle, F_SETFL, flags | O_NONBLOCK) != -1;
+#endif
+	}
+}
+
+void CloseSocket(SocketHandle socket)
+{
+#ifdef _WIN32
+	closesocket(socket);
+#else
+	close(socket);
+#endif
+}
+
+int SendSome(SocketHandle socket, const unsigned char* data, size_t size)
+{
+	const int sent = static_cast<int>(send(socket, reinterpret_cast<const char*>(data), static_cast<int>(size), SEND_FLAGS));
+	if (sent >= 0)
+		return sent;
+
+#ifdef _WIN32
+	return (WSAGetLastError() == WSAEWOULDBLOCK) ? 0 : -1;
+#else
+	return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+#endif
+}
+
+bool SetSendBufferSize(SocketHandle socket, int size)
+{
+	return setsockopt(socket, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&size), sizeof(size)) == 0;
+}
+
+bool InitializeSockets()
+{
+#ifdef _WIN32
+	static const bool initialized = []()
+	{
+		WSADATA data;
+		return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+	}();
+	return initialized;
+#else
+	return true;
+#endif
+}
+
+UdpSocket::UdpSocket()
+	: m_Socket(NO_SOCKET)
+{
+}
+
+UdpSocket::~UdpSocket()
+{
+	Close();
+}
+
+bool UdpSocket::Open(unsigned short port)
+{
+	Close();
+	if (!InitializeSockets())
+		return false;
+
+	m_Socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (m_Socket == NO_SOCKET)
+	{
+		std::cout << "Failed to create udp socket" << std::endl;
+		return false;
+	}
+
+	sockaddr_in address;
+	std::memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(port);
+	if (bind(m_Socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || !SetNonBlocking(m_Socket))
+	{
+		std::cout << "Failed to bind udp port " << port << std::endl;
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void UdpSocket::Close()
+{
+	if (m_Socket != NO_SOCKET)
+		CloseSocket(m_Socket);
+	m_Socket = NO_SOCKET;
+}
+
+bool UdpSocket::IsOpen() const
+{
+	return m_Socket != NO_SOCKET;
+}
+
+bool UdpSocket::SetPeer(const std::string& host, unsigned short port)
+{
+	if (!InitializeSockets())
+		return false;
+
+	addrinfo hints;
+	std::memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+
+	addrinfo* result = nullptr;
+	if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || result == nullptr)
+	{
+		std::cout << "Failed to resolve " << host << std::endl;
+		return false;
+	}
+
+	m_PeerAddress = reinterpret_cast<const sockaddr_in*>(result->ai_addr)->sin_addr.s_addr;
+	m_PeerPort = htons(port);
+	freeaddrinfo(result);
+	return true;
+}
+
+bool UdpSocket::Send(const unsigned char* data, size_t size)
+{
+	sockaddr_in address;
+	std::memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = m_PeerAddress;
+	address.sin_port = m_PeerPort;
+
+	const int sent = static_cast<int>(sendto(m_Socket, reinterpret_cast<const char*>(data), static_cast<int>(size), 0,
+		reinterpret_cast<const sockaddr*>(&address), sizeof(address)));
+	return sent == static_cast<int>(size);
+}
+
+int UdpSocket::Receive(unsigned char* buffer, size_t size)
+{
+	for (;;)
+	{
+		sockaddr_in address;
+		socklen_t addressLength = sizeof(address);
+		const int received = static_cast<int>(recvfrom(m_Socket, reinterpret_cast<char*>(buffer), static_cast<int>(size), 0,
+			reinterpret_cast<sockaddr*>(&address), &addressLength));
+		if (received < 0)
+			return -1;
+
+		if (address.sin_addr.s_addr == m_PeerAddress && address.sin_port == m_PeerPort)
+			return received;
+	}
+}
+
+unsigned short UdpSocket::GetLocalPort() const
+{
+	sockaddr_in address;
+	socklen_t addressLength = sizeof(address);
+	if (getsockname(m_Socket, reinterpret_cast<sockaddr*>(&address), &addressLength) != 0)
+		return 0;
+	return ntohs(address.sin_port);
+}
+
+StreamListener::StreamListener()
+	: m_Socket(NO_SOCKET)
+{
+}
+
+StreamListener::~StreamListener()
+{
+	Close();
+}
+
+bool StreamListener::OpenTcp(unsigned short port)
+{
+	Close();
+	if (!InitializeSockets())
+		return false;
+
+	m_Socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (m_Socket == NO_SOCKET)
+	{
+		std::cout << "Failed to create tcp socket" << std::endl;
+		return false;
+	}
+
+	const int reuse = 1;
+	setsockopt(m_Socket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+	sockaddr_in address;
+	std::memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(port);
+	if (bind(m_Socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(m_Socket, 16) != 0 || !SetNonBlocking(m_Socket))
+	{
+		std::cout << "Failed to listen on tcp port " << port << std::endl;
+		Close();
+		return false;
+	}
+	return true;
+}
+
+bool StreamListener::OpenUnix(const std::string& path)
+{
+	Close();
+#ifdef _WIN32
+	std::cout << "Unix domain sockets are not supported on this platform" << std::endl;
+	return false;
+#else
+	sockaddr_un address;
+	std::memset(&address, 0, sizeof(address));
+	if (path.size() >= sizeof(address.sun_path))
+	{
+		std::cout << "Socket path too long: " << path << std::endl;
+		return false;
+	}
+	address.sun_family = AF_UNIX;
+	std::memcpy(address.sun_path, path.c_str(), path.size());
+
+	m_Socket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (m_Socket == NO_SOCKET)
+	{
+		std::cout << "Failed to create unix socket" << std::endl;
+		return false;
+	}
+
+	//A socket file left behind by an earlier run would make bind fail
+	unlink(path.c_str());
+	if (bind(m_Socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(m_Socket, 16) != 0 || !SetNonBlocking(m_Socket))
+	{
+		std::cout << "Failed to listen on " << path << std::endl;
+		Close();
+		return false;
+	}
+	m_UnixPath = path;
+	return true;
+#endif
+}
+
+void StreamListener::Close()
+{
+	if (m_Socket != NO_SOCKET)
+		CloseSocket(m_Socket);
+	m_Socket = NO_SOCKET;
+
+#ifndef _WIN32
+	if (!m_UnixPath.empty())
+		unlink(m_UnixPath.c_str());
+#endif
+	m_UnixPath.clear();
+}
+
+bool StreamListener::IsOpen() const
+{
+	return m_Socket != NO_SOCKET;
+}
+
+SocketHandle StreamListener::Accept()
+{
+	if (m_Socket == NO_SOCKET)
+		return NO_SOCKET;
+
+	const SocketHandle connection = accept(m_Socket, nullptr, nullptr);
+	if (connection == NO_SOCKET)
+		return NO_SOCKET;
+
+	if (!SetNonBlocking(connection))
+	{
+		CloseSocket(connection);
+		return NO_SOCKET;
+	}
+	return connection;
+}
+
+unsigned short StreamListener::GetLocalPort() const
+{
+	sockaddr_in address;
+	socklen_t addressLength = sizeof(address);
+	if (getsockname(m_Socket, reinterpret_cast<sockaddr*>(&address), &addressLength) != 0 || address.sin_family != AF_INET)
+		return 0;
+	return ntohs(address.sin_port);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#ifdef _WIN32
+typedef unsigned long long SocketHandle; //SOCKET
+const SocketHandle NO_SOCKET = ~0ull; //INVALID_SOCKET
+#else
+typedef int SocketHandle;
+const SocketHandle NO_SOCKET = -1;
+#endif
+
+//Starts Winsock once on Windows, does nothing elsewhere. The socket classes call it themselves
+bool InitializeSockets();
+
+void CloseSocket(SocketHandle socket);
+
+//Writes as much of data as a non-blocking connection takes, returns the amount written or -1 when the connection is gone
+int SendSome(SocketHandle socket, const unsigned char* data, size_t size);
+
+//Caps what the kernel buffers for a connection, without it Linux grows the buffer to megabytes for a slow reader
+bool SetSendBufferSize(SocketHandle socket, int size);
+
+//Non-blocking IPv4 UDP socket that talks to a single peer
+class UdpSocket
+{
+public:
+	UdpSocket();
+	~UdpSocket();
+
+	UdpSocket(const UdpSocket&) = delete;
+	UdpSocket& operator=(const UdpSocket&) = delete;
+
+	//Binds to port on all interfaces, port 0 picks a free one
+	bool Open(unsigned short port);
+	void Close();
+	bool IsOpen() const;
+
+	//Destination of Send, datagrams from other addresses are ignored. host is a name or a dotted address
+	bool SetPeer(const std::string& host, unsigned short port);
+
+	bool Send(const unsigned char* data, size_t size);
+
+	//Returns the size of the next datagram from the peer, or -1 when none is waiting
+	int Receive(unsigned char* buffer, size_t size);
+
+	unsigned short GetLocalPort() const;
+
+private:
+	SocketHandle m_Socket;
+	unsigned int m_PeerAddress = 0; //network byte order
+	unsigned short m_PeerPort = 0; //network byte order
+};
+
+//Accepts stream connections on a TCP port or, except on Windows, a Unix domain socket. Accepted connections are non-blocking
+class StreamListener
+{
+public:
+	StreamListener();
+	~StreamListener();
+
+	StreamListener(const StreamListener&) = delete;
+	StreamListener& operator=(const StreamListener&) = delete;
+
+	bool OpenTcp(unsigned short port);
+	bool OpenUnix(const std::string& path);
+	void Close();
+	bool IsOpen() const;
+
+	//Returns a waiting connection, or NO_SOCKET when there is none
+	SocketHandle Accept();
+
+	unsigned short GetLocalPort() const;
+
+private:
+	SocketHandle m_Socket;
+	std::string m_UnixPath; //removed again on Close
+};
@@ -0,0 +1,284 @@
+#include "TimeTravel.h"
+
+#include <algorithm>
+
+#include "DeltaCodec.h"
+
+namespace
+{
+	const int ADDRESS_COUNT = 0x1000;
+
+	unsigned char* Bytes(Interpreter::Snapshot& snapshot)
+	{
+		return reinterpret_cast<unsigned char*>(&snapshot);
+	}
+
+	//Replayed frames are not heard again
+	class MuteScope
+	{
+	public:
+		explicit MuteScope(Interpreter& interpreter) : m_Interpreter(interpreter), m_SoundEnabled(interpreter.IsSoundEnabled()) { interpreter.SetSoundEnabled(false); }
+		~MuteScope() { m_Interpreter.SetSoundEnabled(m_SoundEnabled); }
+
+	private:
+		Interpreter& m_Interpreter;
+		bool m_SoundEnabled;
+	};
+}
+
+TimeTravel::TimeTravel(size_t byteBudget, unsigned long long checkpointInterval)
+	: m_ByteBudget(byteBudget)
+	, m_CheckpointInterval(checkpointInterval > 0 ? checkpointInterval : 1)
+{
+}
+
+void TimeTravel::Clear()
+{
+	m_Checkpoints.clear();
+	m_KeyChanges.clear();
+	m_LastCycle = 0;
+	m_ByteSize = 0;
+}
+
+void TimeTravel::Record(const Interpreter& interpreter)
+{
+	const unsigned long long cycle = interpreter.GetCycleCount();
+	if (cycle < m_LastCycle)
+		Truncate(cycle);
+	m_LastCycle = cycle;
+
+	if (m_Checkpoints.empty() || cycle >= m_Checkpoints.back().cycle + m_CheckpointInterval)
+	{
+		interpreter.SaveSnapshot(m_Scratch);
+		m_Checkpoints.emplace_back();
+		m_Checkpoints.back().cycle = cycle;
+		DeltaEncode(Bytes(m_Scratch), nullptr, sizeof(m_Scratch), m_Checkpoints.back().bytes);
+		m_Checkpoints.back().bytes.shrink_to_fit();
+		m_ByteSize += m_Checkpoints.back().bytes.size();
+	}
+
+	//The keypad can change again at the same cycle while the debugger holds a frame, the last value is the one that ran
+	if (m_KeyChanges.empty() || m_KeyChanges.back().keypad != interpreter.m_Keypad)
+	{
+		if (!m_KeyChanges.empty() && m_KeyChanges.back().cycle == cycle)
+		{
+			m_KeyChanges.back().keypad = interpreter.m_Keypad;
+		}
+		else
+		{
+			m_KeyChanges.push_back({ cycle, interpreter.m_Keypad });
+			m_ByteSize += sizeof(KeyChange);
+		}
+	}
+
+	Trim();
+}
+
+void TimeTravel::Truncate(unsigned long long cycle)
+{
+	while (!m_Checkpoints.empty() && m_Checkpoints.back().cycle > cycle)
+	{
+		m_ByteSize -= m_Checkpoints.back().bytes.size();
+		m_Checkpoints.pop_back();
+	}
+	while (!m_KeyChanges.empty() && m_KeyChanges.back().cycle > cycle)
+	{
+		m_ByteSize -= sizeof(KeyChange);
+		m_KeyChanges.pop_back();
+	}
+}
+
+void TimeTravel::Trim()
+{
+	while (m_ByteSize > m_ByteBudget && m_Checkpoints.size() > 2)
+	{
+		//Every other checkpoint of the older half goes, each pass doubles the spacing there
+		if (m_Checkpoints.size() >= 8)
+		{
+			const size_t half = m_Checkpoints.size() / 2;
+			size_t kept = 1;
+			for (size_t i = 1; i < m_Checkpoints.size(); ++i)
+			{
+				if (i < half && (i & 1) != 0)
+					m_ByteSize -= m_Checkpoints[i].bytes.size();
+				else
+					m_Checkpoints[kept++] = std::move(m_Checkpoints[i]);
+			}
+			m_Checkpoints.resize(kept);
+		}
+		else
+		{
+			m_ByteSize -= m_Checkpoints.front().bytes.size();
+			m_Checkpoints.erase(m_Checkpoints.begin());
+		}
+
+		//The first checkpoint holds the keypad of its cycle, changes before it aren't needed anymore
+		size_t unused = 0;
+		while (unused < m_KeyChanges.size() && m_KeyChanges[unused].cycle < m_Checkpoints.front().cycle)
+			++unused;
+		m_KeyChanges.erase(m_KeyChanges.begin(), m_KeyChanges.begin() + unused);
+		m_ByteSize -= unused * sizeof(KeyChange);
+	}
+}
+
+int TimeTravel::FindCheckpoint(unsigned long long cycle) const
+{
+	const std::vector<Checkpoint>::const_iterator next = std::upper_bound(m_Checkpoints.begin(), m_Checkpoints.end(), cycle,
+		[](unsigned long long value, const Checkpoint& checkpoint) { return value < checkpoint.cycle; });
+	return static_cast<int>(next - m_Checkpoints.begin()) - 1;
+}
+
+bool TimeTravel::Restore(Interpreter& interpreter, int index, size_t& keyIndex)
+{
+	const Checkpoint& checkpoint = m_Checkpoints[index];
+	if (!DeltaDecode(checkpoint.bytes.data(), checkpoint.bytes.size(), nullptr, Bytes(m_Scratch), sizeof(m_Scratch)))
+		return false;
+
+	interpreter.LoadSnapshot(m_Scratch);
+	keyIndex = std::lower_bound(m_KeyChanges.begin(), m_KeyChanges.end(), checkpoint.cycle,
+		[](const KeyChange& change, unsigned long long value) { return change.cycle < value; }) - m_KeyChanges.begin();
+	return true;
+}
+
+bool TimeTravel::StepReplay(Interpreter& interpreter, size_t& keyIndex)
+{
+	for (; keyIndex < m_KeyChanges.size() && m_KeyChanges[keyIndex].cycle <= interpreter.GetCycleCount(); ++keyIndex)
+		interpreter.m_Keypad = m_KeyChanges[keyIndex].keypad;
+	return interpreter.Step();
+}
+
+bool TimeTravel::ReplayTo(Interpreter& interpreter, unsigned long long cycle)
+{
+	const int index = FindCheckpoint(cycle);
+	size_t keyIndex;
+	if (index < 0 || !Restore(interpreter, index, keyIndex))
+		return false;
+
+	MuteScope mute(interpreter);
+	while (interpreter.GetCycleCount() < cycle)
+	{
+		if (!StepReplay(interpreter, keyIndex))
+			return false;
+	}
+
+	//The keypad in effect at the target, the frontend overwrites it when it runs on
+	for (; keyIndex < m_KeyChanges.size() && m_KeyChanges[keyIndex].cycle <= cycle; ++keyIndex)
+		interpreter.m_Keypad = m_KeyChanges[keyIndex].keypad;
+	interpreter.m_DrawFlag = true;
+	return true;
+}
+
+bool TimeTravel::Seek(Interpreter& interpreter, unsigned long long cycle)
+{
+	if (m_Checkpoints.empty() || cycle < GetStartCycle() || cycle > interpreter.GetCycleCount())
+		return false;
+
+	return ReplayTo(interpreter, cycle);
+}
+
+bool TimeTravel::StepBack(Interpreter& interpreter, unsigned long long count)
+{
+	const unsigned long long cycle = interpreter.GetCycleCount();
+	return Seek(interpreter, (cycle - GetStartCycle() > count) ? cycle - count : GetStartCycle());
+}
+
+bool TimeTravel::ContinueBack(Interpreter& interpreter)
+{
+	const unsigned long long target = interpreter.GetCycleCount();
+	if (m_Checkpoints.empty() || target <= GetStartCycle())
+		return false;
+
+	Interpreter::Snapshot current;
+	interpreter.SaveSnapshot(current);
+
+	//Scans one checkpoint interval at a time from the newest, the last hit of the first interval that has one wins
+	unsigned long long found = 0;
+	bool hit = false;
+	{
+		MuteScope mute(interpreter);
+		for (int index = FindCheckpoint(target - 1); index >= 0 && !hit; --index)
+		{
+			const unsigned long long end = (index + 1 < static_cast<int>(m_Checkpoints.size())) ? std::min(m_Checkpoints[index + 1].cycle, target) : target;
+			size_t keyIndex;
+			if (!Restore(interpreter, index, keyIndex))
+				break;
+
+			while (interpreter.GetCycleCount() < end)
+			{
+				//A breakpoint stops before its instruction, a watchpoint after
+				const unsigned long long cycle = interpreter.GetCycleCount();
+				if (interpreter.HasBreakpoint(interpreter.GetProgramCounter()))
+				{
+					found = cycle;
+					hit = true;
+				}
+				if (!StepReplay(interpreter, keyIndex))
+					break;
+				if (interpreter.IsAtWatchpoint() && cycle + 1 < target)
+				{
+					found = cycle + 1;
+					hit = true;
+				}
+			}
+		}
+	}
+
+	if (!hit || !ReplayTo(interpreter, found))
+	{
+		interpreter.LoadSnapshot(current);
+		return false;
+	}
+	return true;
+}
+
+bool TimeTravel::FindLastWrite(Interpreter& interpreter, unsigned short address, Write& write)
+{
+	const unsigned long long target = interpreter.GetCycleCount();
+	if (m_Checkpoints.empty() || target <= GetStartCycle())
+		return false;
+
+	Interpreter::Snapshot current;
+	interpreter.SaveSnapshot(current);
+
+	//Only this address is watched while scanning, an instruction reports a single hit
+	std::vector<int> watchpoints(ADDRESS_COUNT);
+	for (int i = 0; i < ADDRESS_COUNT; ++i)
+		watchpoints[i] = interpreter.GetWatchpoint(static_cast<unsigned short>(i));
+	interpreter.ClearWatchpoints();
+	interpreter.SetWatchpoint(address, Interpreter::WATCH_WRITE);
+
+	bool found = false;
+	{
+		MuteScope mute(interpreter);
+		for (int index = FindCheckpoint(target - 1); index >= 0 && !found; --index)
+		{
+			const unsigned long long end = (index + 1 < static_cast<int>(m_Checkpoints.size())) ? std::min(m_Checkpoints[index + 1].cycle, target) : target;
+			size_t keyIndex;
+			if (!Restore(interpreter, index, keyIndex))
+				break;
+
+			while (interpreter.GetCycleCount() < end)
+			{
+				const unsigned long long cycle = interpreter.GetCycleCount();
+				if (!StepReplay(interpreter, keyIndex))
+					break;
+				if (interpreter.IsAtWatchpoint())
+				{
+					write.cycle = cycle;
+					write.instruction = interpreter.GetWatchHit().instruction;
+					write.value = interpreter.GetWatchHit().value;
+					found = true;
+				}
+			}
+		}
+	}
+
+	interpreter.ClearWatchpoints();
+	for (int i = 0; i < ADDRESS_COUNT; ++i)
+	{
+		if (watchpoints[i] != 0)
+			interpreter.SetWatchpoint(static_cast<unsigned short>(i), watchpoints[i]);
+	}
+	interpreter.LoadSnapshot(current);
+	return found;
+}
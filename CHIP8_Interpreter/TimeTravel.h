@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Interpreter.h"
+
+/* History for reverse debugging. Execution is deterministic given the keypad, so only sparse checkpoints and the keypad changes are kept:
+a checkpoint (zero run compressed snapshot, see DeltaCodec.h) every checkpointInterval cycles and the cycle of every keypad change.
+Going back restores the last checkpoint before the target and steps forward to it, so it costs at most checkpointInterval instructions.
+When the history exceeds its budget the older half is thinned out, recent history stays dense so stepping back stays fast.*/
+class TimeTravel
+{
+public:
+	explicit TimeTravel(size_t byteBudget = 8 * 1024 * 1024, unsigned long long checkpointInterval = 10000);
+
+	TimeTravel(const TimeTravel&) = delete;
+	TimeTravel& operator=(const TimeTravel&) = delete;
+
+	//The frontend calls this before every RunFrame, after setting the keypad.
+	//A state earlier than the last recorded one (rewinding, going back in the debugger) drops the history after it
+	void Record(const Interpreter& interpreter);
+	void Clear();
+
+	//Moves the interpreter to cycle, returns false when the history doesn't reach back that far
+	bool Seek(Interpreter& interpreter, unsigned long long cycle);
+	bool StepBack(Interpreter& interpreter, unsigned long long count);
+
+	//Goes back to the last breakpoint or watchpoint hit before the current cycle, the interpreter is unchanged when there is none
+	bool ContinueBack(Interpreter& interpreter);
+
+	struct Write
+	{
+		unsigned long long cycle; //cycle count before the writing instruction ran
+		unsigned short instruction;
+		unsigned char value;
+	};
+
+	//Finds the last instruction before the current cycle that wrote address, the interpreter is left at the current cycle
+	bool FindLastWrite(Interpreter& interpreter, unsigned short address, Write& write);
+
+	unsigned long long GetStartCycle() const { return m_Checkpoints.empty() ? 0 : m_Checkpoints.front().cycle; }
+	size_t GetCheckpointCount() const { return m_Checkpoints.size(); }
+	size_t GetByteSize() const { return m_ByteSize; }
+
+private:
+	struct Checkpoint
+	{
+		unsigned long long cycle;
+		std::vector<unsigned char> bytes;
+	};
+
+	struct KeyChange
+	{
+		unsigned long long cycle;
+		unsigned short keypad;
+	};
+
+	std::vector<Checkpoint> m_Checkpoints;
+	std::vector<KeyChange> m_KeyChanges;
+	Interpreter::Snapshot m_Scratch = {};
+
+	size_t m_ByteBudget;
+	unsigned long long m_CheckpointInterval;
+	unsigned long long m_LastCycle = 0;
+	size_t m_ByteSize = 0;
+
+	void Truncate(unsigned long long cycle);
+	void Trim();
+
+	//Index of the last checkpoint at or before cycle, or -1
+	int FindCheckpoint(unsigned long long cycle) const;
+
+	//Loads checkpoint index, keyIndex is set to the first keypad change to apply while stepping from it
+	bool Restore(Interpreter& interpreter, int index, size_t& keyIndex);
+	bool StepReplay(Interpreter& interpreter, size_t& keyIndex);
+	bool ReplayTo(Interpreter& interpreter, unsigned long long cycle);
+};
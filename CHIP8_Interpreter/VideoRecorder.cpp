@@ -0,0 +1,106 @@
+#include "VideoRecorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+VideoRecorder::VideoRecorder()
+	: m_Queue(new Frame[QUEUE_CAPACITY])
+	, m_Head(0)
+	, m_Tail(0)
+	, m_Stopping(false)
+	, m_WriteFailed(false)
+{
+}
+
+VideoRecorder::~VideoRecorder()
+{
+	Stop();
+}
+
+bool VideoRecorder::Start(const std::string& path, VideoFormat format, int scale)
+{
+	Stop();
+
+	m_Writer = VideoWriter::Create(format, WIDTH, HEIGHT, scale);
+	if (m_Writer == nullptr || !m_Writer->Open(path))
+	{
+		std::cout << "Failed to open video " << path << std::endl;
+		m_Writer.reset();
+		return false;
+	}
+
+	m_Head.store(0, std::memory_order_relaxed);
+	m_Tail.store(0, std::memory_order_relaxed);
+	m_Stopping.store(false, std::memory_order_relaxed);
+	m_WriteFailed.store(false, std::memory_order_relaxed);
+	m_FrameNumber = 0;
+	m_DroppedFrames = 0;
+	m_Thread = std::thread(&VideoRecorder::EncodeFrames, this);
+	return true;
+}
+
+bool VideoRecorder::Stop()
+{
+	if (m_Writer == nullptr)
+		return true;
+
+	m_Stopping.store(true, std::memory_order_release);
+	m_Thread.join();
+
+	const bool written = m_Writer->Finish(m_FrameNumber) && !m_WriteFailed.load(std::memory_order_relaxed);
+	if (!written)
+		std::cout << "Failed to write the video" << std::endl;
+	if (m_DroppedFrames > 0)
+		std::cout << "Video dropped " << m_DroppedFrames << " of " << m_FrameNumber << " frames" << std::endl;
+
+	m_Writer.reset();
+	return written;
+}
+
+void VideoRecorder::Capture(const unsigned int* screen)
+{
+	if (m_Writer == nullptr)
+		return;
+
+	const unsigned long long number = m_FrameNumber++;
+	const unsigned long long head = m_Head.load(std::memory_order_relaxed);
+	if (head - m_Tail.load(std::memory_order_acquire) >= QUEUE_CAPACITY)
+	{
+		++m_DroppedFrames;
+		return;
+	}
+
+	Frame& frame = m_Queue[head % QUEUE_CAPACITY];
+	frame.number = number;
+	std::copy(screen, screen + WIDTH * HEIGHT, frame.pixels);
+	m_Head.store(head + 1, std::memory_order_release);
+}
+
+void VideoRecorder::EncodeFrames()
+{
+	unsigned long long tail = m_Tail.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		//Checked before the head, so frames pushed before Stop are still encoded
+		const bool stopping = m_Stopping.load(std::memory_order_acquire);
+		const unsigned long long head = m_Head.load(std::memory_order_acquire);
+		if (tail == head)
+		{
+			if (stopping)
+				return;
+
+			//A frame arrives every 16ms, polling costs nothing next to encoding it
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			continue;
+		}
+
+		for (; tail != head; ++tail)
+		{
+			const Frame& frame = m_Queue[tail % QUEUE_CAPACITY];
+			if (!m_WriteFailed.load(std::memory_order_relaxed) && !m_Writer->AddFrame(frame.pixels, frame.number))
+				m_WriteFailed.store(true, std::memory_order_relaxed);
+			m_Tail.store(tail + 1, std::memory_order_release);
+		}
+	}
+}
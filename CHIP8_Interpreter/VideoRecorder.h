@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "VideoWriter.h"
+
+/* Records the 64x32 display of every emulated frame to a video file without slowing the emulation down.
+Capture copies the screen into a single producer single consumer ring and returns, a background thread
+encodes and writes the frames (see VideoWriter.h). When the ring is full the frame is dropped and counted,
+the writer shows the previous frame for it, so the video keeps its timing.*/
+class VideoRecorder
+{
+public:
+	static const int WIDTH = 64;
+	static const int HEIGHT = 32;
+
+	//About 2 seconds of frames, the encoder only falls that far behind on a stalled disk
+	static const unsigned int QUEUE_CAPACITY = 128;
+
+	VideoRecorder();
+	~VideoRecorder();
+
+	VideoRecorder(const VideoRecorder&) = delete;
+	VideoRecorder& operator=(const VideoRecorder&) = delete;
+
+	bool Start(const std::string& path, VideoFormat format, int scale);
+
+	//Encodes the frames that are still queued and closes the file, returns false when writing failed
+	bool Stop();
+	bool IsRecording() const { return m_Writer != nullptr; }
+
+	//Call once per emulated frame from the emulation thread, never blocks
+	void Capture(const unsigned int* screen);
+
+	unsigned long long GetCapturedFrames() const { return m_FrameNumber; }
+	unsigned long long GetDroppedFrames() const { return m_DroppedFrames; }
+
+private:
+	struct Frame
+	{
+		unsigned long long number;
+		unsigned int pixels[WIDTH * HEIGHT];
+	};
+
+	std::unique_ptr<Frame[]> m_Queue;
+
+	//Counts of frames pushed and popped, each written by one side only. Apart to not share a cache line
+	alignas(64) std::atomic<unsigned long long> m_Head;
+	alignas(64) std::atomic<unsigned long long> m_Tail;
+	alignas(64) std::atomic<bool> m_Stopping;
+	std::atomic<bool> m_WriteFailed;
+
+	std::unique_ptr<VideoWriter> m_Writer;
+	std::thread m_Thread;
+
+	//Emulation thread only
+	unsigned long long m_FrameNumber = 0;
+	unsigned long long m_DroppedFrames = 0;
+
+	void EncodeFrames();
+};
@@ -0,0 +1,682 @@
+#include "VideoWriter.h"
+
+#include "Deflate.h"
+#include "RomHash.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+	unsigned char Red(unsigned int rgba) { return static_cast<unsigned char>(rgba >> 24); }
+	unsigned char Green(unsigned int rgba) { return static_cast<unsigned char>(rgba >> 16); }
+	unsigned char Blue(unsigned int rgba) { return static_cast<unsigned char>(rgba >> 8); }
+
+	void WriteBigEndian(std::vector<unsigned char>& out, unsigned int value, int bytes)
+	{
+		for (int i = bytes - 1; i >= 0; --i)
+			out.push_back(static_cast<unsigned char>(value >> (i * 8)));
+	}
+
+	void WriteLittleEndian(std::vector<unsigned char>& out, unsigned int value, int bytes)
+	{
+		for (int i = 0; i < bytes; ++i)
+			out.push_back(static_cast<unsigned char>(value >> (i * 8)));
+	}
+
+	bool WriteBytes(std::ofstream& file, const std::vector<unsigned char>& bytes)
+	{
+		file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+		return !file.fail();
+	}
+
+	//Uncompressed YUV 4:4:4 at 60 fps, BT.601 limited range
+	class Y4mWriter : public VideoWriter
+	{
+	public:
+		Y4mWriter(int width, int height, int scale) : VideoWriter(width, height, scale) {}
+
+		bool Open(const std::string& path) override
+		{
+			m_File.open(path, std::ios_base::binary);
+			m_File << "YUV4MPEG2 W" << m_Width * m_Scale << " H" << m_Height * m_Scale << " F60:1 Ip A1:1 C444\n";
+			return !m_File.fail();
+		}
+
+		bool AddFrame(const unsigned int* pixels, unsigned long long frame) override
+		{
+			//Skipped frames repeat the previous one so the timing stays right
+			if (!m_Planes.empty())
+			{
+				for (unsigned long long skipped = m_LastFrame + 1; skipped < frame; ++skipped)
+				{
+					if (!WriteFrame())
+						return false;
+				}
+			}
+			m_LastFrame = frame;
+
+			const int scaledWidth = m_Width * m_Scale;
+			const size_t planeSize = static_cast<size_t>(scaledWidth) * m_Height * m_Scale;
+			m_Planes.resize(planeSize * 3);
+			for (int y = 0; y < m_Height * m_Scale; ++y)
+			{
+				for (int x = 0; x < scaledWidth; ++x)
+				{
+					const unsigned int rgba = pixels[(y / m_Scale) * m_Width + x / m_Scale];
+					const int r = Red(rgba);
+					const int g = Green(rgba);
+					const int b = Blue(rgba);
+					const size_t index = static_cast<size_t>(y) * scaledWidth + x;
+					m_Planes[index] = static_cast<unsigned char>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+					m_Planes[planeSize + index] = static_cast<unsigned char>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+					m_Planes[planeSize * 2 + index] = static_cast<unsigned char>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+				}
+			}
+			return WriteFrame();
+		}
+
+		bool Finish(unsigned long long frameCount) override
+		{
+			bool written = true;
+			for (unsigned long long skipped = m_LastFrame + 1; skipped < frameCount && written && !m_Planes.empty(); ++skipped)
+				written = WriteFrame();
+			m_File.close();
+			return written && !m_File.fail();
+		}
+
+	private:
+		std::ofstream m_File;
+		std::vector<unsigned char> m_Planes;
+		unsigned long long m_LastFrame = 0;
+
+		bool WriteFrame()
+		{
+			m_File << "FRAME\n";
+			return WriteBytes(m_File, m_Planes);
+		}
+	};
+
+	//Base of the formats that store the changed rectangle of a frame and a delay
+	class DeltaVideoWriter : public VideoWriter
+	{
+	public:
+		DeltaVideoWriter(int width, int height, int scale) : VideoWriter(width, height, scale) {}
+
+		bool AddFrame(const unsigned int* pixels, unsigned long long frame) override
+		{
+			const size_t count = static_cast<size_t>(m_Width) * m_Height;
+			m_LastFrame = frame;
+			if (!m_HasPending)
+			{
+				m_Pending.assign(pixels, pixels + count);
+				m_PendingFrame = frame;
+				m_HasPending = true;
+				return true;
+			}
+
+			//An unchanged frame only makes the pending one last longer
+			if (std::equal(pixels, pixels + count, m_Pending.begin()))
+				return true;
+
+			bool written = true;
+			if (IsLongEnough(m_PendingFrame, frame))
+			{
+				written = Emit(m_PendingFrame, frame);
+				m_PendingFrame = frame;
+			}
+			m_Pending.assign(pixels, pixels + count);
+			return written;
+		}
+
+		bool Finish(unsigned long long frameCount) override
+		{
+			const bool written = !m_HasPending || Emit(m_PendingFrame, std::max(frameCount, m_LastFrame + 1));
+			m_HasPending = false;
+			return WriteTrailer() && written;
+		}
+
+	protected:
+		//Changed area in unscaled pixels, right and bottom exclusive
+		struct Rectangle
+		{
+			int left;
+			int top;
+			int right;
+			int bottom;
+		};
+
+		bool m_FirstFrame = true;
+
+		virtual bool IsLongEnough(unsigned long long start, unsigned long long end) const = 0;
+		virtual bool WriteFrame(const unsigned int* pixels, const Rectangle& area, unsigned long long start, unsigned long long end) = 0;
+		virtual bool WriteTrailer() = 0;
+
+	private:
+		std::vector<unsigned int> m_Pending;
+		unsigned long long m_PendingFrame = 0;
+		unsigned long long m_LastFrame = 0;
+		bool m_HasPending = false;
+		std::vector<unsigned int> m_Shown; //what the file shows after the last written frame
+
+		bool Emit(unsigned long long start, unsigned long long end)
+		{
+			Rectangle area = { 0, 0, m_Width, m_Height };
+			if (!m_FirstFrame)
+			{
+				area = { m_Width, m_Height, 0, 0 };
+				for (int y = 0; y < m_Height; ++y)
+				{
+					for (int x = 0; x < m_Width; ++x)
+					{
+						if (m_Pending[y * m_Width + x] != m_Shown[y * m_Width + x])
+						{
+							area.left = std::min(area.left, x);
+							area.top = std::min(area.top, y);
+							area.right = std::max(area.right, x + 1);
+							area.bottom = std::max(area.bottom, y + 1);
+						}
+					}
+				}
+
+				//A skipped frame can leave the shown one unchanged, the delay still has to be stored
+				if (area.left >= area.right)
+					area = { 0, 0, 1, 1 };
+			}
+
+			const bool written = WriteFrame(m_Pending.data(), area, start, end);
+			m_Shown = m_Pending;
+			m_FirstFrame = false;
+			return written;
+		}
+	};
+
+	class ApngWriter : public DeltaVideoWriter
+	{
+	public:
+		ApngWriter(int width, int height, int scale) : DeltaVideoWriter(width, height, scale) {}
+
+		bool Open(const std::string& path) override
+		{
+			m_File.open(path, std::ios_base::binary);
+
+			std::vector<unsigned char> bytes = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+			std::vector<unsigned char> header;
+			WriteBigEndian(header, m_Width * m_Scale, 4);
+			WriteBigEndian(header, m_Height * m_Scale, 4);
+			header.insert(header.end(), { 8, 2, 0, 0, 0 }); //8 bit RGB, no interlacing
+			AddChunk(bytes, "IHDR", header);
+			AddChunk(bytes, "acTL", AnimationControl());
+			return WriteBytes(m_File, bytes);
+		}
+
+	protected:
+		bool IsLongEnough(unsigned long long, unsigned long long) const override
+		{
+			return true;
+		}
+
+		bool WriteFrame(const unsigned int* pixels, const Rectangle& area, unsigned long long start, unsigned long long end) override
+		{
+			const int width = (area.right - area.left) * m_Scale;
+			const int height = (area.bottom - area.top) * m_Scale;
+
+			//Every scanline starts with filter type 0
+			m_Scanlines.clear();
+			for (int y = 0; y < height; ++y)
+			{
+				m_Scanlines.push_back(0);
+				const unsigned int* row = pixels + (area.top + y / m_Scale) * m_Width + area.left;
+				for (int x = 0; x < width; ++x)
+				{
+					const unsigned int rgba = row[x / m_Scale];
+					m_Scanlines.push_back(Red(rgba));
+					m_Scanlines.push_back(Green(rgba));
+					m_Scanlines.push_back(Blue(rgba));
+				}
+			}
+
+			std::vector<unsigned char> control;
+			WriteBigEndian(control, m_Sequence++, 4);
+			WriteBigEndian(control, width, 4);
+			WriteBigEndian(control, height, 4);
+			WriteBigEndian(control, area.left * m_Scale, 4);
+			WriteBigEndian(control, area.top * m_Scale, 4);
+			WriteBigEndian(control, static_cast<unsigned int>(std::min(end - start, 65535ull)), 2);
+			WriteBigEndian(control, 60, 2);
+			control.push_back(0); //keep the frame for the next one to draw over
+			control.push_back(0); //replace the area
+
+			//The first frame is also the still image, later ones are frame data chunks with a sequence number
+			std::vector<unsigned char> data;
+			if (!m_FirstFrame)
+				WriteBigEndian(data, m_Sequence++, 4);
+			ZlibCompress(m_Scanlines.data(), m_Scanlines.size(), data);
+
+			std::vector<unsigned char> bytes;
+			AddChunk(bytes, "fcTL", control);
+			AddChunk(bytes, m_FirstFrame ? "IDAT" : "fdAT", data);
+			++m_FrameCount;
+			return WriteBytes(m_File, bytes);
+		}
+
+		bool WriteTrailer() override
+		{
+			std::vector<unsigned char> bytes;
+			AddChunk(bytes, "IEND", {});
+			bool written = WriteBytes(m_File, bytes);
+
+			//The frame count wasn't known when the animation control chunk was written
+			std::vector<unsigned char> control;
+			AddChunk(control, "acTL", AnimationControl());
+			m_File.seekp(ANIMATION_CONTROL_OFFSET);
+			written = WriteBytes(m_File, control) && written;
+			m_File.close();
+			return written && !m_File.fail();
+		}
+
+	private:
+		//Signature and header chunk
+		static const int ANIMATION_CONTROL_OFFSET = 8 + 25;
+
+		std::ofstream m_File;
+		std::vector<unsigned char> m_Scanlines;
+		unsigned int m_Sequence = 0;
+		unsigned int m_FrameCount = 0;
+
+		std::vector<unsigned char> AnimationControl() const
+		{
+			std::vector<unsigned char> control;
+			WriteBigEndian(control, m_FrameCount, 4);
+			WriteBigEndian(control, 0, 4); //loop forever
+			return control;
+		}
+
+		static void AddChunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data)
+		{
+			WriteBigEndian(out, static_cast<unsigned int>(data.size()), 4);
+			const size_t start = out.size();
+			out.insert(out.end(), type, type + 4);
+			out.insert(out.end(), data.begin(), data.end());
+			WriteBigEndian(out, Crc32(out.data() + start, out.size() - start), 4);
+		}
+	};
+
+	//LZW as GIF uses it: variable code width up to 12 bits, packed starting at the least significant bit
+	void LzwEncode(const std::vector<unsigned char>& indices, int minCodeSize, std::vector<unsigned char>& out)
+	{
+		const int clearCode = 1 << minCodeSize;
+		const int alphabet = clearCode;
+
+		//Code of the string "code followed by index", 0 when not in the table yet (0 is never a string code)
+		std::vector<unsigned short> children(4096 * alphabet, 0);
+		int maxCode = clearCode + 1;
+		int codeSize = minCodeSize + 1;
+
+		unsigned int buffer = 0;
+		int bufferBits = 0;
+		auto emit = [&](int code)
+		{
+			buffer |= static_cast<unsigned int>(code) << bufferBits;
+			bufferBits += codeSize;
+			while (bufferBits >= 8)
+			{
+				out.push_back(static_cast<unsigned char>(buffer));
+				buffer >>= 8;
+				bufferBits -= 8;
+			}
+		};
+
+		emit(clearCode);
+		int prefix = indices.empty() ? -1 : indices[0];
+		for (size_t i = 1; i < indices.size(); ++i)
+		{
+			const int index = indices[i];
+			const unsigned short child = children[prefix * alphabet + index];
+			if (child != 0)
+			{
+				prefix = child;
+				continue;
+			}
+
+			emit(prefix);
+			children[prefix * alphabet + index] = static_cast<unsigned short>(++maxCode);
+			if (maxCode >= (1 << codeSize))
+				++codeSize;
+
+			//Table full, start over
+			if (maxCode == 4095)
+			{
+				emit(clearCode);
+				std::fill(children.begin(), children.end(), static_cast<unsigned short>(0));
+				maxCode = clearCode + 1;
+				codeSize = minCodeSize + 1;
+			}
+			prefix = index;
+		}
+
+		if (prefix != -1)
+			emit(prefix);
+		emit(clearCode + 1);
+		if (bufferBits > 0)
+			out.push_back(static_cast<unsigned char>(buffer));
+	}
+
+	class GifWriter : public DeltaVideoWriter
+	{
+	public:
+		GifWriter(int width, int height, int scale) : DeltaVideoWriter(width, height, scale) {}
+
+		bool Open(const std::string& path) override
+		{
+			m_File.open(path, std::ios_base::binary);
+
+			std::vector<unsigned char> bytes = { 'G', 'I', 'F', '8', '9', 'a' };
+			WriteLittleEndian(bytes, m_Width * m_Scale, 2);
+			WriteLittleEndian(bytes, m_Height * m_Scale, 2);
+			bytes.insert(bytes.end(), { 0, 0, 0 }); //no global palette, every frame brings its own
+
+			//Loop forever
+			const char netscape[] = "NETSCAPE2.0";
+			bytes.insert(bytes.end(), { 0x21, 0xFF, 11 });
+			bytes.insert(bytes.end(), netscape, netscape + 11);
+			bytes.insert(bytes.end(), { 3, 1, 0, 0, 0 });
+			return WriteBytes(m_File, bytes);
+		}
+
+	protected:
+		bool IsLongEnough(unsigned long long start, unsigned long long end) const override
+		{
+			return Centiseconds(end) - Centiseconds(start) >= 2;
+		}
+
+		bool WriteFrame(const unsigned int* pixels, const Rectangle& area, unsigned long long start, unsigned long long end) override
+		{
+			const int width = (area.right - area.left) * m_Scale;
+			const int height = (area.bottom - area.top) * m_Scale;
+
+			//Palette of the area, a 64x32 display rarely has more than 2 colors
+			m_Palette.clear();
+			m_Indices.clear();
+			for (int y = 0; y < height; ++y)
+			{
+				const unsigned int* row = pixels + (area.top + y / m_Scale) * m_Width + area.left;
+				for (int x = 0; x < width; ++x)
+					m_Indices.push_back(PaletteIndex(row[x / m_Scale]));
+			}
+
+			int tableBits = 1;
+			while ((1u << tableBits) < m_Palette.size())
+				++tableBits;
+
+			std::vector<unsigned char> bytes;
+			const unsigned long long delay = std::min(Centiseconds(end) - Centiseconds(start), 65535ull);
+			bytes.insert(bytes.end(), { 0x21, 0xF9, 4, 1 << 2 }); //graphic control: keep the frame for the next one to draw over
+			WriteLittleEndian(bytes, static_cast<unsigned int>(delay), 2);
+			bytes.insert(bytes.end(), { 0, 0 });
+
+			bytes.push_back(0x2C);
+			WriteLittleEndian(bytes, area.left * m_Scale, 2);
+			WriteLittleEndian(bytes, area.top * m_Scale, 2);
+			WriteLittleEndian(bytes, width, 2);
+			WriteLittleEndian(bytes, height, 2);
+			bytes.push_back(static_cast<unsigned char>(0x80 | (tableBits - 1)));
+			for (int i = 0; i < (1 << tableBits); ++i)
+			{
+				const unsigned int rgba = (i < static_cast<int>(m_Palette.size())) ? m_Palette[i] : 0;
+				bytes.insert(bytes.end(), { Red(rgba), Green(rgba), Blue(rgba) });
+			}
+
+			const int minCodeSize = std::max(2, tableBits);
+			m_Codes.clear();
+			LzwEncode(m_Indices, minCodeSize, m_Codes);
+			bytes.push_back(static_cast<unsigned char>(minCodeSize));
+			for (size_t offset = 0; offset < m_Codes.size(); offset += 255)
+			{
+				const size_t size = std::min(m_Codes.size() - offset, static_cast<size_t>(255));
+				bytes.push_back(static_cast<unsigned char>(size));
+				bytes.insert(bytes.end(), m_Codes.begin() + offset, m_Codes.begin() + offset + size);
+			}
+			bytes.push_back(0);
+			return WriteBytes(m_File, bytes);
+		}
+
+		bool WriteTrailer() override
+		{
+			const bool written = WriteBytes(m_File, { 0x3B });
+			m_File.close();
+			return written && !m_File.fail();
+		}
+
+	private:
+		std::ofstream m_File;
+		std::vector<unsigned int> m_Palette;
+		std::vector<unsigned char> m_Indices;
+		std::vector<unsigned char> m_Codes;
+
+		//Rounded per frame so the delays add up without drifting
+		static unsigned long long Centiseconds(unsigned long long frame)
+		{
+			return (frame * 100 + 30) / 60;
+		}
+
+		unsigned char PaletteIndex(unsigned int rgba)
+		{
+			for (size_t i = 0; i < m_Palette.size(); ++i)
+			{
+				if (m_Palette[i] == rgba)
+					return static_cast<unsigned char>(i);
+			}
+			if (m_Palette.size() < 256)
+			{
+				m_Palette.push_back(rgba);
+				return static_cast<unsigned char>(m_Palette.size() - 1);
+			}
+
+			//Out of palette entries, use the closest color
+			size_t closest = 0;
+			int closestDistance = 0x7FFFFFFF;
+			for (size_t i = 0; i < m_Palette.size(); ++i)
+			{
+				const int r = Red(m_Palette[i]) - Red(rgba);
+				const int g = Green(m_Palette[i]) - Green(rgba);
+				const int b = Blue(m_Palette[i]) - Blue(rgba);
+				const int distance = r * r + g * g + b * b;
+				if (distance < closestDistance)
+				{
+					closest = i;
+					closestDistance = distance;
+				}
+			}
+			return static_cast<unsigned char>(closest);
+		}
+	};
+}
+
+namespace
+{
+	const size_t PNG_SIGNATURE_SIZE = 8;
+	const size_t GIF_HEADER_SIZE = 13 + 19; //screen descriptor and loop extension, there is no global palette
+
+	unsigned int ReadBigEndian(const unsigned char* data)
+	{
+		return (static_cast<unsigned int>(data[0]) << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+	}
+
+	bool ReadFile(const std::string& path, std::vector<unsigned char>& bytes)
+	{
+		std::ifstream file(path, std::ios_base::binary | std::ios_base::ate);
+		if (file.fail())
+			return false;
+
+		bytes.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+		return !file.fail();
+	}
+
+	//Parts are big for Y4M, they are copied through the stream buffers instead of read whole
+	bool AppendY4m(std::ofstream& out, const std::string& part, bool first)
+	{
+		std::ifstream file(part, std::ios_base::binary);
+		std::string header;
+		if (!std::getline(file, header))
+			return false;
+
+		if (first)
+			out << header << '\n';
+		if (file.peek() != std::char_traits<char>::eof())
+			out << file.rdbuf();
+		return !out.fail();
+	}
+
+	bool AppendGif(std::ofstream& out, const std::string& part, bool first)
+	{
+		std::vector<unsigned char> bytes;
+		if (!ReadFile(part, bytes) || bytes.size() < GIF_HEADER_SIZE + 1 || bytes.back() != 0x3B)
+			return false;
+
+		//Frames are self contained blocks, only the header and the trailer are dropped
+		const size_t start = first ? 0 : GIF_HEADER_SIZE;
+		out.write(reinterpret_cast<const char*>(bytes.data() + start), bytes.size() - 1 - start);
+		return !out.fail();
+	}
+
+	//Frame chunks carry a sequence number that runs through the whole file, the first image of a later part becomes frame data
+	bool AppendApng(std::ofstream& out, const std::string& part, bool first, unsigned int& sequence, unsigned int& frameCount)
+	{
+		std::vector<unsigned char> bytes;
+		if (!ReadFile(part, bytes) || bytes.size() < PNG_SIGNATURE_SIZE)
+			return false;
+
+		std::vector<unsigned char> chunks;
+		size_t position = PNG_SIGNATURE_SIZE;
+		if (first)
+			chunks.assign(bytes.begin(), bytes.begin() + PNG_SIGNATURE_SIZE);
+
+		while (position + 12 <= bytes.size())
+		{
+			const size_t size = ReadBigEndian(&bytes[position]);
+			if (bytes.size() - position - 12 < size)
+				return false;
+
+			const std::string type(reinterpret_cast<const char*>(&bytes[position + 4]), 4);
+			const unsigned char* data = &bytes[position + 8];
+			position += 12 + size;
+
+			std::vector<unsigned char> rewritten;
+			std::string rewrittenType = type;
+			if (type == "IHDR" || type == "acTL")
+			{
+				if (!first)
+					continue;
+				rewritten.assign(data, data + size);
+			}
+			else if (type == "fcTL" || type == "fdAT")
+			{
+				if (size < 4)
+					return false;
+				WriteBigEndian(rewritten, sequence++, 4);
+				rewritten.insert(rewritten.end(), data + 4, data + size);
+				frameCount += (type == "fcTL") ? 1 : 0;
+			}
+			else if (type == "IDAT")
+			{
+				if (!first)
+				{
+					rewrittenType = "fdAT";
+					WriteBigEndian(rewritten, sequence++, 4);
+				}
+				rewritten.insert(rewritten.end(), data, data + size);
+			}
+			else
+			{
+				//IEND, written once after the last part
+				continue;
+			}
+
+			WriteBigEndian(chunks, static_cast<unsigned int>(rewritten.size()), 4);
+			const size_t start = chunks.size();
+			chunks.insert(chunks.end(), rewrittenType.begin(), rewrittenType.end());
+			chunks.insert(chunks.end(), rewritten.begin(), rewritten.end());
+			WriteBigEndian(chunks, Crc32(chunks.data() + start, chunks.size() - start), 4);
+		}
+		return WriteBytes(out, chunks);
+	}
+}
+
+bool ConcatenateVideos(const std::vector<std::string>& parts, VideoFormat format, const std::string& path)
+{
+	std::ofstream out(path, std::ios_base::binary);
+	unsigned int sequence = 0;
+	unsigned int frameCount = 0;
+	bool written = !out.fail() && !parts.empty();
+	for (size_t i = 0; written && i < parts.size(); ++i)
+	{
+		const bool first = (i == 0);
+		if (format == VIDEO_Y4M)
+			written = AppendY4m(out, parts[i], first);
+		else if (format == VIDEO_GIF)
+			written = AppendGif(out, parts[i], first);
+		else
+			written = AppendApng(out, parts[i], first, sequence, frameCount);
+	}
+	if (!written)
+		return false;
+
+	if (format == VIDEO_GIF)
+	{
+		out.put(0x3B);
+	}
+	else if (format == VIDEO_APNG)
+	{
+		const std::vector<unsigned char> end = { 0, 0, 0, 0, 'I', 'E', 'N', 'D', 0xAE, 0x42, 0x60, 0x82 };
+		WriteBytes(out, end);
+
+		//The animation control chunk follows the header chunk, its frame count covers all parts now
+		std::vector<unsigned char> control;
+		WriteBigEndian(control, 8, 4);
+		control.insert(control.end(), { 'a', 'c', 'T', 'L' });
+		WriteBigEndian(control, frameCount, 4);
+		WriteBigEndian(control, 0, 4);
+		WriteBigEndian(control, Crc32(control.data() + 4, control.size() - 4), 4);
+		out.seekp(PNG_SIGNATURE_SIZE + 25);
+		WriteBytes(out, control);
+	}
+	out.close();
+	return !out.fail();
+}
+
+bool VideoFormatFromPath(const std::string& path, VideoFormat& format)
+{
+	const size_t dot = path.rfind('.');
+	std::string extension = (dot == std::string::npos) ? "" : path.substr(dot + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+	if (extension == "y4m")
+		format = VIDEO_Y4M;
+	else if (extension == "png" || extension == "apng")
+		format = VIDEO_APNG;
+	else if (extension == "gif")
+		format = VIDEO_GIF;
+	else
+		return false;
+	return true;
+}
+
+std::unique_ptr<VideoWriter> VideoWriter::Create(VideoFormat format, int width, int height, int scale)
+{
+	scale = std::max(1, scale);
+	switch (format)
+	{
+	case VIDEO_Y4M:
+		return std::unique_ptr<VideoWriter>(new Y4mWriter(width, height, scale));
+	case VIDEO_APNG:
+		return std::unique_ptr<VideoWriter>(new ApngWriter(width, height, scale));
+	case VIDEO_GIF:
+		return std::unique_ptr<VideoWriter>(new GifWriter(width, height, scale));
+	}
+	return nullptr;
+}
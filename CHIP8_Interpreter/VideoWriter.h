@@ -0,0 +1,45 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+enum VideoFormat
+{
+	VIDEO_Y4M,
+	VIDEO_APNG,
+	VIDEO_GIF
+};
+
+//Picks the format from the extension: .y4m, .png/.apng or .gif
+bool VideoFormatFromPath(const std::string& path, VideoFormat& format);
+
+//Joins videos of the same format and size written by VideoWriter into one at path, in order. Each part starts with a full frame
+bool ConcatenateVideos(const std::vector<std::string>& parts, VideoFormat format, const std::string& path);
+
+/* Writes 60hz frames of RGBA pixels (0xRRGGBBAA, like the interpreter's screen) upscaled by an integer factor.
+Frame numbers may skip, the skipped frames keep showing the previous one.
+Y4M: uncompressed 4:4:4 video, every frame is written.
+APNG: 24 bit PNG frames compressed with Deflate.h, only the rectangle that changed is stored and unchanged frames extend the delay.
+GIF: like APNG but LZW coded with a local palette per frame. GIF delays are in 1/100s and players don't show frames shorter than 2/100s,
+so a frame that is followed by a change within 2/100s is skipped.*/
+class VideoWriter
+{
+public:
+	virtual ~VideoWriter() {}
+
+	static std::unique_ptr<VideoWriter> Create(VideoFormat format, int width, int height, int scale);
+
+	virtual bool Open(const std::string& path) = 0;
+	virtual bool AddFrame(const unsigned int* pixels, unsigned long long frame) = 0;
+
+	//Writes what is still pending and closes the file, the last frame is shown until frameCount
+	virtual bool Finish(unsigned long long frameCount) = 0;
+
+protected:
+	VideoWriter(int width, int height, int scale) : m_Width(width), m_Height(height), m_Scale(scale) {}
+
+	int m_Width;
+	int m_Height;
+	int m_Scale;
+};
@@ -3,25 +3,48 @@
 // GLFW
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <string>
-#include <time.h> //srand
+#include <time.h> //default seed
+#include <chrono>
 #include <map>
 
 #include "Interpreter.h"
+#include "CallProfiler.h"
+#include "CycleDetector.h"
+#include "Debugger.h"
+#include "FrameStreamServer.h"
+#include "HostProfiler.h"
+#include "InputMovie.h"
+#include "MegaChipInterpreter.h"
+#include "NetplaySession.h"
+#include "OpcodeProfiler.h"
+#include "RewindBuffer.h"
+#include "RomArchive.h"
+#include "RomDatabase.h"
+#include "RomHash.h"
+#include "Socket.h"
+#include "TimeTravel.h"
+#include "VideoRecorder.h"
 
 //Forward declaration
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mode);
 GLuint LoadShaderFromFile(const std::string & filePath, GLenum shaderType);
 unsigned int RgbaToU32(unsigned char r, unsigned char g, unsigned char b, unsigned char a);
 void InitialiseKeyMapping(std::map<int, unsigned short>& keyMap);
+void InitialiseKeyMapping(std::map<int, unsigned short>& keyMap, const std::string& keys);
 void SetInput(GLFWwindow* window);
 
 // Window dimensions
 const GLuint WIDTH = 1024, HEIGHT = 512;
 
+// Run-ahead simulates this many extra frames per host frame at most
+const int MAX_RUN_AHEAD = 8;
+
 GLFWwindow* OpenGLInit(const std::string& windowName)
 {
 	// Init GLFW
@@ -125,11 +148,10 @@ GLFWwindow* OpenGLInit(const std::string& windowName)
 	return window;
 }
 
-void Draw(GLFWwindow* window, Interpreter& interpreter)
-{
-	//Get the texture from the interpreter
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 64, 32, 0, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8, reinterpret_cast<GLvoid*>(interpreter.GetScreen()));
+bool m_MegaTextureAllocated = false;
 
+void Present(GLFWwindow* window)
+{
 	// Clear the screen to white
 	glClearColor(1, 1, 1, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT);
@@ -138,42 +160,514 @@ void Draw(GLFWwindow* window, Interpreter& interpreter)
 	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 
 	// Swap the screen buffers
+	CHIP8_ZONE(ZONE_SWAP);
 	glfwSwapBuffers(window);
 }
 
+void Draw(GLFWwindow* window, Interpreter& interpreter)
+{
+	//Get the texture from the interpreter
+	{
+		CHIP8_ZONE(ZONE_UPLOAD);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 64, 32, 0, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8, reinterpret_cast<GLvoid*>(interpreter.GetScreen()));
+	}
+	m_MegaTextureAllocated = false;
+
+	Present(window);
+}
+
+void DrawMegaChip(GLFWwindow* window, MegaChipInterpreter& interpreter)
+{
+	const int width = MegaChipInterpreter::MEGA_WIDTH;
+	const int height = MegaChipInterpreter::MEGA_HEIGHT;
+
+	//The megachip texture is allocated once, after that only the changed part of the frame is uploaded
+	{
+		CHIP8_ZONE(ZONE_UPLOAD);
+		if (!m_MegaTextureAllocated)
+		{
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8, reinterpret_cast<GLvoid*>(interpreter.GetMegaScreen()));
+			m_MegaTextureAllocated = true;
+		}
+		else
+		{
+			const MegaChipInterpreter::DirtyRegion& dirty = interpreter.GetDirtyRegion();
+			if (!dirty.IsEmpty())
+			{
+				glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+				glTexSubImage2D(GL_TEXTURE_2D, 0, dirty.left, dirty.top, dirty.right - dirty.left, dirty.bottom - dirty.top,
+					GL_RGBA, GL_UNSIGNED_INT_8_8_8_8, reinterpret_cast<GLvoid*>(interpreter.GetMegaScreen() + dirty.top * width + dirty.left));
+				glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+			}
+		}
+	}
+	interpreter.ClearDirtyRegion();
+
+	//The screen alpha of 05NN blends the whole frame over the background
+	glEnable(GL_BLEND);
+	glBlendColor(0.0f, 0.0f, 0.0f, interpreter.GetScreenAlpha() / 255.0f);
+	glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+	Present(window);
+	glDisable(GL_BLEND);
+}
+
+// Sets the watchpoints of --watch and --watch-read, each address is watched for the accesses given
+void SetWatchpoints(Interpreter& interpreter, const std::vector<std::pair<unsigned short, int>>& watchpoints)
+{
+	for (const std::pair<unsigned short, int>& watchpoint : watchpoints)
+		interpreter.SetWatchpoint(watchpoint.first, interpreter.GetWatchpoint(watchpoint.first) | watchpoint.second);
+}
+
+// Replays a movie without a window as fast as possible, the state hash at the end identifies the run.
+// Watchpoint hits are printed with their cycle and the playback continues, to find what touches an address in a long run.
+// After the last input an attract loop is skipped by whole periods to the end, which leaves the same final state
+int PlayHeadless(const std::string& moviePath, const std::vector<std::pair<unsigned short, int>>& watchpoints)
+{
+	InputMovie movie;
+	Interpreter interpreter;
+	interpreter.Initialize();
+	interpreter.SetFastForward(true);
+	if (!movie.Load(moviePath) || !movie.StartPlayback(interpreter))
+		return 1;
+	SetWatchpoints(interpreter, watchpoints);
+	interpreter.SetStateHashing(watchpoints.empty());
+
+	CycleDetector detector;
+	unsigned long long skippedFrames = 0;
+
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	const unsigned long long startCycle = interpreter.GetCycleCount();
+	while (!movie.IsFinished(interpreter))
+	{
+		movie.Play(interpreter);
+		bool running = interpreter.RunFrame();
+		for (; running && interpreter.IsAtWatchpoint(); running = running && interpreter.RunFrame())
+		{
+			std::cout << "Cycle " << interpreter.GetCycleCount() << ": ";
+			Debugger::PrintWatchHit(std::cout, interpreter);
+
+			// A hit on the last instruction of a frame doesn't interrupt it
+			if (interpreter.GetFrameCycle() == 0)
+				break;
+		}
+		if (!running)
+			break;
+
+		if (watchpoints.empty() && movie.IsInputFinished() && !movie.IsFinished(interpreter) && detector.Observe(interpreter))
+		{
+			const unsigned long long instructionsPerFrame = interpreter.GetInstructionsPerFrame();
+			skippedFrames += detector.Skip(interpreter, (movie.GetEndCycle() - interpreter.GetCycleCount() + instructionsPerFrame - 1) / instructionsPerFrame);
+		}
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::vector<unsigned char> state;
+	interpreter.SaveState(state);
+	const unsigned long long cycles = interpreter.GetCycleCount() - startCycle;
+	std::cout << "Played " << cycles << " cycles in " << seconds << "s (" << (seconds > 0.0 ? cycles / seconds / 1e6 : 0.0) << " MIPS), state crc "
+		<< std::hex << Crc32(state.data(), state.size()) << std::dec << std::endl;
+	if (skippedFrames > 0)
+		std::cout << "Skipped " << skippedFrames << " frames of an attract loop of " << detector.GetPeriod() << " frames" << std::endl;
+	return 0;
+}
+
 std::map<int, unsigned short> m_KeyMap = std::map<int, unsigned short>();
 Interpreter* m_Interpreter = nullptr;
-int main()
+bool m_PauseRequested = false;
+int main(int argc, char* argv[])
 {
-	srand(static_cast<unsigned int>(time(0))); //seed rand
-	rand(); rand(); rand();
+	// Usage: CHIP8_Interpreter [--megachip] [--scan directory] [--pack directory archive] [--archive archive] [--profile prefix] [--zones prefix]
+	//	[--seed n] [--record movie] [--play movie] [--headless] [--runahead frames]
+	//	[--netplay port host:port] [--latency frames] [--loss percent] [--stream port] [--stream-unix path]
+	//	[--video file.y4m|.png|.gif] [--video-scale n] [--debug] [--break address] [--watch address] [--watch-read address] [rom path or archive entry]
+	std::string romPath = "./Resources/15PUZZLE";
+	std::string scanDirectory;
+	std::string archivePath;
+	std::string profilePrefix;
+	std::string zonesPrefix;
+	std::string recordPath;
+	std::string playPath;
+	unsigned long long seed = static_cast<unsigned long long>(time(0));
+	int runAhead = 0;
+	unsigned short netplayPort = 0;
+	std::string netplayPeer;
+	int netplayLatency = 0;
+	double netplayLoss = 0.0;
+	int streamPort = -1;
+	std::string streamUnixPath;
+	std::string videoPath;
+	int videoScale = 8;
+	std::vector<unsigned short> breakpoints;
+	std::vector<std::pair<unsigned short, int>> watchpoints;
+	bool headless = false;
+	bool megaChip = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		if (arg == "--megachip")
+			megaChip = true;
+		else if (arg == "--scan" && i + 1 < argc)
+			scanDirectory = argv[++i];
+		else if (arg == "--pack" && i + 2 < argc)
+			return RomArchive::Build(argv[i + 1], argv[i + 2]) ? 0 : 1;
+		else if (arg == "--archive" && i + 1 < argc)
+			archivePath = argv[++i];
+		else if (arg == "--profile" && i + 1 < argc)
+			profilePrefix = argv[++i];
+		else if (arg == "--zones" && i + 1 < argc)
+			zonesPrefix = argv[++i];
+		else if (arg == "--seed" && i + 1 < argc)
+			seed = std::strtoull(argv[++i], nullptr, 10);
+		else if (arg == "--record" && i + 1 < argc)
+			recordPath = argv[++i];
+		else if (arg == "--play" && i + 1 < argc)
+			playPath = argv[++i];
+		else if (arg == "--headless")
+			headless = true;
+		else if (arg == "--runahead" && i + 1 < argc)
+			runAhead = std::max(0, std::min(MAX_RUN_AHEAD, std::atoi(argv[++i])));
+		else if (arg == "--netplay" && i + 2 < argc)
+		{
+			netplayPort = static_cast<unsigned short>(std::atoi(argv[++i]));
+			netplayPeer = argv[++i];
+		}
+		else if (arg == "--latency" && i + 1 < argc)
+			netplayLatency = std::atoi(argv[++i]);
+		else if (arg == "--loss" && i + 1 < argc)
+			netplayLoss = std::atof(argv[++i]) / 100.0;
+		else if (arg == "--stream" && i + 1 < argc)
+			streamPort = std::atoi(argv[++i]);
+		else if (arg == "--stream-unix" && i + 1 < argc)
+			streamUnixPath = argv[++i];
+		else if (arg == "--video" && i + 1 < argc)
+			videoPath = argv[++i];
+		else if (arg == "--video-scale" && i + 1 < argc)
+			videoScale = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--debug")
+			m_PauseRequested = true;
+		else if (arg == "--break" && i + 1 < argc)
+			breakpoints.push_back(static_cast<unsigned short>(std::strtoul(argv[++i], nullptr, 16)));
+		else if (arg == "--watch" && i + 1 < argc)
+			watchpoints.emplace_back(static_cast<unsigned short>(std::strtoul(argv[++i], nullptr, 16)), Interpreter::WATCH_WRITE);
+		else if (arg == "--watch-read" && i + 1 < argc)
+			watchpoints.emplace_back(static_cast<unsigned short>(std::strtoul(argv[++i], nullptr, 16)), Interpreter::WATCH_READ);
+		else
+			romPath = arg;
+	}
+
+	if (headless)
+	{
+		if (playPath.empty())
+		{
+			std::cout << "--headless needs --play" << std::endl;
+			return 1;
+		}
+		return PlayHeadless(playPath, watchpoints);
+	}
+
+	RomDatabase romDatabase;
+	romDatabase.Load("./Resources/romdb.txt");
+
+	// Identify every rom in a directory and exit, the hashes are cached next to the database
+	if (!scanDirectory.empty())
+	{
+		for (const RomScanEntry& entry : romDatabase.ScanDirectory(scanDirectory, "./Resources/romdb.cache"))
+			std::cout << entry.path << ": " << ((entry.profile != nullptr) ? entry.profile->name : "unknown") << std::endl;
+		return 0;
+	}
 
 	GLFWwindow* window = OpenGLInit("CHIP8_Interpreter by Julian Declercq");
 
-	m_Interpreter = new Interpreter();
+	MegaChipInterpreter* megaChipInterpreter = nullptr;
+	if (megaChip)
+		m_Interpreter = megaChipInterpreter = new MegaChipInterpreter();
+	else
+		m_Interpreter = new Interpreter();
+
+	m_Interpreter->SetSeed(seed);
 	m_Interpreter->Initialize();
-	m_Interpreter->LoadRom("./Resources/15PUZZLE");
 
-	InitialiseKeyMapping(m_KeyMap);
+	// Roms in an archive are looked up by name, the archive stays mapped for the lifetime of the program
+	RomArchive romArchive;
+	const RomProfile* profile = nullptr;
+	if (!archivePath.empty())
+	{
+		const RomArchive::Entry* entry = romArchive.Open(archivePath) ? romArchive.Find(romPath) : nullptr;
+		if (entry == nullptr)
+		{
+			std::cout << "Rom " << romPath << " not found in archive " << archivePath << std::endl;
+			glfwTerminate();
+			return 1;
+		}
+
+		m_Interpreter->LoadRom(romArchive.GetData(*entry), entry->dataSize);
+		profile = romDatabase.Identify(romArchive.GetData(*entry), entry->dataSize);
+	}
+	else
+	{
+		m_Interpreter->LoadRom(romPath);
+		profile = romDatabase.IdentifyFile(romPath);
+	}
+
+	// Known roms get their quirks, speed, colors and keys from the database
+	if (profile != nullptr)
+	{
+		std::cout << "Identified rom " << profile->name << std::endl;
+		profile->Apply(*m_Interpreter);
+		InitialiseKeyMapping(m_KeyMap, profile->keys);
+	}
+	else
+	{
+		InitialiseKeyMapping(m_KeyMap);
+	}
+
+	// Opcode histogram, hot address heatmap and guest call graph, only recorded in CHIP8_PROFILE builds
+	OpcodeProfiler* opcodeProfiler = nullptr;
+	CallProfiler* callProfiler = nullptr;
+#ifdef CHIP8_PROFILE
+	if (!profilePrefix.empty())
+	{
+		opcodeProfiler = new OpcodeProfiler();
+		callProfiler = new CallProfiler();
+		m_Interpreter->SetOpcodeProfiler(opcodeProfiler);
+		m_Interpreter->SetCallProfiler(callProfiler);
+	}
+#else
+	if (!profilePrefix.empty())
+		std::cout << "--profile needs a build with CHIP8_PROFILE defined" << std::endl;
+#endif
+
+	// Host side time per frame phase, only recorded in CHIP8_HOST_ZONES builds
+#ifndef CHIP8_HOST_ZONES
+	if (!zonesPrefix.empty())
+		std::cout << "--zones needs a build with CHIP8_HOST_ZONES defined" << std::endl;
+#endif
+
+	// A played movie replaces the rom's start state and the keyboard until it ends, a recorded one starts here.
+	// Save states don't cover the MEGA-CHIP extensions, so neither do movies
+	InputMovie movie;
+	bool playing = false;
+	if ((megaChip || !netplayPeer.empty()) && (!playPath.empty() || !recordPath.empty()))
+	{
+		std::cout << "Movies are not supported with --megachip or --netplay" << std::endl;
+		playPath.clear();
+		recordPath.clear();
+	}
+	if (!playPath.empty())
+		playing = movie.Load(playPath) && movie.StartPlayback(*m_Interpreter);
+	else if (!recordPath.empty())
+		movie.StartRecording(*m_Interpreter);
+
+	// Holding backspace steps back one frame at a time, the snapshots don't cover the MEGA-CHIP extensions.
+	// Rewinding would break the cycle stamps of a movie
+	RewindBuffer rewindBuffer;
+
+	// Run-ahead shows the frame runAhead frames in the future under the current input and then returns to the real one,
+	// which hides the frames games take to react to a key press
+	Interpreter::Snapshot runAheadSnapshot;
+	if (runAhead > 0 && megaChipInterpreter != nullptr)
+	{
+		std::cout << "--runahead is not supported with --megachip" << std::endl;
+		runAhead = 0;
+	}
+
+	const bool rewindEnabled = (megaChipInterpreter == nullptr) && playPath.empty() && recordPath.empty() && netplayPeer.empty();
+
+	// Spectators get the 64x32 display, the MEGA-CHIP mega mode screen isn't streamed
+	FrameStreamServer streamServer;
+	if ((streamPort >= 0 && !streamServer.OpenTcp(static_cast<unsigned short>(streamPort)))
+		|| (!streamUnixPath.empty() && !streamServer.OpenUnix(streamUnixPath)))
+	{
+		glfwTerminate();
+		return 1;
+	}
+
+	// Every emulated frame goes to the video, encoded on a background thread. Like the stream it is the 64x32 display
+	VideoRecorder videoRecorder;
+	VideoFormat videoFormat;
+	if (!videoPath.empty() && (!VideoFormatFromPath(videoPath, videoFormat) || !videoRecorder.Start(videoPath, videoFormat, videoScale)))
+	{
+		std::cout << "Failed to record video to " << videoPath << " (use .y4m, .png or .gif)" << std::endl;
+		glfwTerminate();
+		return 1;
+	}
+
+	// Netplay runs every frame through the session, both peers need the same rom and --seed.
+	// Both keypads are combined, so each player uses the keys of their side of the game
+	UdpSocket netplaySocket;
+	NetplaySession* netplay = nullptr;
+	if (!netplayPeer.empty())
+	{
+		const size_t colon = netplayPeer.rfind(':');
+		if (megaChipInterpreter != nullptr || colon == std::string::npos || !netplaySocket.Open(netplayPort)
+			|| !netplaySocket.SetPeer(netplayPeer.substr(0, colon), static_cast<unsigned short>(std::atoi(netplayPeer.c_str() + colon + 1))))
+		{
+			std::cout << "Failed to start netplay with " << netplayPeer << " (not supported with --megachip)" << std::endl;
+			glfwTerminate();
+			return 1;
+		}
+
+		netplay = new NetplaySession(*m_Interpreter, netplaySocket);
+		netplay->SetSimulatedConditions(netplayLatency, netplayLoss, static_cast<unsigned int>(seed));
+	}
+
+	// F12, a breakpoint or a watchpoint pauses into the console debugger. Netplay has to run whole frames to stay in sync with the peer
+	Debugger debugger(*m_Interpreter);
+	if (netplay != nullptr && (m_PauseRequested || !breakpoints.empty() || !watchpoints.empty()))
+	{
+		std::cout << "The debugger is not supported with --netplay" << std::endl;
+		m_PauseRequested = false;
+		breakpoints.clear();
+		watchpoints.clear();
+	}
+	for (unsigned short address : breakpoints)
+		m_Interpreter->SetBreakpoint(address, true);
+	SetWatchpoints(*m_Interpreter, watchpoints);
+
+	// The debugger goes back in time by replaying from checkpoints, which needs every frame to run through the plain interpreter
+	TimeTravel timeTravel;
+	const bool timeTravelEnabled = (megaChipInterpreter == nullptr) && (netplay == nullptr);
+	if (timeTravelEnabled)
+		debugger.SetTimeTravel(&timeTravel);
 
 	// Game loop
 	while (!glfwWindowShouldClose(window))
 	{
+		CHIP8_FRAME_BEGIN();
+
 		// Check if any events have been activated (key pressed, mouse moved etc.) and call corresponding response functions
-		glfwPollEvents();
+		{
+			CHIP8_ZONE(ZONE_EVENTS);
+			glfwPollEvents();
+		}
 
-		// Every cycle you should check the key input state and store it in the interpreters keypad.
-		SetInput(window);
+		// Every frame you should check the key input state and store it in the interpreters keypad.
+		{
+			CHIP8_ZONE(ZONE_INPUT);
+			SetInput(window);
+
+			if (playing && movie.IsFinished(*m_Interpreter))
+				playing = false;
+			if (playing)
+				movie.Play(*m_Interpreter);
+			else if (!recordPath.empty())
+				movie.Record(*m_Interpreter);
+
+			if (timeTravelEnabled)
+				timeTravel.Record(*m_Interpreter);
+		}
 
-		// Cycle the interpreter
-		if (!m_Interpreter->Cycle())
+		// Run one frame of the interpreter, or restore the previous one while rewinding
+		bool running = true;
+		{
+			CHIP8_ZONE(ZONE_CYCLE);
+			if (netplay != nullptr)
+			{
+				netplay->AdvanceFrame(m_Interpreter->m_Keypad);
+				running = !netplay->IsHalted();
+			}
+			else if (!rewindEnabled || glfwGetKey(window, GLFW_KEY_BACKSPACE) != GLFW_PRESS)
+			{
+				if (rewindEnabled)
+					rewindBuffer.Push(*m_Interpreter);
+				running = m_Interpreter->RunFrame();
+			}
+			else
+			{
+				rewindBuffer.Rewind(*m_Interpreter);
+			}
+		}
+		if (!running)
 			break;
 
-		if (m_Interpreter->m_DrawFlag)
+		if (netplay == nullptr && (m_PauseRequested || m_Interpreter->IsAtBreakpoint() || m_Interpreter->IsAtWatchpoint()))
+		{
+			m_PauseRequested = false;
+			if (!debugger.Prompt(std::cin, std::cout))
+				break;
+		}
+
+		if (streamServer.IsOpen())
+			streamServer.Update(*m_Interpreter);
+		if (videoRecorder.IsRecording())
+			videoRecorder.Capture(m_Interpreter->GetScreen());
+
+		// Presenting every frame keeps the loop at the swap interval (60hz) even when nothing was drawn.
+		// Speculative frames would stop at breakpoints and watchpoints, so run-ahead is off while any are set.
+		// The profilers are detached during them, they would count every frame again and keep the calls of frames that are thrown away
+		if (runAhead > 0 && m_Interpreter->GetBreakpointCount() == 0 && m_Interpreter->GetWatchpointCount() == 0)
+		{
+			{
+				CHIP8_ZONE(ZONE_RUNAHEAD);
+				m_Interpreter->SaveSnapshot(runAheadSnapshot);
+				m_Interpreter->SetSoundEnabled(false);
+				m_Interpreter->SetOpcodeProfiler(nullptr);
+				m_Interpreter->SetCallProfiler(nullptr);
+				for (int i = 0; i < runAhead && m_Interpreter->RunFrame(); ++i)
+				{
+				}
+			}
+
+			// The future frame can differ from the shown one even when the real frame drew nothing
+			Draw(window, *m_Interpreter);
+			m_Interpreter->LoadSnapshot(runAheadSnapshot);
+			m_Interpreter->SetSoundEnabled(true);
+			m_Interpreter->SetOpcodeProfiler(opcodeProfiler);
+			m_Interpreter->SetCallProfiler(callProfiler);
+		}
+		else if (!m_Interpreter->m_DrawFlag)
+			Present(window);
+		else if (megaChipInterpreter != nullptr && megaChipInterpreter->IsMegaMode())
+			DrawMegaChip(window, *megaChipInterpreter);
+		else
 			Draw(window, *m_Interpreter);
 
-		// First clear the previous cycle's key information
+		// First clear the previous frame's key information
 		m_Interpreter->m_Keypad = 0;
+
+		CHIP8_FRAME_END();
+	}
+
+#ifdef CHIP8_HOST_ZONES
+	if (!zonesPrefix.empty())
+	{
+		std::ofstream csv(zonesPrefix + "_zones.csv");
+		HostProfiler::Get().WriteCsv(csv);
+		std::ofstream trace(zonesPrefix + "_zones.json");
+		HostProfiler::Get().WriteChromeTrace(trace);
+	}
+#endif
+
+	videoRecorder.Stop();
+
+	if (netplay != nullptr)
+	{
+		if (netplay->GetDesyncFrame() != -1)
+			std::cout << "Netplay desynced at frame " << netplay->GetDesyncFrame() << std::endl;
+		delete netplay;
+	}
+
+	if (!recordPath.empty() && playPath.empty())
+	{
+		movie.StopRecording(*m_Interpreter);
+		movie.Save(recordPath);
+	}
+
+	if (opcodeProfiler != nullptr)
+	{
+		std::ofstream report(profilePrefix + "_opcodes.txt");
+		opcodeProfiler->WriteReport(report);
+		opcodeProfiler->WriteHeatmap(profilePrefix + "_heatmap.ppm");
+		delete opcodeProfiler;
+	}
+
+	if (callProfiler != nullptr)
+	{
+		std::ofstream folded(profilePrefix + "_calls.folded");
+		callProfiler->WriteFolded(folded);
+		std::ofstream summary(profilePrefix + "_calls.txt");
+		callProfiler->WriteSummary(summary);
+		delete callProfiler;
 	}
 
 	// Terminates GLFW, clearing any resources allocated by GLFW.
@@ -191,6 +685,8 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 	std::cout << "Key pressed: " << key << std::endl;
 	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, GL_TRUE);
+	if (key == GLFW_KEY_F12 && action == GLFW_PRESS)
+		m_PauseRequested = true;
 }
 
 void InitialiseKeyMapping(std::map<int, unsigned short>& keyMap)
@@ -215,6 +711,14 @@ void InitialiseKeyMapping(std::map<int, unsigned short>& keyMap)
 	};
 }
 
+void InitialiseKeyMapping(std::map<int, unsigned short>& keyMap, const std::string& keys)
+{
+	// keys holds the host key for CHIP-8 keys 0 to F, GLFW key codes of letters and digits are their uppercase characters
+	keyMap.clear();
+	for (unsigned short i = 0; i < 16 && i < keys.size(); ++i)
+		keyMap[static_cast<unsigned char>(::toupper(keys[i]))] = i;
+}
+
 void SetInput(GLFWwindow* window)
 {
 	// Check state for all keybinds and update the interpreter
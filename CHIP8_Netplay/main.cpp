@@ -0,0 +1,144 @@
+// Runs both sides of a rollback netplay session in one process over loopback udp, with simulated latency and packet loss.
+// Build together with the interpreter sources of CHIP8_Interpreter (everything except its main.cpp), no OpenGL needed.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../CHIP8_Interpreter/Interpreter.h"
+#include "../CHIP8_Interpreter/NetplaySession.h"
+#include "../CHIP8_Interpreter/RomDatabase.h"
+#include "../CHIP8_Interpreter/Socket.h"
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options
+{
+	std::string romPath = "../CHIP8_Interpreter/Resources/PONG2";
+	int frames = 3600;
+	int latency = 3; // host frames per direction
+	double loss = 0.05;
+	unsigned int seed = 1;
+};
+
+// Each player holds one of their two keys for a while, player 1 on keys 1/4 and player 2 on C/D like in PONG
+unsigned short ScriptedKeypad(int player, int frame)
+{
+	const unsigned int segment = static_cast<unsigned int>(frame / 12 + player * 7);
+	const unsigned int choice = ((segment * 1103515245u + 12345u) >> 16) % 3;
+	if (choice == 2)
+		return 0;
+
+	const unsigned short keys[2][2] = { { 1 << 0x1, 1 << 0x4 }, { 1 << 0xC, 1 << 0xD } };
+	return keys[player][choice];
+}
+
+bool ReadFile(const std::string& path, std::vector<unsigned char>& bytes)
+{
+	std::ifstream file(path, std::ios_base::binary | std::ios_base::ate);
+	if (file.fail())
+		return false;
+
+	bytes.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+	return !file.fail();
+}
+
+int main(int argc, char* argv[])
+{
+	// Usage: CHIP8_Netplay [--rom path] [--frames n] [--latency frames] [--loss percent] [--seed n]
+	Options options;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		const std::string arg = argv[i];
+		if (arg == "--rom")
+			options.romPath = argv[i + 1];
+		else if (arg == "--frames")
+			options.frames = std::atoi(argv[i + 1]);
+		else if (arg == "--latency")
+			options.latency = std::atoi(argv[i + 1]);
+		else if (arg == "--loss")
+			options.loss = std::atof(argv[i + 1]) / 100.0;
+		else if (arg == "--seed")
+			options.seed = static_cast<unsigned int>(std::atoi(argv[i + 1]));
+		else
+			std::cerr << "Unknown option " << arg << std::endl;
+	}
+
+	std::vector<unsigned char> rom;
+	if (!ReadFile(options.romPath, rom))
+	{
+		std::cerr << "Failed to read " << options.romPath << std::endl;
+		return 1;
+	}
+
+	RomDatabase romDatabase;
+	romDatabase.Load("../CHIP8_Interpreter/Resources/romdb.txt");
+	const RomProfile* profile = romDatabase.Identify(rom.data(), rom.size());
+
+	UdpSocket sockets[2];
+	if (!sockets[0].Open(0) || !sockets[1].Open(0))
+		return 1;
+	sockets[0].SetPeer("127.0.0.1", sockets[1].GetLocalPort());
+	sockets[1].SetPeer("127.0.0.1", sockets[0].GetLocalPort());
+
+	// Both sides start from the same seed, like two peers that agreed on it before starting
+	Interpreter interpreters[2];
+	std::vector<NetplaySession*> sessions;
+	for (int player = 0; player < 2; ++player)
+	{
+		interpreters[player].SetSeed(options.seed);
+		interpreters[player].Initialize();
+		if (profile != nullptr)
+			profile->Apply(interpreters[player]);
+		interpreters[player].SetSoundEnabled(false);
+		interpreters[player].LoadRom(rom.data(), rom.size());
+
+		sessions.push_back(new NetplaySession(interpreters[player], sockets[player]));
+		sessions.back()->SetSimulatedConditions(options.latency, options.loss, options.seed * 2 + player);
+	}
+
+	// Both peers tick in lock step like two hosts at 60hz, each one only advances its own frame counter when it isn't stalled.
+	// Input goes through the interpreter's keypad like in the frontend: set before the frame and cleared after it
+	int localFrames[2] = { 0, 0 };
+	double maxAdvanceUs = 0.0;
+	int hostFrames = 0;
+	while (std::min(localFrames[0], localFrames[1]) < options.frames && hostFrames < options.frames * 4)
+	{
+		for (int player = 0; player < 2; ++player)
+		{
+			interpreters[player].m_Keypad |= ScriptedKeypad(player, localFrames[player]);
+
+			const Clock::time_point start = Clock::now();
+			if (sessions[player]->AdvanceFrame(interpreters[player].m_Keypad))
+				++localFrames[player];
+			maxAdvanceUs = std::max(maxAdvanceUs, std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+
+			interpreters[player].m_Keypad = 0;
+		}
+		++hostFrames;
+	}
+
+	bool inSync = true;
+	for (int player = 0; player < 2; ++player)
+	{
+		const NetplaySession& session = *sessions[player];
+		std::cout << "Player " << player + 1 << ": frame " << session.GetFrame() << ", confirmed " << session.GetConfirmedFrame()
+			<< ", rollbacks " << session.GetRollbackCount() << " (" << session.GetResimulatedFrames() << " frames, longest " << session.GetMaxRollback() << ")"
+			<< ", stalls " << session.GetStallCount() << ", digests compared " << session.GetDigestsCompared();
+		if (session.GetDesyncFrame() != -1)
+			std::cout << ", DESYNC at frame " << session.GetDesyncFrame();
+		std::cout << std::endl;
+
+		inSync &= session.GetDesyncFrame() == -1 && session.GetDigestsCompared() > 0;
+		delete sessions[player];
+	}
+	std::cout << "Slowest host frame: " << maxAdvanceUs << " us" << std::endl;
+
+	return inSync ? 0 : 1;
+}
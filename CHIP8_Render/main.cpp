@@ -0,0 +1,171 @@
+// Renders an input movie to video as fast as the machine allows. The movie is cut into segments at its keyframes,
+// every segment is simulated from its keyframe and encoded to a part file on its own thread, then the parts are joined.
+// Build together with the interpreter sources of CHIP8_Interpreter (everything except its main.cpp), no OpenGL needed.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../CHIP8_Interpreter/InputMovie.h"
+#include "../CHIP8_Interpreter/Interpreter.h"
+#include "../CHIP8_Interpreter/VideoWriter.h"
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options
+{
+	std::string moviePath;
+	std::string outPath;
+	int scale = 8;
+	int threads = 0; // 0 uses every hardware thread
+};
+
+// Movie cycles [startCycle, endCycle), starting at a keyframe
+struct Segment
+{
+	unsigned long long startCycle;
+	unsigned long long endCycle;
+	std::string partPath;
+	unsigned long long frames = 0;
+	bool rendered = false;
+};
+
+bool ParseArguments(int argc, char* argv[], Options& options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		if (arg == "--movie" && i + 1 < argc)
+			options.moviePath = argv[++i];
+		else if (arg == "--out" && i + 1 < argc)
+			options.outPath = argv[++i];
+		else if (arg == "--scale" && i + 1 < argc)
+			options.scale = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--threads" && i + 1 < argc)
+			options.threads = std::max(0, std::atoi(argv[++i]));
+		else
+			return false;
+	}
+	return !options.moviePath.empty() && !options.outPath.empty();
+}
+
+// A few segments per thread keeps every core busy when some segments take longer, merging keyframes keeps the part count low
+std::vector<Segment> SplitAtKeyframes(const InputMovie& movie, int threads, const std::string& outPath)
+{
+	const unsigned long long startCycle = movie.GetKeyframeCycle(0);
+	const unsigned long long endCycle = movie.GetEndCycle();
+	const unsigned long long targetCycles = std::max(1ull, (endCycle - startCycle) / (static_cast<unsigned long long>(threads) * 4));
+
+	std::vector<Segment> segments;
+	for (size_t i = 0; i < movie.GetKeyframeCount(); ++i)
+	{
+		const unsigned long long cycle = movie.GetKeyframeCycle(i);
+		if (cycle >= endCycle)
+			break;
+
+		if (segments.empty() || cycle - segments.back().startCycle >= targetCycles)
+		{
+			if (!segments.empty())
+				segments.back().endCycle = cycle;
+
+			Segment segment;
+			segment.startCycle = cycle;
+			segment.endCycle = endCycle;
+			segment.partPath = outPath + ".part" + std::to_string(segments.size());
+			segments.push_back(segment);
+		}
+	}
+	return segments;
+}
+
+// Runs the segment exactly like a sequential playback would run those frames
+void RenderSegment(const InputMovie& movie, VideoFormat format, int scale, Segment& segment)
+{
+	Interpreter interpreter;
+	interpreter.Initialize();
+	interpreter.SetSoundEnabled(false);
+	interpreter.SetFastForward(true);
+
+	InputMovie::Cursor cursor;
+	std::unique_ptr<VideoWriter> writer = VideoWriter::Create(format, 64, 32, scale);
+	if (!movie.Seek(interpreter, segment.startCycle, cursor) || !writer->Open(segment.partPath))
+		return;
+
+	bool written = true;
+	while (written && interpreter.GetCycleCount() < segment.endCycle)
+	{
+		movie.Play(interpreter, cursor);
+		if (!interpreter.RunFrame())
+			break;
+
+		written = writer->AddFrame(interpreter.GetScreen(), segment.frames++);
+	}
+	segment.rendered = writer->Finish(segment.frames) && written;
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	VideoFormat format;
+	if (!ParseArguments(argc, argv, options) || !VideoFormatFromPath(options.outPath, format))
+	{
+		std::cout << "Usage: CHIP8_Render --movie movie --out file.y4m|.png|.gif [--scale n] [--threads n]" << std::endl;
+		return 1;
+	}
+
+	InputMovie movie;
+	if (!movie.Load(options.moviePath))
+		return 1;
+
+	const int threads = (options.threads > 0) ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+	std::vector<Segment> segments = SplitAtKeyframes(movie, threads, options.outPath);
+
+	const Clock::time_point start = Clock::now();
+	std::atomic<size_t> nextSegment(0);
+	std::vector<std::thread> workers;
+	for (int i = 0; i < std::min(threads, static_cast<int>(segments.size())); ++i)
+	{
+		workers.emplace_back([&]()
+		{
+			for (size_t index = nextSegment++; index < segments.size(); index = nextSegment++)
+				RenderSegment(movie, format, options.scale, segments[index]);
+		});
+	}
+	for (std::thread& worker : workers)
+		worker.join();
+	const Clock::time_point rendered = Clock::now();
+
+	std::vector<std::string> parts;
+	unsigned long long frames = 0;
+	bool complete = !segments.empty();
+	for (const Segment& segment : segments)
+	{
+		parts.push_back(segment.partPath);
+		frames += segment.frames;
+		complete = complete && segment.rendered;
+	}
+
+	complete = complete && ConcatenateVideos(parts, format, options.outPath);
+	for (const std::string& part : parts)
+		std::remove(part.c_str());
+
+	if (!complete)
+	{
+		std::cout << "Failed to render " << options.moviePath << " to " << options.outPath << std::endl;
+		return 1;
+	}
+
+	const double renderSeconds = std::chrono::duration<double>(rendered - start).count();
+	const double totalSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+	std::cout << "Rendered " << frames << " frames (" << frames / 60.0 << "s of gameplay) in " << segments.size() << " segments on "
+		<< workers.size() << " threads: " << renderSeconds << "s simulating and encoding, " << totalSeconds - renderSeconds << "s joining, "
+		<< (totalSeconds > 0.0 ? frames / 60.0 / totalSeconds : 0.0) << "x realtime" << std::endl;
+	return 0;
+}
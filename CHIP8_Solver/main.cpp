@@ -0,0 +1,751 @@
+// Searches the keypad input that takes a rom to a goal (bytes of memory, lit pixels) with Monte Carlo tree search over the interpreter.
+// A move is a key press followed by running until the rom waits for input again. Every thread searches its own tree from the current
+// position (root parallelization) with a transposition table keyed by the state hash, the most visited move over all trees is played.
+// Build together with the interpreter sources of CHIP8_Interpreter (everything except its main.cpp), no OpenGL needed.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "../CHIP8_Interpreter/CycleDetector.h"
+#include "../CHIP8_Interpreter/InputMovie.h"
+#include "../CHIP8_Interpreter/Interpreter.h"
+#include "../CHIP8_Interpreter/PagedState.h"
+#include "../CHIP8_Interpreter/RomDatabase.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// Frames a move may take before the rom waits for input again, a rom that never settles is searched frame by frame after the hold
+const int SETTLE_FRAMES = 1200;
+
+struct Goal
+{
+	unsigned short address = 0;
+	std::vector<unsigned char> bytes; // memory from address has to hold these
+	int width = 0; // > 0: the bytes are the solved board of a sliding puzzle this wide, scored by the tiles' distance to their place
+	std::vector<std::pair<int, int>> pixels; // pixels that have to be lit
+};
+
+// Goals for the roms this was written for, found by their name in the rom database
+struct Preset
+{
+	const char* name;
+	unsigned short address;
+	const char* bytes;
+	int width;
+	const char* keys;
+	int holdFrames;
+	int scramble;
+};
+
+const Preset PRESETS[] =
+{
+	// Starts solved, so it is scrambled first. A key moves the gap to that cell, the key scan loop needs the key for 10 frames
+	{ "15PUZZLE", 0x2E8, "0102030405060708090A0B0C0D0E0F00", 4, "0123456789ABCDEF", 12, 6 },
+	// Scrambles itself with 255 random moves, 2 4 6 8 slide a tile into the gap
+	{ "PUZZLE", 0x300, "000102030405060708090A0B0C0D0E0F", 4, "2468", 1, 0 },
+	// Two players take turns on keys 1-9, the score display leaves the first player's wins in BCD at 0x3E6
+	{ "TICTAC", 0x3E8, "01", 0, "123456789", 1, 0 },
+};
+
+struct Options
+{
+	std::string romPath;
+	std::string romDatabasePath = "../CHIP8_Interpreter/Resources/romdb.txt";
+	std::string moviePath;
+	Goal goal;
+	std::string keys;
+	int holdFrames = -1;
+	int scramble = -1;
+	int moves = 200;
+	int iterations = 2000; // per move, over all threads
+	int rolloutMoves = 20;
+	double exploration = 0.25;
+	int threads = 0; // 0 uses every hardware thread
+	unsigned long long seed = 1;
+};
+
+// Everything a search thread needs to set up and play the rom
+struct Problem
+{
+	std::vector<unsigned char> rom;
+	const RomProfile* profile = nullptr;
+	Goal goal;
+	std::vector<unsigned short> keypads; // one per move
+	int holdFrames = 1;
+	int rolloutMoves = 20;
+	double exploration = 0.25;
+	unsigned long long seed = 1;
+
+	std::vector<int> targets; // sliding puzzles: index of every byte value in the solved board, -1 for values that aren't in it
+};
+
+bool ReadFile(const std::string& path, std::vector<unsigned char>& bytes)
+{
+	std::ifstream file(path, std::ios_base::binary | std::ios_base::ate);
+	if (file.fail())
+		return false;
+
+	bytes.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+	return !file.fail();
+}
+
+bool ParseHexBytes(const std::string& text, std::vector<unsigned char>& bytes)
+{
+	if (text.empty() || text.size() % 2 != 0 || text.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos)
+		return false;
+
+	bytes.clear();
+	for (size_t i = 0; i < text.size(); i += 2)
+		bytes.push_back(static_cast<unsigned char>(std::strtoul(text.substr(i, 2).c_str(), nullptr, 16)));
+	return true;
+}
+
+// address:bytes[:width], all hexadecimal except the width
+bool ParseGoal(const std::string& text, Goal& goal)
+{
+	const size_t first = text.find(':');
+	if (first == std::string::npos)
+		return false;
+
+	const size_t second = text.find(':', first + 1);
+	goal.address = static_cast<unsigned short>(std::strtoul(text.substr(0, first).c_str(), nullptr, 16));
+	goal.width = (second == std::string::npos) ? 0 : std::max(0, std::atoi(text.substr(second + 1).c_str()));
+	return ParseHexBytes(text.substr(first + 1, second == std::string::npos ? std::string::npos : second - first - 1), goal.bytes);
+}
+
+bool ParseArguments(int argc, char* argv[], Options& options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		if (arg == "--romdb" && i + 1 < argc)
+			options.romDatabasePath = argv[++i];
+		else if (arg == "--goal" && i + 1 < argc)
+		{
+			if (!ParseGoal(argv[++i], options.goal))
+				return false;
+		}
+		else if (arg == "--pixel" && i + 1 < argc)
+		{
+			const std::string pixel = argv[++i];
+			const size_t comma = pixel.find(',');
+			if (comma == std::string::npos)
+				return false;
+			options.goal.pixels.emplace_back(std::atoi(pixel.substr(0, comma).c_str()), std::atoi(pixel.substr(comma + 1).c_str()));
+		}
+		else if (arg == "--keys" && i + 1 < argc)
+			options.keys = argv[++i];
+		else if (arg == "--hold" && i + 1 < argc)
+			options.holdFrames = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--scramble" && i + 1 < argc)
+			options.scramble = std::max(0, std::atoi(argv[++i]));
+		else if (arg == "--moves" && i + 1 < argc)
+			options.moves = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--iterations" && i + 1 < argc)
+			options.iterations = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--rollout" && i + 1 < argc)
+			options.rolloutMoves = std::max(0, std::atoi(argv[++i]));
+		else if (arg == "--exploration" && i + 1 < argc)
+			options.exploration = std::max(0.0, std::atof(argv[++i]));
+		else if (arg == "--threads" && i + 1 < argc)
+			options.threads = std::max(0, std::atoi(argv[++i]));
+		else if (arg == "--seed" && i + 1 < argc)
+			options.seed = std::strtoull(argv[++i], nullptr, 10);
+		else if (arg == "--movie" && i + 1 < argc)
+			options.moviePath = argv[++i];
+		else if (options.romPath.empty() && arg.compare(0, 2, "--") != 0)
+			options.romPath = arg;
+		else
+			return false;
+	}
+	return !options.romPath.empty();
+}
+
+bool IsSolved(const Interpreter& interpreter, const Goal& goal)
+{
+	for (size_t i = 0; i < goal.bytes.size(); ++i)
+	{
+		if (interpreter.ReadMemory(static_cast<unsigned short>(goal.address + i)) != goal.bytes[i])
+			return false;
+	}
+	for (const std::pair<int, int>& pixel : goal.pixels)
+	{
+		if (!interpreter.IsPixelOn(pixel.first, pixel.second))
+			return false;
+	}
+	return true;
+}
+
+// 1 for a solved state, otherwise the part of the goal that is met: matching bytes, or for a sliding puzzle how close the tiles are to
+// their place (Manhattan distance), and the lit pixels
+double Score(const Interpreter& interpreter, const Problem& problem)
+{
+	const Goal& goal = problem.goal;
+	double score = 0.0;
+	int parts = 0;
+	if (!goal.bytes.empty())
+	{
+		const int count = static_cast<int>(goal.bytes.size());
+		int matched = 0;
+		int distance = 0;
+		for (int i = 0; i < count; ++i)
+		{
+			const unsigned char value = interpreter.ReadMemory(static_cast<unsigned short>(goal.address + i));
+			matched += (value == goal.bytes[i]) ? 1 : 0;
+			if (goal.width > 0)
+			{
+				const int target = problem.targets[value];
+				const int height = (count + goal.width - 1) / goal.width;
+				distance += (target < 0) ? goal.width + height - 2
+					: std::abs(target % goal.width - i % goal.width) + std::abs(target / goal.width - i / goal.width);
+			}
+		}
+
+		if (goal.width > 0)
+		{
+			const int height = (count + goal.width - 1) / goal.width;
+			score += 1.0 - static_cast<double>(distance) / (count * std::max(1, goal.width + height - 2));
+		}
+		else
+			score += static_cast<double>(matched) / count;
+		++parts;
+	}
+
+	if (!goal.pixels.empty())
+	{
+		int lit = 0;
+		for (const std::pair<int, int>& pixel : goal.pixels)
+			lit += interpreter.IsPixelOn(pixel.first, pixel.second) ? 1 : 0;
+		score += static_cast<double>(lit) / goal.pixels.size();
+		++parts;
+	}
+	return (parts > 0) ? score / parts : 0.0;
+}
+
+void SetUp(Interpreter& interpreter, const Problem& problem)
+{
+	if (problem.profile != nullptr)
+		problem.profile->Apply(interpreter);
+	interpreter.SetSeed(problem.seed);
+	interpreter.SetSoundEnabled(false);
+	interpreter.SetFastForward(true);
+	interpreter.SetStateHashing(true);
+	interpreter.Initialize();
+	interpreter.LoadRom(problem.rom.data(), problem.rom.size());
+}
+
+/* Plays one move: the keypad is held for holdFrames and released, then the rom runs until its state repeats, which is a rom polling the
+keypad. Of the frames of that idle loop the one with the lowest state hash is kept, so a position reached through different moves ends
+in the same state and the transposition table finds it. Returns the emulated instructions*/
+unsigned long long PlayMove(Interpreter& interpreter, CycleDetector& detector, const Problem& problem, unsigned short keypad,
+	InputMovie* movie = nullptr)
+{
+	const unsigned long long startCycle = interpreter.GetCycleCount();
+	auto runFrame = [&]()
+	{
+		if (movie != nullptr)
+			movie->Record(interpreter);
+		interpreter.RunFrame();
+	};
+
+	interpreter.m_Keypad = keypad;
+	for (int i = 0; i < problem.holdFrames && keypad != 0; ++i)
+		runFrame();
+
+	interpreter.m_Keypad = 0;
+	detector.Reset();
+	for (int i = 0; i < SETTLE_FRAMES && !detector.IsCycling(); ++i)
+	{
+		runFrame();
+		detector.Observe(interpreter);
+	}
+
+	const int period = static_cast<int>(std::min<unsigned long long>(detector.GetPeriod(), SETTLE_FRAMES));
+	if (period > 1)
+	{
+		int lowest = 0;
+		unsigned long long lowestHash = interpreter.GetStateHash();
+		for (int i = 1; i < period; ++i)
+		{
+			runFrame();
+			const unsigned long long hash = interpreter.GetStateHash();
+			if (hash < lowestHash)
+			{
+				lowest = i;
+				lowestHash = hash;
+			}
+		}
+		for (int i = 0; i < (lowest + 1) % period; ++i)
+			runFrame();
+	}
+	return interpreter.GetCycleCount() - startCycle;
+}
+
+// One tree, searched by one thread. Nodes keep their state as a PagedState, so a node costs the pages its move changed
+class SearchWorker
+{
+public:
+	SearchWorker(const Problem& problem, unsigned int seed)
+		: m_Problem(problem), m_Interpreter(new Interpreter()), m_Random(seed)
+	{
+		SetUp(*m_Interpreter, problem);
+	}
+
+	// Searches from root for iterations rollouts
+	void Search(const Interpreter::Snapshot& root, int iterations)
+	{
+		m_Nodes.clear();
+		m_Table.clear();
+		m_Solution.clear();
+		m_Nodes.reserve(static_cast<size_t>(iterations) + 1);
+
+		m_Interpreter->LoadSnapshot(root);
+		AddNode(m_Interpreter->GetStateHash());
+		for (int i = 0; i < iterations && m_Solution.empty(); ++i)
+			Iterate();
+	}
+
+	// Visits, summed reward and resulting state of the root's moves, 0 visits for moves that don't change the state
+	void GetRootStatistics(std::vector<unsigned long long>& visits, std::vector<double>& rewards, std::vector<unsigned long long>& hashes) const
+	{
+		const Node& root = m_Nodes[0];
+		for (size_t action = 0; action < root.children.size(); ++action)
+		{
+			const int child = root.children[action];
+			if (child >= 0)
+			{
+				visits[action] += m_Nodes[child].visits;
+				rewards[action] += m_Nodes[child].reward;
+				hashes[action] = m_Nodes[child].hash;
+			}
+		}
+	}
+
+	// Moves from the root to a solved state, empty when none was found
+	const std::vector<int>& GetSolution() const { return m_Solution; }
+
+	unsigned long long GetMoveCount() const { return m_Moves; }
+	unsigned long long GetInstructionCount() const { return m_Instructions; }
+	unsigned long long GetExpansionCount() const { return m_Expansions; }
+	unsigned long long GetTranspositionCount() const { return m_Transpositions; }
+
+private:
+	enum { UNEXPANDED = -1, NO_CHANGE = -2 };
+
+	struct Node
+	{
+		PagedState state;
+		unsigned long long hash = 0;
+		unsigned long long visits = 0;
+		double reward = 0.0;
+		bool solved = false;
+		int unexpanded = 0;
+		std::vector<int> children; // per move: a node, UNEXPANDED or NO_CHANGE
+	};
+
+	const Problem& m_Problem;
+	PagePool m_Pool; // before everything that holds its pages
+	std::unique_ptr<Interpreter> m_Interpreter;
+	CycleDetector m_Detector;
+	std::mt19937 m_Random;
+
+	std::vector<Node> m_Nodes;
+	std::unordered_map<unsigned long long, int> m_Table; // state hash to node
+	std::vector<int> m_Path;
+	std::vector<int> m_PathMoves;
+	std::vector<int> m_RolloutMoves;
+	std::vector<int> m_Solution;
+
+	unsigned long long m_Moves = 0;
+	unsigned long long m_Instructions = 0;
+	unsigned long long m_Expansions = 0;
+	unsigned long long m_Transpositions = 0;
+
+	// Adds the interpreter's current state
+	int AddNode(unsigned long long hash)
+	{
+		const int index = static_cast<int>(m_Nodes.size());
+		m_Nodes.emplace_back();
+		Node& node = m_Nodes.back();
+		m_Interpreter->Fork(m_Pool, node.state);
+		node.hash = hash;
+		node.solved = IsSolved(*m_Interpreter, m_Problem.goal);
+		node.unexpanded = static_cast<int>(m_Problem.keypads.size());
+		node.children.assign(m_Problem.keypads.size(), UNEXPANDED);
+		m_Table[hash] = index;
+		return index;
+	}
+
+	void Play(int move)
+	{
+		m_Instructions += PlayMove(*m_Interpreter, m_Detector, m_Problem, m_Problem.keypads[move]);
+		++m_Moves;
+	}
+
+	bool IsOnPath(int node) const
+	{
+		return std::find(m_Path.begin(), m_Path.end(), node) != m_Path.end();
+	}
+
+	// UCT over the expanded moves, -1 when every move leaves the state unchanged
+	int SelectMove(int node)
+	{
+		const Node& parent = m_Nodes[node];
+		const double logVisits = std::log(static_cast<double>(std::max(1ull, parent.visits)));
+		int best = -1;
+		double bestValue = 0.0;
+		for (size_t move = 0; move < parent.children.size(); ++move)
+		{
+			const int child = parent.children[move];
+			if (child < 0)
+				continue;
+
+			const Node& next = m_Nodes[child];
+			const double visits = static_cast<double>(std::max(1ull, next.visits));
+			const double value = next.reward / visits + m_Problem.exploration * std::sqrt(logVisits / visits);
+			if (best < 0 || value > bestValue)
+			{
+				best = static_cast<int>(move);
+				bestValue = value;
+			}
+		}
+		return best;
+	}
+
+	// Plays a random unexpanded move of node, leaving the interpreter in the resulting state. Returns the node of that state
+	// (a new one, or an existing one the transposition table found), -1 when all remaining moves leave the state unchanged
+	int Expand(int node)
+	{
+		while (m_Nodes[node].unexpanded > 0)
+		{
+			int pick = static_cast<int>(m_Random() % static_cast<unsigned int>(m_Nodes[node].unexpanded));
+			int move = 0;
+			while (m_Nodes[node].children[move] != UNEXPANDED || pick-- > 0)
+				++move;
+
+			m_Interpreter->Restore(m_Nodes[node].state);
+			Play(move);
+			--m_Nodes[node].unexpanded;
+
+			const unsigned long long hash = m_Interpreter->GetStateHash();
+			if (hash == m_Nodes[node].hash)
+			{
+				m_Nodes[node].children[move] = NO_CHANGE;
+				continue;
+			}
+
+			++m_Expansions;
+			std::unordered_map<unsigned long long, int>::const_iterator found = m_Table.find(hash);
+			int child;
+			if (found != m_Table.end())
+			{
+				child = found->second;
+				++m_Transpositions;
+			}
+			else
+				child = AddNode(hash);
+
+			m_Nodes[node].children[move] = child;
+			m_PathMoves.push_back(move);
+			return child;
+		}
+		return -1;
+	}
+
+	// Random moves from the interpreter's state, the reward is the best score on the way
+	double Rollout()
+	{
+		m_RolloutMoves.clear();
+		double best = Score(*m_Interpreter, m_Problem);
+		for (int i = 0; i < m_Problem.rolloutMoves && !IsSolved(*m_Interpreter, m_Problem.goal); ++i)
+		{
+			const int move = static_cast<int>(m_Random() % m_Problem.keypads.size());
+			Play(move);
+			m_RolloutMoves.push_back(move);
+			best = std::max(best, Score(*m_Interpreter, m_Problem));
+		}
+
+		if (IsSolved(*m_Interpreter, m_Problem.goal))
+		{
+			m_Solution = m_PathMoves;
+			m_Solution.insert(m_Solution.end(), m_RolloutMoves.begin(), m_RolloutMoves.end());
+			return 1.0;
+		}
+		return best;
+	}
+
+	void Iterate()
+	{
+		m_Path.assign(1, 0);
+		m_PathMoves.clear();
+
+		// Select down the tree until a node with unexpanded moves, a solved node or a state that is already on the path
+		int node = 0;
+		bool restored = false;
+		while (!m_Nodes[node].solved)
+		{
+			if (m_Nodes[node].unexpanded > 0)
+			{
+				const int child = Expand(node);
+				if (child >= 0)
+				{
+					if (!IsOnPath(child))
+						m_Path.push_back(child);
+					node = child;
+					restored = true;
+					break;
+				}
+			}
+
+			const int move = SelectMove(node);
+			if (move < 0)
+				break;
+
+			const int child = m_Nodes[node].children[move];
+			if (IsOnPath(child))
+				break;
+			m_Path.push_back(child);
+			m_PathMoves.push_back(move);
+			node = child;
+		}
+
+		if (!restored)
+			m_Interpreter->Restore(m_Nodes[node].state);
+		const double reward = Rollout();
+
+		for (int index : m_Path)
+		{
+			++m_Nodes[index].visits;
+			m_Nodes[index].reward += reward;
+		}
+	}
+};
+
+// Replays the moves from the start, recording them to a movie when moviePath is set. Returns whether the goal is reached at the end
+bool Replay(const Problem& problem, const std::vector<unsigned short>& keypads, const std::string& moviePath)
+{
+	std::unique_ptr<Interpreter> interpreter(new Interpreter());
+	SetUp(*interpreter, problem);
+
+	CycleDetector detector;
+	InputMovie movie;
+	InputMovie* recording = moviePath.empty() ? nullptr : &movie;
+	if (recording != nullptr)
+		movie.StartRecording(*interpreter);
+
+	for (unsigned short keypad : keypads)
+		PlayMove(*interpreter, detector, problem, keypad, recording);
+
+	if (recording != nullptr)
+	{
+		movie.StopRecording(*interpreter);
+		if (!movie.Save(moviePath))
+		{
+			std::cout << "Failed to save the movie to " << moviePath << std::endl;
+			return false;
+		}
+	}
+	return IsSolved(*interpreter, problem.goal);
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	if (!ParseArguments(argc, argv, options))
+	{
+		std::cout << "Usage: CHIP8_Solver [--romdb file] [--goal address:bytes[:width]] [--pixel x,y] [--keys keys] [--hold frames] "
+			<< "[--scramble moves] [--moves n] [--iterations n] [--rollout n] [--exploration c] [--threads n] [--seed n] [--movie file] rom"
+			<< std::endl;
+		return 1;
+	}
+
+	Problem problem;
+	if (!ReadFile(options.romPath, problem.rom))
+	{
+		std::cout << "Failed to load Rom with path " << options.romPath << std::endl;
+		return 1;
+	}
+
+	RomDatabase romDatabase;
+	romDatabase.Load(options.romDatabasePath);
+	problem.profile = romDatabase.Identify(problem.rom.data(), problem.rom.size());
+
+	// A known rom brings its goal, keys and timing, options override them
+	const Preset* preset = nullptr;
+	for (const Preset& candidate : PRESETS)
+	{
+		if (problem.profile != nullptr && problem.profile->name == candidate.name)
+			preset = &candidate;
+	}
+
+	problem.goal = options.goal;
+	std::string keys = options.keys;
+	int scramble = std::max(0, options.scramble);
+	problem.holdFrames = (options.holdFrames > 0) ? options.holdFrames : 1;
+	if (preset != nullptr)
+	{
+		if (problem.goal.bytes.empty() && problem.goal.pixels.empty())
+		{
+			problem.goal.address = preset->address;
+			problem.goal.width = preset->width;
+			ParseHexBytes(preset->bytes, problem.goal.bytes);
+		}
+		if (keys.empty())
+			keys = preset->keys;
+		if (options.holdFrames <= 0)
+			problem.holdFrames = preset->holdFrames;
+		if (options.scramble < 0)
+			scramble = preset->scramble;
+	}
+
+	if (problem.goal.bytes.empty() && problem.goal.pixels.empty())
+	{
+		std::cout << "No goal for " << options.romPath << ", set one with --goal or --pixel" << std::endl;
+		return 1;
+	}
+
+	if (keys.empty())
+		keys = "0123456789ABCDEF";
+	for (char key : keys)
+	{
+		const std::string digit(1, key);
+		if (digit.find_first_not_of("0123456789abcdefABCDEF") == std::string::npos)
+			problem.keypads.push_back(static_cast<unsigned short>(1 << std::strtoul(digit.c_str(), nullptr, 16)));
+	}
+
+	problem.targets.assign(256, -1);
+	for (size_t i = 0; i < problem.goal.bytes.size(); ++i)
+		problem.targets[problem.goal.bytes[i]] = static_cast<int>(i);
+	problem.rolloutMoves = options.rolloutMoves;
+	problem.exploration = options.exploration;
+	problem.seed = options.seed;
+
+	const int threads = (options.threads > 0) ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+	std::vector<std::unique_ptr<SearchWorker>> workers;
+	for (int i = 0; i < threads; ++i)
+		workers.emplace_back(new SearchWorker(problem, static_cast<unsigned int>(options.seed * 1000003 + i)));
+
+	// The game itself: played up to its first input, then scrambled with random moves
+	std::unique_ptr<Interpreter> game(new Interpreter());
+	SetUp(*game, problem);
+	CycleDetector detector;
+	std::mt19937 random(static_cast<unsigned int>(options.seed));
+	std::vector<unsigned short> played(1, 0);
+	PlayMove(*game, detector, problem, 0);
+	for (int i = 0; i < scramble; ++i)
+	{
+		played.push_back(problem.keypads[random() % problem.keypads.size()]);
+		PlayMove(*game, detector, problem, played.back());
+	}
+	const size_t firstMove = played.size();
+
+	// Positions already played are not played again, so the game doesn't go back and forth on a plateau of the score
+	std::unordered_set<unsigned long long> positions;
+	positions.insert(game->GetStateHash());
+
+	std::cout << "Solving " << (problem.profile != nullptr ? problem.profile->name : options.romPath) << " with " << problem.keypads.size()
+		<< " keys, " << options.iterations << " rollouts per move on " << threads << " threads, start score " << Score(*game, problem) << std::endl;
+
+	const Clock::time_point start = Clock::now();
+	Interpreter::Snapshot root;
+	bool solved = IsSolved(*game, problem.goal);
+	for (int move = 0; move < options.moves && !solved; ++move)
+	{
+		game->SaveSnapshot(root);
+		std::vector<std::thread> threadPool;
+		for (int i = 0; i < threads; ++i)
+		{
+			const int iterations = options.iterations / threads + (i < options.iterations % threads ? 1 : 0);
+			threadPool.emplace_back([&workers, &root, i, iterations]() { workers[i]->Search(root, std::max(1, iterations)); });
+		}
+		for (std::thread& thread : threadPool)
+			thread.join();
+
+		// A rollout that reached the goal ends the search, otherwise the move most visited over all trees is played
+		const std::vector<int>* solution = nullptr;
+		for (const std::unique_ptr<SearchWorker>& worker : workers)
+		{
+			if (!worker->GetSolution().empty() && (solution == nullptr || worker->GetSolution().size() < solution->size()))
+				solution = &worker->GetSolution();
+		}
+
+		std::vector<int> chosen;
+		if (solution != nullptr)
+			chosen = *solution;
+		else
+		{
+			std::vector<unsigned long long> visits(problem.keypads.size(), 0);
+			std::vector<double> rewards(problem.keypads.size(), 0.0);
+			std::vector<unsigned long long> hashes(problem.keypads.size(), 0);
+			for (const std::unique_ptr<SearchWorker>& worker : workers)
+				worker->GetRootStatistics(visits, rewards, hashes);
+
+			int best = -1;
+			for (size_t i = 0; i < visits.size(); ++i)
+			{
+				if (visits[i] == 0 || positions.count(hashes[i]) != 0)
+					continue;
+				if (best < 0 || visits[i] > visits[best] || (visits[i] == visits[best] && rewards[i] > rewards[best]))
+					best = static_cast<int>(i);
+			}
+			if (best < 0)
+			{
+				std::cout << "Every move leads to a position that was already played" << std::endl;
+				break;
+			}
+			chosen.push_back(best);
+		}
+
+		for (int next : chosen)
+		{
+			played.push_back(problem.keypads[next]);
+			PlayMove(*game, detector, problem, played.back());
+			positions.insert(game->GetStateHash());
+		}
+		solved = IsSolved(*game, problem.goal);
+		std::cout << "Move " << move + 1 << ": " << (solution != nullptr ? "rollout reached the goal, " : "") << "played " << chosen.size()
+			<< (chosen.size() == 1 ? " move" : " moves") << ", score " << Score(*game, problem) << std::endl;
+	}
+	const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	unsigned long long moves = 0;
+	unsigned long long instructions = 0;
+	unsigned long long expansions = 0;
+	unsigned long long transpositions = 0;
+	for (const std::unique_ptr<SearchWorker>& worker : workers)
+	{
+		moves += worker->GetMoveCount();
+		instructions += worker->GetInstructionCount();
+		expansions += worker->GetExpansionCount();
+		transpositions += worker->GetTranspositionCount();
+	}
+
+	if (solved)
+		std::cout << "Solved in " << played.size() - firstMove << " moves (" << (firstMove - 1) << " scramble moves before them)" << std::endl;
+	else
+		std::cout << "Not solved, score " << Score(*game, problem) << std::endl;
+
+	std::cout << "Searched " << moves << " nodes in " << seconds << "s: " << (seconds > 0.0 ? moves / seconds : 0.0) << " nodes/s, "
+		<< (seconds > 0.0 ? instructions / seconds / 1e6 : 0.0) << "M instructions/s, " << expansions << " expansions of which "
+		<< (expansions > 0 ? 100.0 * transpositions / expansions : 0.0) << "% transpositions" << std::endl;
+
+	if (!options.moviePath.empty() && !Replay(problem, played, options.moviePath))
+	{
+		std::cout << "The replay didn't reach the goal" << std::endl;
+		return 1;
+	}
+	return solved ? 0 : 2;
+}